@@ -1,7 +1,14 @@
 import argparse
+from concurrent.futures import ThreadPoolExecutor
 from functools import reduce
+import hashlib
 import math
+import os
 from os import path
+import queue
+import random
+import shutil
+import tempfile
 import time
 from typing import List, Tuple, Callable
 import jinja2
@@ -32,6 +39,9 @@ ALGORITHM_CHOICES = {
     ALGORITHM_TC,
 }
 
+SEARCH_HILL_CLIMBING = "hill-climbing"
+SEARCH_SUCCESSIVE_HALVING = "successive-halving"
+
 parser = argparse.ArgumentParser()
 parser.add_argument(
     "-p", "--project-root", help="path of the project root", type=str, required=True
@@ -58,6 +68,31 @@ parser.add_argument(
     help="generated code should use vector instructions",
     action="store_true",
 )
+parser.add_argument(
+    "-s",
+    "--search",
+    help="search strategy: hill-climbing from an exhaustive initial guess, or successive halving over randomly sampled FWT parameters on increasing input sizes",
+    choices=[SEARCH_HILL_CLIMBING, SEARCH_SUCCESSIVE_HALVING],
+    default=SEARCH_HILL_CLIMBING,
+)
+parser.add_argument(
+    "--candidates",
+    help="number of FWT parameter tuples sampled for successive halving",
+    type=int,
+    default=27,
+)
+parser.add_argument(
+    "--eta",
+    help="successive halving keeps the best 1/eta candidates per round",
+    type=int,
+    default=3,
+)
+parser.add_argument(
+    "--cores",
+    help="cores to run measurements on in parallel, one binary per core, e.g. 2-5,7 (default: the isolated cores, or serial if none are isolated)",
+    type=str,
+    default=None,
+)
 parser.add_argument(
     "-run",
     "--run-measurements",
@@ -76,10 +111,14 @@ BENCH_INPUT_DIR_BITWISE = "bench-inputs-tc"
 TEST_INPUT_DIR = "test-inputs"
 LOG_FILE = 'autotuning/autotune.log'
 PERSIST_LOG_FILE = 'optimal-parameters.log'
+TUNEDB_FILE = 'tuned-parameters.csv'
+TRACE_FILE = 'search-trace-n{}.csv'
 PERSIST_DIR = 'autotuning/generated'
 TEMPLATE_DIR = 'autotuning/templates'
 SOURCE_DIR = 'generic/c/impl'
 DATA_DIR = 'measurements/data'
+# binaries of earlier builds by content hash, outside of build/ which is cleaned between rounds
+BUILD_CACHE_DIR = 'autotuning/cache'
 
 
 def clean_files(project_root):
@@ -329,8 +368,9 @@ def measure_fw(
     input_size: int,
     p_impl: str = None,
     output_dir: str = None,
+    cpu: int = None,
 ) -> int:
-    """run a generated and built implementation against a testcase of the given size"""
+    """run a generated and built implementation against a testcase of the given size, pinned to cpu if given"""
     logger.info(f"measuring code for: {implementation}")
 
     if p_impl:
@@ -358,9 +398,13 @@ def measure_fw(
         outpath,
         "--incremental",
     ]
+    if cpu is not None:
+        measure_cmd = ["taskset", "-c", str(cpu)] + measure_cmd
 
     logger.debug(measure_cmd)
-    result = subprocess.run(args=measure_cmd, stdout=subprocess.DEVNULL)
+    # concurrent measurements of the same testcase must not share the output matrix
+    with tempfile.TemporaryDirectory() as scratch_dir:
+        result = subprocess.run(args=measure_cmd + ["--output-dir", scratch_dir], stdout=subprocess.DEVNULL)
 
     logger.debug(result.stdout)
     if result.returncode != 0:
@@ -409,7 +453,111 @@ def get_perf(
     return p
 
 
-def find_best_neighbour(
+# every evaluated parameter tuple in order of evaluation, written to TRACE_FILE per input size
+search_trace = list()
+
+
+def record_trace(form: str, input_size: int, parameters: Tuple, perf: float):
+    # best so far for the same form and input size, perf of different sizes is not comparable
+    best = max([perf] + [t[4] for t in search_trace if t[0] == form and t[1] == input_size])
+    search_trace.append((form, input_size, parameters, perf, best))
+
+
+def write_trace(project_root: str, algorithm: str, input_size: int) -> str:
+    """writes the convergence trace of the search: evaluation, form, n, parameters, flops/cycle, best so far"""
+    trace_path = path.join(project_root, PERSIST_DIR, algorithm, TRACE_FILE.format(input_size))
+    with open(trace_path, "w", newline="") as f:
+        writer = csv.writer(f, lineterminator="\n")
+        writer.writerow(["evaluation", "form", "n", "parameters", "perf", "best"])
+        for i, (form, n, parameters, perf, best) in enumerate(search_trace, start=1):
+            writer.writerow([i, form, n, "-".join(map(str, parameters)), perf, best])
+    search_trace.clear()
+    return trace_path
+
+
+def input_dir_for(algorithm: str, input_size: int) -> str:
+    if algorithm == ALGORITHM_TC:
+        return BENCH_INPUT_DIR_BITWISE
+    return TEST_INPUT_DIR if input_size == 64 else BENCH_INPUT_DIR
+
+
+def build_cached(project_root: str, implementation: str, c_flags: str, sources: List[str]):
+    """Builds the generated sources in parallel, reusing the binary of an earlier build for identical sources.
+
+    The cache key hashes the compiler, flags, counter backend, generated source, main.c, fw.h and the benchmark
+    harness. The binaries are built in the docker image, so clear BUILD_CACHE_DIR whenever the image changes.
+    """
+    cache_dir = path.join(project_root, BUILD_CACHE_DIR)
+    build_dir = path.join(project_root, "build")
+    os.makedirs(cache_dir, exist_ok=True)
+    os.makedirs(build_dir, exist_ok=True)
+
+    shared_files = [path.join(SOURCE_DIR, "..", "main.c"), path.join(SOURCE_DIR, "fw.h")]
+    harness_files = ("harness.h", "harness.c", "counters.h", "counters.c", "phases.h", "phases.c", "pages.h", "pages.c")
+    shared_files += [path.join("generic", "harness", f) for f in harness_files]
+    # make passes the counter backend on to the build container, see Makefile
+    shared = os.environ.get("COUNTERS_DOCKER", "papi").encode() + b"\0"
+    for shared_file in shared_files:
+        with open(path.join(project_root, shared_file), "rb") as f:
+            shared += f.read()
+
+    to_build = dict()
+    for source in sources:
+        with open(source, "rb") as f:
+            key = hashlib.sha256(
+                COMPILER.encode() + b"\0" + c_flags.encode() + b"\0" + shared + f.read()
+            ).hexdigest()
+        binary = path.join(build_dir, path.splitext(path.basename(source))[0])
+        cached = path.join(cache_dir, key)
+        if path.exists(cached):
+            shutil.copy2(cached, binary)
+            # keep the build rule from compiling it again
+            os.remove(source)
+        else:
+            to_build[binary] = cached
+
+    logger.info(f"{len(sources) - len(to_build)} of {len(sources)} binaries found in the build cache")
+    if len(to_build) == 0:
+        return
+
+    # build source -'gg' for generic
+    retcode = build_files(project_root, "gg", implementation, COMPILER, c_flags)
+    if retcode != 0:
+        raise Exception("Building {} failed".format(implementation))
+
+    for binary, cached in to_build.items():
+        shutil.copy2(binary, cached)
+
+
+# cores to pin parallel measurements to, empty to measure serially without pinning
+MEASURE_CORES = list()
+
+
+def parse_cpu_list(cpu_list: str) -> List[int]:
+    """parses a cpu list such as 2-5,7 as used by taskset and /sys/devices/system/cpu/isolated"""
+    cores = list()
+    for part in cpu_list.strip().split(","):
+        if part == "":
+            continue
+        elif "-" in part:
+            first, last = part.split("-")
+            cores.extend(range(int(first), int(last) + 1))
+        else:
+            cores.append(int(part))
+    return cores
+
+
+def measurement_cores(cpu_list: str = None) -> List[int]:
+    if cpu_list is not None:
+        return parse_cpu_list(cpu_list)
+    try:
+        with open("/sys/devices/system/cpu/isolated") as f:
+            return parse_cpu_list(f.read())
+    except OSError:
+        return list()
+
+
+def evaluate_params(
     project_root: str,
     algorithm: str,
     form: str,
@@ -417,17 +565,18 @@ def find_best_neighbour(
     input_size: int,
     test_input_dir: str,
     parameter_list: List[Tuple],
-) -> Tuple[Tuple, float]:
-    """Takes a list of parameters (neighbours), and generates, builds and measures the performance of source files for each.
-    The function returns the optimal parameters and the corresponding performance value.
+) -> List[Tuple[Tuple, float]]:
+    """Takes a list of parameters, and generates, builds and measures the performance of source files for each.
+    The function returns the parameters together with their performance in flops/cycle.
     """
     c_flags = C_FLAGS_VECTOR if vectorized else C_FLAGS_SCALAR
 
     # generate source and store in generic/c/impl
     param_impl_list = list()
+    sources = list()
     for parameters in parameter_list:
         # impl should be the same for each generated source file
-        impl, param_impl, _ = generate_fw(
+        impl, param_impl, source = generate_fw(
             path.join(project_root, TEMPLATE_DIR),
             path.join(project_root, SOURCE_DIR),
             algorithm,
@@ -438,16 +587,12 @@ def find_best_neighbour(
             parameters,
         )
         param_impl_list.append((parameters, param_impl))
+        sources.append(source)
 
-    # build source -'gg' for generic
-    retcode = build_files(project_root, "gg", impl, COMPILER, c_flags)
-    if retcode != 0:
-        raise Exception("Building {} failed".format(impl))
+    build_cached(project_root, impl, c_flags, sources)
 
-    max_perf = -1
-
-    for params, p_impl in param_impl_list:
-        if VALIDATING and form != "FWIabc":
+    if VALIDATING and form != "FWIabc":
+        for params, p_impl in param_impl_list:
             # validate correctness of neighbour
             retcode = validate_fw(
                 project_root,
@@ -460,7 +605,7 @@ def find_best_neighbour(
             if retcode != 0:
                 raise Exception("Validating {} failed".format(p_impl))
 
-        # measure performance
+    def measure(p_impl: str, cpu: int) -> float:
         retcode, _ = measure_fw(
             project_root,
             algorithm,
@@ -469,12 +614,12 @@ def find_best_neighbour(
             c_flags,
             test_input_dir,
             input_size,
+            cpu=cpu,
         )
         if retcode != 0:
             raise Exception("Running {} failed".format(p_impl))
 
-        # find highest performance
-        perf = get_perf(
+        return get_perf(
             path.join(project_root, DATA_DIR),
             algorithm,
             p_impl,
@@ -483,9 +628,51 @@ def find_best_neighbour(
             test_input_dir,
             input_size,
         )
-        if perf > max_perf:
-            max_perf = perf
-            best_neighbour = params
+
+    if len(MEASURE_CORES) == 0:
+        perfs = [measure(p_impl, None) for _, p_impl in param_impl_list]
+    else:
+        # one measurement per core at a time
+        free_cores = queue.Queue()
+        for cpu in MEASURE_CORES:
+            free_cores.put(cpu)
+
+        def measure_pinned(p_impl: str) -> float:
+            cpu = free_cores.get()
+            try:
+                return measure(p_impl, cpu)
+            finally:
+                free_cores.put(cpu)
+
+        with ThreadPoolExecutor(max_workers=len(MEASURE_CORES)) as pool:
+            perfs = list(pool.map(measure_pinned, [p_impl for _, p_impl in param_impl_list]))
+
+    results = list()
+    for (params, _), perf in zip(param_impl_list, perfs):
+        record_trace(form, input_size, params, perf)
+        results.append((params, perf))
+
+    return results
+
+
+def find_best_neighbour(
+    project_root: str,
+    algorithm: str,
+    form: str,
+    vectorized: bool,
+    input_size: int,
+    test_input_dir: str,
+    parameter_list: List[Tuple],
+) -> Tuple[Tuple, float]:
+    """Takes a list of parameters (neighbours), and generates, builds and measures the performance of source files for each.
+    The function returns the optimal parameters and the corresponding performance value.
+    """
+    results = evaluate_params(
+        project_root, algorithm, form, vectorized, input_size, test_input_dir, parameter_list
+    )
+
+    # find highest performance
+    best_neighbour, max_perf = max(results, key=lambda r: r[1])
 
     logger.info(
         f"Found best neighbour with parameters {best_neighbour} at a stellar {max_perf} flops/cycle"
@@ -523,7 +710,7 @@ def find_local_optimum(
             logger.info("No more neighbours to visit")
             break
         visited = visited + neighbours
-        best_neighbour, perf = find_best_neighbour(project_root, algorithm, form, vectorized, input_size, BENCH_INPUT_DIR_BITWISE if algorithm == ALGORITHM_TC else TEST_INPUT_DIR if input_size == 64 else BENCH_INPUT_DIR, neighbours)
+        best_neighbour, perf = find_best_neighbour(project_root, algorithm, form, vectorized, input_size, input_dir_for(algorithm, input_size), neighbours)
         if perf < curr_perf:
             logger.info("No way to improve")
             break
@@ -790,6 +977,78 @@ def optimize_fwt(
     )
 
 
+def sample_fwt_params(
+    algorithm: str, vectorized: bool, input_size: int, num_samples: int, seed: int = 0
+) -> List[Tuple[int, int, int, int, int, int]]:
+    """Draws num_samples distinct valid (L1, Ui, Uj, Ui', Uj', Uk') tuples for the given input size.
+
+    Unrolling factors are powers of two in the same ranges as the exhaustive search of find_initial_guess,
+    tile sizes are the factors of n they all divide.
+    """
+    vector_size = 32 if algorithm == ALGORITHM_TC else 4
+    # Uj and Uj' count bytes for transitive closure, i.e. 8 columns each
+    multf = 8 if algorithm == ALGORITHM_TC else 1
+    u_i = [2**i for i in range(5)]
+    u_j = [2**j for j in range(7) if not vectorized or 2**j % vector_size == 0]
+    u_k = [2**k for k in range(6)]
+
+    space = [
+        (l1, ui, uj, uii, ujj, ukk)
+        for l1 in factors_of(input_size)
+        for ui in u_i
+        for uj in u_j
+        for uii in u_i
+        for ujj in u_j
+        for ukk in u_k
+        if all(l1 % u == 0 for u in (ui, uj * multf, uii, ujj * multf, ukk))
+    ]
+    if len(space) == 0:
+        raise Exception(f"no valid FWT parameters for N = {input_size}")
+    return random.Random(seed).sample(space, min(num_samples, len(space)))
+
+
+def successive_halving(
+    project_root: str,
+    algorithm: str,
+    vectorized: bool,
+    input_size: int,
+    num_candidates: int,
+    eta: int,
+) -> Tuple[int, int, int, int, int, int]:
+    """Searches the joint FWT parameter space with successive halving.
+
+    The candidates are measured on the smaller testcases whose size divides n first, only the best 1/eta of them
+    advance to the next larger input, and the survivors of the last round are confirmed on n itself. Compared to
+    hill-climbing this needs about num_candidates * eta / (eta - 1) builds, most of them measured on small inputs.
+    """
+    num_rounds = max(1, math.ceil(math.log(num_candidates, eta)))
+    input_dir = input_dir_for(algorithm, input_size)
+    smaller_sizes = sorted(
+        int(d[1:])
+        for d in os.listdir(path.join(project_root, "testcases", input_dir))
+        if d.startswith("n") and d[1:].isdigit() and int(d[1:]) < input_size and input_size % int(d[1:]) == 0
+    )
+    round_sizes = (smaller_sizes[-(num_rounds - 1):] if num_rounds > 1 else []) + [input_size]
+
+    # the tile size has to divide the input of every round
+    candidates = sample_fwt_params(algorithm, vectorized, math.gcd(*round_sizes), num_candidates)
+    logger.info(f"successive halving over {len(candidates)} candidates on N = {round_sizes}")
+
+    for r, n in enumerate(round_sizes):
+        clean_files(project_root)
+        logger.info(f"===== Round {r + 1}: measuring {len(candidates)} candidates for N = {n} =====")
+        results = evaluate_params(
+            project_root, algorithm, "FWT", vectorized, n, input_dir_for(algorithm, n), candidates
+        )
+        results.sort(key=lambda x: x[1], reverse=True)
+        keep = len(results) if r == len(round_sizes) - 1 else max(1, len(results) // eta)
+        candidates = [params for params, _ in results[:keep]]
+
+    best, perf = results[0]
+    logger.info(f"Successive halving found {best} at {perf} flops/cycle")
+    return best
+
+
 def factors_of(n):
     """utility function to compute all divisors of n"""
     factors = [1]
@@ -864,6 +1123,56 @@ def get_l1_guess(
     )
 
 
+def cpu_key() -> Tuple[int, int, int, int, int]:
+    """CPUID family/model and L1d/L2/L3 sizes in KiB, the same key as in generic/tunedb/tunedb.c"""
+    family, model = 0, 0
+    with open("/proc/cpuinfo") as f:
+        for line in f:
+            if line.startswith("cpu family"):
+                family = int(line.split(":")[1])
+            elif line.startswith("model") and not line.startswith("model name"):
+                model = int(line.split(":")[1])
+            elif line.strip() == "":
+                break
+
+    sizes = {}
+    cache_dir = "/sys/devices/system/cpu/cpu0/cache"
+    for index in sorted(os.listdir(cache_dir)):
+        if not index.startswith("index"):
+            continue
+
+        def read(name):
+            with open(path.join(cache_dir, index, name)) as f:
+                return f.read().strip()
+
+        if read("type") != "Instruction":
+            sizes[int(read("level"))] = int(read("size").rstrip("K"))
+    return (family, model, sizes.get(1, 0), sizes.get(2, 0), sizes.get(3, 0))
+
+
+def store_tuned_parameters(project_root: str, algorithm: str, input_size: int, fwt_params: Tuple):
+    """stores the optimal FWT parameters in the tuning database the implementations load at startup"""
+    tunedb_path = os.environ.get("FW_TUNEDB", path.join(project_root, TUNEDB_FILE))
+    header = ["algo", "family", "model", "l1d", "l2", "l3", "nbucket", "n",
+              "L1", "Ui", "Uj", "Ui'", "Uj'", "Uk'", "cycles"]
+    key = [algorithm] + [str(k) for k in cpu_key()]
+
+    rows = []
+    if path.exists(tunedb_path):
+        with open(tunedb_path) as f:
+            rows = [r for r in csv.reader(f) if r and r[0] != "algo" and (r[:6] != key or r[7] != str(input_size))]
+        # drop the threads column of databases written before it was removed, it was always 1
+        rows = [r[:14] + r[15:] if len(r) == len(header) + 1 else r for r in rows]
+
+    # the number of cycles is not known here
+    rows.append(key + [str(input_size.bit_length() - 1), str(input_size)] + [str(p) for p in fwt_params] + ["0"])
+    with open(tunedb_path, "w", newline="") as f:
+        writer = csv.writer(f, lineterminator="\n")
+        writer.writerow(header)
+        writer.writerows(rows)
+    return tunedb_path
+
+
 def tune_em_all(
     project_root: str,
     algorithm: str,
@@ -871,6 +1180,10 @@ def tune_em_all(
     input_sizes: List[int],
     l2_cache_bytes: int,
     do_measure: bool = True,
+    search: str = SEARCH_HILL_CLIMBING,
+    num_candidates: int = 27,
+    eta: int = 3,
+    cores: str = None,
 ):
 
     # log to file to make midnight crashes and stalls more dealable with
@@ -880,6 +1193,10 @@ def tune_em_all(
     fh.setFormatter(formatter)
     logger.addHandler(fh)
 
+    MEASURE_CORES[:] = measurement_cores(cores)
+    if len(MEASURE_CORES) > 0:
+        logger.info(f"measuring in parallel on cores {MEASURE_CORES}")
+
     # log optimized parameters separately
     param_log_path = path.join(project_root, PERSIST_DIR, algorithm, PERSIST_LOG_FILE)
     param_log = open(param_log_path, 'a')
@@ -893,27 +1210,38 @@ def tune_em_all(
         algorithm,
     )
 
-    (fwi_guess, fwiabc_guess) = find_initial_guess(project_root, algorithm, vectorized)
-    logger.info("Done with step 1\n")
+    if search == SEARCH_HILL_CLIMBING:
+        (fwi_guess, fwiabc_guess) = find_initial_guess(project_root, algorithm, vectorized)
+        logger.info("Done with step 1\n")
 
     for input_size in input_sizes:
-        factors = factors_of(input_size)
-        fwi_optimal = optimize_fwi(
-            project_root, algorithm, vectorized, fwi_guess, input_size, factors
-        )
-        logger.info("Done with step 2\n")
+        if search == SEARCH_SUCCESSIVE_HALVING:
+            fwt_optimal = successive_halving(
+                project_root, algorithm, vectorized, input_size, num_candidates, eta
+            )
+            # FWT uses the FWI unrolling factors for its first three phases
+            fwi_optimal = fwt_optimal[1:3]
+        else:
+            factors = factors_of(input_size)
+            fwi_optimal = optimize_fwi(
+                project_root, algorithm, vectorized, fwi_guess, input_size, factors
+            )
+            logger.info("Done with step 2\n")
 
-        l1_guess = get_l1_guess(algorithm, l2_cache_bytes, factors, fwi_guess, fwiabc_guess)
+            l1_guess = get_l1_guess(algorithm, l2_cache_bytes, factors, fwi_guess, fwiabc_guess)
 
-        fwt_optimal = optimize_fwt(
-            project_root,
-            algorithm,
-            vectorized,
-            tuple([l1_guess]) + fwi_guess + fwiabc_guess,
-            input_size,
-            factors,
-        )
-        logger.info("Done with step 3\n")
+            fwt_optimal = optimize_fwt(
+                project_root,
+                algorithm,
+                vectorized,
+                tuple([l1_guess]) + fwi_guess + fwiabc_guess,
+                input_size,
+                factors,
+            )
+            logger.info("Done with step 3\n")
+
+        trace_path = write_trace(project_root, algorithm, input_size)
+        logger.info(f"Stored the convergence trace for N = {input_size} in {trace_path}")
 
         clean_files(project_root)
         impl_fwi, p_impl_fwi, outpath_fwi_source = generate_fw(
@@ -937,6 +1265,9 @@ def tune_em_all(
             fwt_optimal,
         )
 
+        tunedb_path = store_tuned_parameters(project_root, algorithm, input_size, fwt_optimal)
+        logger.info(f"Stored the FWT parameters for N = {input_size} in {tunedb_path}")
+
         param_log.write(
             f"""
         Optimal parameters for N = {input_size}:
@@ -1035,4 +1366,8 @@ if __name__ == "__main__":
         args.input_sizes,
         args.l2_cache,
         args.run_measurements,
+        args.search,
+        args.candidates,
+        args.eta,
+        args.cores,
     )
@@ -0,0 +1,580 @@
+// Streaming comparator of result matrices, a native compare.py for large n, see README.md.
+//
+// Both files are read in chunks of whole rows, which are parsed and compared
+// by several threads, so the memory doesn't grow with n^2. Only the first
+// mismatches are kept.
+
+#include <ctype.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// magic number of the binary format, "FWM1" in a little-endian file
+#define BINARY_MAGIC 0x314d5746u
+// bytes read from a file per chunk
+#define CHUNK_BYTES (16 << 20)
+// rows compared by a thread at a time
+#define BLOCK_ROWS 16
+
+struct options
+{
+    double atol = 0.01; // as compare.py
+    double rtol = 1e-5; // as numpy.isclose
+    long mismatches = 10;
+    bool silent = false;
+    bool recursive = false;
+    int threads = 0;
+};
+
+// a mismatch at row i and column j
+struct mismatch
+{
+    long i, j;
+    double a, b;
+};
+
+// whole rows of a file, row r is data[start[r], start[r + 1])
+struct chunk
+{
+    std::string data;
+    std::vector<size_t> start;
+
+    long rows() const { return (long)start.size() - 1; }
+};
+
+/*
+ * A result matrix, either in the text format of the drivers (n, then one
+ * line of comma separated entries per row, empty entries are infinite) or in
+ * the binary format (the magic number, n as uint32, then the rows as
+ * doubles).
+ */
+class matrix_file
+{
+  public:
+    ~matrix_file()
+    {
+        if (f != NULL)
+        {
+            fclose(f);
+        }
+    }
+
+    // returns false and sets error if the file can't be read
+    bool open(const std::string &path)
+    {
+        f = fopen(path.c_str(), "rb");
+        if (f == NULL)
+        {
+            error = "couldn't open " + path;
+            return false;
+        }
+        uint32_t header[2];
+        if (fread(header, sizeof(header), 1, f) == 1 && header[0] == BINARY_MAGIC)
+        {
+            binary = true;
+            n = header[1];
+            return true;
+        }
+        rewind(f);
+        if (fscanf(f, "%ld", &n) != 1 || n < 0 || fgetc(f) != '\n')
+        {
+            error = "couldn't read n from " + path;
+            return false;
+        }
+        return true;
+    }
+
+    /*
+     * Reads the next rows rows into c. Returns false and sets error if the
+     * file has fewer rows.
+     */
+    bool read(long rows, chunk &c)
+    {
+        c.start.assign(1, 0);
+        if (binary)
+        {
+            size_t bytes = rows * n * sizeof(double);
+            c.data.resize(bytes);
+            if (fread(&c.data[0], 1, bytes, f) != bytes)
+            {
+                error = "fewer rows than n";
+                return false;
+            }
+            for (long r = 1; r <= rows; r++)
+            {
+                c.start.push_back(r * n * sizeof(double));
+            }
+            return true;
+        }
+
+        // rows that are already buffered
+        c.data.swap(rest);
+        rest.clear();
+        size_t scanned = 0;
+        while (c.rows() < rows)
+        {
+            const char *nl = (const char *)memchr(c.data.data() + scanned, '\n', c.data.size() - scanned);
+            if (nl != NULL)
+            {
+                scanned = nl - c.data.data() + 1;
+                c.start.push_back(scanned);
+                continue;
+            }
+            scanned = c.data.size();
+            size_t size = c.data.size();
+            c.data.resize(size + CHUNK_BYTES);
+            size_t got = fread(&c.data[size], 1, CHUNK_BYTES, f);
+            c.data.resize(size + got);
+            if (got == 0)
+            {
+                if (size > c.start.back())
+                {
+                    // last line without a newline
+                    c.data += '\n';
+                    continue;
+                }
+                error = "fewer rows than n";
+                return false;
+            }
+        }
+        rest.assign(c.data, c.start.back(), std::string::npos);
+        c.data.resize(c.start.back());
+        return true;
+    }
+
+    // false if there is more than white space after the last row
+    bool at_end()
+    {
+        if (binary)
+        {
+            return fgetc(f) == EOF;
+        }
+        int ch;
+        for (size_t i = 0; i < rest.size(); i++)
+        {
+            if (!isspace((unsigned char)rest[i]))
+            {
+                return false;
+            }
+        }
+        while ((ch = fgetc(f)) != EOF)
+        {
+            if (!isspace(ch))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * Parses the row [p, end) into the n entries of out. Entries that aren't
+     * numbers are infinite, as in compare.py. Returns false if the row has
+     * fewer than n entries, additional ones are ignored.
+     */
+    bool parse(const char *p, const char *end, double *out) const
+    {
+        if (binary)
+        {
+            memcpy(out, p, n * sizeof(double));
+            return true;
+        }
+        for (long j = 0; j < n; j++)
+        {
+            if (p >= end)
+            {
+                return false;
+            }
+            const char *q = p;
+            bool blank = true;
+            for (; q < end && *q != ',' && *q != '\n'; q++)
+            {
+                blank = blank && isspace((unsigned char)*q);
+            }
+            out[j] = blank ? INFINITY : number(p, q);
+            p = q + 1;
+        }
+        return true;
+    }
+
+    // number of rows of roughly CHUNK_BYTES
+    long chunk_rows() const
+    {
+        long bytes = binary ? n * sizeof(double) : n * 8;
+        return std::max(1l, CHUNK_BYTES / std::max(1l, bytes));
+    }
+
+    long n = 0;
+    std::string error;
+
+  private:
+    // the entry [p, q), which isn't blank, infinite if it isn't a number such as "abc" or "1.5x"
+    static double number(const char *p, const char *q)
+    {
+        // fast path for the plain decimals of the drivers, the division of
+        // exact doubles is rounded as strtod
+        static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15};
+        const char *s = p;
+        bool negative = *s == '-';
+        s += negative;
+        uint64_t m = 0;
+        int digits = 0, decimals = 0;
+        for (; s < q && *s >= '0' && *s <= '9'; s++, digits++)
+        {
+            m = m * 10 + (*s - '0');
+        }
+        if (s < q && *s == '.')
+        {
+            for (s++; s < q && *s >= '0' && *s <= '9'; s++, digits++, decimals++)
+            {
+                m = m * 10 + (*s - '0');
+            }
+        }
+        if (s == q && digits > 0 && digits <= 15)
+        {
+            double x = m / pow10[decimals];
+            return negative ? -x : x;
+        }
+
+        char *e;
+        double x = strtod(p, &e);
+        if (e == p || e > q)
+        {
+            return INFINITY;
+        }
+        for (; e < q; e++)
+        {
+            if (!isspace((unsigned char)*e))
+            {
+                return INFINITY;
+            }
+        }
+        return x;
+    }
+
+    FILE *f = NULL;
+    bool binary = false;
+    std::string rest;
+};
+
+// numpy.isclose(a, b, rtol, atol): infinities are only close to themselves, nan to nothing
+static inline bool close(double a, double b, const options &o)
+{
+    if (!isfinite(a) || !isfinite(b))
+    {
+        return a == b;
+    }
+    return fabs(a - b) <= o.atol + o.rtol * fabs(b);
+}
+
+// runs f(b) for the blocks b = 0 .. blocks - 1 on threads threads
+template <class F>
+static void parallel_for(long blocks, int threads, F f)
+{
+    std::atomic<long> next(0);
+    auto work = [&]() {
+        for (long b = next++; b < blocks; b = next++)
+        {
+            f(b);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads && t < blocks; t++)
+    {
+        pool.emplace_back(work);
+    }
+    work();
+    for (std::thread &t : pool)
+    {
+        t.join();
+    }
+}
+
+/*
+ * Compares the files a and b. Returns 0 if they are equal, 1 if they differ
+ * and 2 if they can't be read. *count is set to the number of mismatches,
+ * first to the first o.mismatches of them in row-major order.
+ */
+static int compare(const std::string &path_a, const std::string &path_b, const options &o, long *count,
+                   std::vector<mismatch> *first, std::string *error)
+{
+    matrix_file a, b;
+    if (!a.open(path_a) || !b.open(path_b))
+    {
+        *error = a.error.empty() ? b.error : a.error;
+        return 2;
+    }
+    if (a.n != b.n)
+    {
+        *error = "incompatible matrix dimensions: " + std::to_string(a.n) + " and " + std::to_string(b.n);
+        return 2;
+    }
+    const long n = a.n;
+    const long rows = std::min(a.chunk_rows(), b.chunk_rows());
+
+    *count = 0;
+    first->clear();
+    chunk ca, cb;
+    for (long i0 = 0; i0 < n; i0 += rows)
+    {
+        long r = std::min(rows, n - i0);
+        if (!a.read(r, ca))
+        {
+            *error = path_a + ": " + a.error;
+            return 2;
+        }
+        if (!b.read(r, cb))
+        {
+            *error = path_b + ": " + b.error;
+            return 2;
+        }
+
+        long blocks = (r + BLOCK_ROWS - 1) / BLOCK_ROWS;
+        std::vector<std::vector<mismatch>> found(blocks);
+        std::vector<long> counts(blocks, 0);
+        std::atomic<long> malformed(-1);
+        parallel_for(blocks, o.threads, [&](long blk) {
+            std::vector<double> x(n), y(n);
+            for (long k = blk * BLOCK_ROWS; k < std::min(r, (blk + 1) * BLOCK_ROWS); k++)
+            {
+                if (!a.parse(ca.data.data() + ca.start[k], ca.data.data() + ca.start[k + 1], x.data()) ||
+                    !b.parse(cb.data.data() + cb.start[k], cb.data.data() + cb.start[k + 1], y.data()))
+                {
+                    malformed = i0 + k;
+                    return;
+                }
+                for (long j = 0; j < n; j++)
+                {
+                    if (!close(x[j], y[j], o))
+                    {
+                        if ((long)found[blk].size() < o.mismatches)
+                        {
+                            found[blk].push_back({i0 + k, j, x[j], y[j]});
+                        }
+                        counts[blk]++;
+                    }
+                }
+            }
+        });
+        if (malformed >= 0)
+        {
+            *error = "row " + std::to_string(malformed.load()) + " has fewer than n entries";
+            return 2;
+        }
+        for (long blk = 0; blk < blocks; blk++)
+        {
+            *count += counts[blk];
+            for (const mismatch &m : found[blk])
+            {
+                if ((long)first->size() < o.mismatches)
+                {
+                    first->push_back(m);
+                }
+            }
+        }
+    }
+    bool a_end = a.at_end(), b_end = b.at_end();
+    if (!a_end || !b_end)
+    {
+        *error = (a_end ? path_b : path_a) + ": more than n rows";
+        return 2;
+    }
+    return *count == 0 ? 0 : 1;
+}
+
+static void print_mismatches(long count, const std::vector<mismatch> &first, const char *indent)
+{
+    for (const mismatch &m : first)
+    {
+        printf("%s(%ld, %ld): %g and %g differ by %g\n", indent, m.i, m.j, m.a, m.b, fabs(m.a - m.b));
+    }
+    if (count > (long)first.size())
+    {
+        printf("%s... %ld mismatches in total\n", indent, count);
+    }
+}
+
+// pairs name.X.out.txt with name.X.ref.txt in every directory below root, as compare.py -r
+static int compare_recursive(const std::string &root, const options &o)
+{
+    namespace fs = std::filesystem;
+    std::map<std::string, std::vector<std::string>> dirs;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec))
+    {
+        if (it->is_regular_file())
+        {
+            dirs[it->path().parent_path().string()].push_back(it->path().filename().string());
+        }
+    }
+    if (ec)
+    {
+        printf("unable to read %s: %s\n", root.c_str(), ec.message().c_str());
+        return 2;
+    }
+
+    printf("\n");
+    int passed = 0, total = 0;
+    for (auto &[dir, files] : dirs)
+    {
+        std::sort(files.begin(), files.end());
+        size_t pos = dir.find("testcases");
+        std::string name = pos == std::string::npos ? dir : dir.substr(pos);
+        printf("Directory:%40s:\n===========%s=\n", name.c_str(), std::string(40, '=').c_str());
+
+        bool compared = false;
+        for (size_t f = 0; f + 1 < files.size(); f++)
+        {
+            // stem.algo.out.txt followed by stem.algo.ref.txt
+            const std::string &x = files[f], &y = files[f + 1];
+            size_t dot = x.find('.');
+            if (dot == std::string::npos || x.size() < 8 || x.compare(x.size() - 8, 8, ".out.txt") != 0)
+            {
+                continue;
+            }
+            std::string prefix = x.substr(0, x.size() - 8);
+            if (y != prefix + ".ref.txt" || prefix.find('.', dot + 1) != std::string::npos)
+            {
+                continue;
+            }
+            options po = o;
+            if (prefix.compare(dot, std::string::npos, ".tc") == 0)
+            {
+                po.atol = 0;
+            }
+            long count;
+            std::vector<mismatch> first;
+            std::string error;
+            int res = compare(dir + "/" + x, dir + "/" + y, po, &count, &first, &error);
+            printf("- %-46s %s\n", (prefix + ":").c_str(), res == 0 ? "\033[92mPASS\033[0m" : "\033[93mFAIL\033[0m");
+            if (!o.silent)
+            {
+                if (res == 2)
+                {
+                    printf("    %s\n", error.c_str());
+                }
+                print_mismatches(count, first, "    ");
+            }
+            total++;
+            passed += res == 0;
+            compared = true;
+        }
+        if (!compared)
+        {
+            printf("- %-45s \033[93mFAIL\033[0m\n", "No testcases found:");
+        }
+        printf("\n");
+    }
+    if (total == 0)
+    {
+        printf("No Testcases Found!\n");
+        return 2;
+    }
+    printf("%d of %d tests (%.0f%%) passed!\n", passed, total, 100.0 * passed / total);
+    return passed == total ? 0 : 1;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "call as: %s [options] matrix1 matrix2\n"
+            "         %s [options] -r directory\n"
+            "  -p, --precision P    absolute tolerance, inf to only compare the infinite entries (default 0.01)\n"
+            "      --rtol R         relative tolerance, as numpy.isclose (default 1e-5)\n"
+            "  -k, --mismatches K   number of mismatches to print (default 10)\n"
+            "  -s, --silent         don't print the result and the mismatches\n"
+            "  -r, --recursive      compare every out- and reference-file below the directory\n"
+            "  -j, --threads T      number of threads (default all cores)\n",
+            name, name);
+}
+
+int main(int argc, char **argv)
+{
+    options o;
+    static const struct option long_options[] = {
+        {"precision", required_argument, NULL, 'p'},
+        {"rtol", required_argument, NULL, 'R'},
+        {"mismatches", required_argument, NULL, 'k'},
+        {"silent", no_argument, NULL, 's'},
+        {"recursive", no_argument, NULL, 'r'},
+        {"threads", required_argument, NULL, 'j'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "p:k:srj:h", long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'p':
+            o.atol = strcmp(optarg, "inf") == 0 ? INFINITY : atof(optarg);
+            break;
+        case 'R':
+            o.rtol = atof(optarg);
+            break;
+        case 'k':
+            o.mismatches = atol(optarg);
+            break;
+        case 's':
+            o.silent = true;
+            break;
+        case 'r':
+            o.recursive = true;
+            break;
+        case 'j':
+            o.threads = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (o.threads <= 0)
+    {
+        o.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (o.recursive)
+    {
+        if (argc - optind != 1)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        return compare_recursive(argv[optind], o);
+    }
+    if (argc - optind != 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    long count;
+    std::vector<mismatch> first;
+    std::string error;
+    int res = compare(argv[optind], argv[optind + 1], o, &count, &first, &error);
+    if (res == 2)
+    {
+        printf("unable to read input: %s\n", error.c_str());
+        return 2;
+    }
+    if (!o.silent)
+    {
+        print_mismatches(count, first, "");
+        printf("%s and %s are %sequal!\n", argv[optind], argv[optind + 1], res == 0 ? "" : "not ");
+    }
+    return res;
+}
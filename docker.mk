@@ -3,267 +3,485 @@ SHELL=/bin/bash
 # It should contain all the rules for building all the things.
 # We get the following enironment variables passed from the local dockerfile:
 #  - MAKE_BUILD_DIR
+#  - MAKE_BUILD_NAME
+#  - MAKE_CFLAGS
+#  - MAKE_COUNTERS
 
 BUILD_DIR=$(MAKE_BUILD_DIR)
 BUILD_NAME=$(MAKE_BUILD_NAME)
 #static is needed for shared libs only present in the build container
 CFLAGS=$(MAKE_CFLAGS) -I /usr/local/include -static
 LDFLAGS:=/usr/local/lib/libpapi.a -lm
+# counter backend of the benchmark harness: papi (default) or perf, which
+# uses perf_event_open instead and doesn't need PAPI (see generic/harness)
+COUNTERS=$(MAKE_COUNTERS)
+ifeq ($(COUNTERS),perf)
+CFLAGS+=-DHARNESS_PERF
+LDFLAGS:=-lm
+endif
+# number of generated sources compiled in parallel
+JOBS:=$(shell nproc)
 
 # Topmost rule must be to build the optimized C code
 
 # generic
-gg-c-vector-tiles-clang: generic/c/*.c generic/c/impl/*_vector-tiles*.c generic/c/impl/fw.h
+gg-c-vector-tiles-clang: generic/c/*.c generic/c/impl/*_vector-tiles*.c generic/c/impl/fw.h generic/harness/*
 	cd generic/c/impl; \
-	for f in *_vector-tiles*.c; do \
-		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
-	done
+	ls *_vector-tiles*.c | xargs -P $(JOBS) -I {} bash -c 'f={}; echo $$f; clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../harness/harness.c ../../harness/counters.c ../../harness/phases.c ../../harness/pages.c ../main.c $(LDFLAGS)'
 
-gg-c-tile-clang: generic/c/*.c generic/c/impl/*_tile*.c generic/c/impl/fw.h
+gg-c-tile-clang: generic/c/*.c generic/c/impl/*_tile*.c generic/c/impl/fw.h generic/harness/*
 	cd generic/c/impl; \
-	for f in *_tile*.c; do \
-		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
-	done
+	ls *_tile*.c | xargs -P $(JOBS) -I {} bash -c 'f={}; echo $$f; clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../harness/harness.c ../../harness/counters.c ../../harness/phases.c ../../harness/pages.c ../main.c $(LDFLAGS)'
 
-gg-c-vector-unroll-clang: generic/c/*.c generic/c/impl/*_vector-unroll*.c generic/c/impl/fw.h
+gg-c-vector-unroll-clang: generic/c/*.c generic/c/impl/*_vector-unroll*.c generic/c/impl/fw.h generic/harness/*
 	cd generic/c/impl; \
-	for f in *_vector-unroll*.c; do \
-		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
-	done
+	ls *_vector-unroll*.c | xargs -P $(JOBS) -I {} bash -c 'f={}; echo $$f; clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../harness/harness.c ../../harness/counters.c ../../harness/phases.c ../../harness/pages.c ../main.c $(LDFLAGS)'
 
-gg-c-unroll-clang: generic/c/*.c generic/c/impl/*_unroll*.c generic/c/impl/fw.h
+gg-c-unroll-clang: generic/c/*.c generic/c/impl/*_unroll*.c generic/c/impl/fw.h generic/harness/*
 	cd generic/c/impl; \
-	for f in *_unroll*.c; do \
-		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
-	done
+	ls *_unroll*.c | xargs -P $(JOBS) -I {} bash -c 'f={}; echo $$f; clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../harness/harness.c ../../harness/counters.c ../../harness/phases.c ../../harness/pages.c ../main.c $(LDFLAGS)'
 
 # fw - autotune vector tile
-fw-c-autotune-vector-tiles-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-tile.c shortest-path/c/impl/sp.h
+fw-c-autotune-vector-tiles-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-tile.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-vector-tile.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-vector-tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-autotune-vector-tile-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-tile.c shortest-path/c/impl/sp.h
+fw-c-autotune-vector-tile-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-tile.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-vector-tile.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-vector-tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - autotune vector unrolled
-fw-c-autotune-vector-unroll-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-unroll.c shortest-path/c/impl/sp.h
+fw-c-autotune-vector-unroll-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-unroll.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-autotune-vector-unroll-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-unroll.c shortest-path/c/impl/sp.h
+fw-c-autotune-vector-unroll-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-vector-unroll.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-vector-unroll.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-vector-unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - autotune tile
-fw-c-autotune-tile-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-tile.c shortest-path/c/impl/sp.h
+fw-c-autotune-tile-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-tile.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-tile.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-autotune-tile-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-tile.c shortest-path/c/impl/sp.h
+fw-c-autotune-tile-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-tile.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-tile.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - autotune unroll
-fw-c-autotune-unroll-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-unroll.c shortest-path/c/impl/sp.h
+fw-c-autotune-unroll-gcc: shortest-path/c/*.c shortest-path/c/impl/autotune-unroll.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-unroll.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-autotune-unroll-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-unroll.c shortest-path/c/impl/sp.h
+fw-c-autotune-unroll-clang: shortest-path/c/*.c shortest-path/c/impl/autotune-unroll.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-unroll.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/autotune-unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - vector tile
-fw-c-vector-tiles-gcc: shortest-path/c/*.c shortest-path/c/impl/vector-tiles.c shortest-path/c/impl/sp.h
+fw-c-vector-tiles-gcc: shortest-path/c/*.c shortest-path/c/impl/vector-tiles.c shortest-path/c/impl/sp.h generic/tunedb/* generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-vector-tiles-clang: shortest-path/c/*.c shortest-path/c/impl/vector-tiles.c shortest-path/c/impl/sp.h
+fw-c-vector-tiles-clang: shortest-path/c/*.c shortest-path/c/impl/vector-tiles.c shortest-path/c/impl/sp.h generic/tunedb/* generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # mm - vector tile
-mm-c-vector-tiles-gcc: max-min/c/*.c max-min/c/impl/vector-tiles.c max-min/c/impl/mm.h
+mm-c-vector-tiles-gcc: max-min/c/*.c max-min/c/impl/vector-tiles.c max-min/c/impl/mm.h generic/tunedb/* generic/harness/*
 	cd max-min/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-mm-c-vector-tiles-clang: max-min/c/*.c max-min/c/impl/vector-tiles.c max-min/c/impl/mm.h
+mm-c-vector-tiles-clang: max-min/c/*.c max-min/c/impl/vector-tiles.c max-min/c/impl/mm.h generic/tunedb/* generic/harness/*
 	cd max-min/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # tc - vector-tile
-tc-c-vector-tiles-gcc: transitive-closure/c/*.c transitive-closure/c/impl/vector-tiles.c transitive-closure/c/impl/tc.h
+tc-c-vector-tiles-gcc: transitive-closure/c/*.c transitive-closure/c/impl/vector-tiles.c transitive-closure/c/impl/tc.h generic/tunedb/* generic/harness/*
+	cd transitive-closure/c; \
+	gcc-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
+
+tc-c-vector-tiles-clang: transitive-closure/c/*.c transitive-closure/c/impl/vector-tiles.c transitive-closure/c/impl/tc.h generic/tunedb/* generic/harness/*
+	cd transitive-closure/c; \
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
+
+# fw - template tiles
+fw-c-template-tiles-gcc: shortest-path/c/*.c shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd shortest-path/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	gcc $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+fw-c-template-tiles-clang: shortest-path/c/*.c shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd shortest-path/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+# mm - template tiles
+mm-c-template-tiles-gcc: max-min/c/*.c max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd max-min/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	gcc $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+mm-c-template-tiles-clang: max-min/c/*.c max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd max-min/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+# tc - template tiles
+tc-c-template-tiles-gcc: transitive-closure/c/*.c transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd transitive-closure/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	gcc $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+tc-c-template-tiles-clang: transitive-closure/c/*.c transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd transitive-closure/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+# fw - template tiles, symmetric half storage for undirected graphs
+fw-c-template-symmetric-gcc: shortest-path/c/*.c shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd shortest-path/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	gcc $(CFLAGS) -DFW_SYMMETRIC -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+fw-c-template-symmetric-clang: shortest-path/c/*.c shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd shortest-path/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	clang-13 $(CFLAGS) -DFW_SYMMETRIC -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+# mm - template tiles, symmetric half storage for undirected graphs
+mm-c-template-symmetric-gcc: max-min/c/*.c max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd max-min/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	gcc $(CFLAGS) -DFW_SYMMETRIC -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+mm-c-template-symmetric-clang: max-min/c/*.c max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/tunedb/* generic/harness/*
+	cd max-min/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -c -o $(BUILD_DIR)/$(BUILD_NAME).o impl/template-tiles.cpp; \
+	clang-13 $(CFLAGS) -DFW_SYMMETRIC -o $(BUILD_DIR)/$(BUILD_NAME) $(BUILD_DIR)/$(BUILD_NAME).o ../../generic/tunedb/tunedb.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -lstdc++ -pthread; \
+	rm $(BUILD_DIR)/$(BUILD_NAME).o;
+
+# fw - template tiles autotuner
+fw-c-template-autotune-gcc: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/autotune.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/autotune.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+fw-c-template-autotune-clang: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/autotune.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/autotune.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# mm - template tiles autotuner
+mm-c-template-autotune-gcc: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/autotune.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/autotune.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+mm-c-template-autotune-clang: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/autotune.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/autotune.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# tc - template tiles autotuner
+tc-c-template-autotune-gcc: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/autotune.cpp generic/tunedb/* generic/harness/input.*
+	cd transitive-closure/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/autotune.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+tc-c-template-autotune-clang: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/autotune.cpp generic/tunedb/* generic/harness/input.*
+	cd transitive-closure/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/autotune.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# fw - template tiles batch benchmark
+fw-c-template-batch-gcc: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/batch.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/batch.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+fw-c-template-batch-clang: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/batch.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/batch.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# mm - template tiles batch benchmark
+mm-c-template-batch-gcc: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/batch.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/batch.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+mm-c-template-batch-clang: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/batch.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/batch.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# tc - template tiles batch benchmark
+tc-c-template-batch-gcc: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/batch.cpp generic/tunedb/* generic/harness/input.*
+	cd transitive-closure/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/batch.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+tc-c-template-batch-clang: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/batch.cpp generic/tunedb/* generic/harness/input.*
+	cd transitive-closure/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/batch.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# fw - template tiles query server
+fw-c-template-server-gcc: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/protocol.h generic/cpp/server.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/server.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+fw-c-template-server-clang: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/protocol.h generic/cpp/server.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/server.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# mm - template tiles query server
+mm-c-template-server-gcc: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/protocol.h generic/cpp/server.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/server.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+mm-c-template-server-clang: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/protocol.h generic/cpp/server.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/server.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# tc - template tiles query server
+tc-c-template-server-gcc: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/protocol.h generic/cpp/server.cpp generic/tunedb/* generic/harness/input.*
+	cd transitive-closure/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/server.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+tc-c-template-server-clang: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/protocol.h generic/cpp/server.cpp generic/tunedb/* generic/harness/input.*
 	cd transitive-closure/c; \
-	gcc-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/server.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
 
-tc-c-vector-tiles-clang: transitive-closure/c/*.c transitive-closure/c/impl/vector-tiles.c transitive-closure/c/impl/tc.h
+# fw - template tiles distributed benchmark
+fw-c-template-distributed-gcc: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/distributed.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/distributed.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+fw-c-template-distributed-clang: shortest-path/c/impl/template-tiles.cpp shortest-path/c/impl/sp.h generic/cpp/*.hpp generic/cpp/distributed.cpp generic/tunedb/* generic/harness/input.*
+	cd shortest-path/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/distributed.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# mm - template tiles distributed benchmark
+mm-c-template-distributed-gcc: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/distributed.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/distributed.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+mm-c-template-distributed-clang: max-min/c/impl/template-tiles.cpp max-min/c/impl/mm.h generic/cpp/*.hpp generic/cpp/distributed.cpp generic/tunedb/* generic/harness/input.*
+	cd max-min/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/distributed.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# tc - template tiles distributed benchmark
+tc-c-template-distributed-gcc: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/distributed.cpp generic/tunedb/* generic/harness/input.*
 	cd transitive-closure/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector-tiles.c main.c $(LDFLAGS);
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/distributed.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+tc-c-template-distributed-clang: transitive-closure/c/impl/template-tiles.cpp transitive-closure/c/impl/tc.h generic/cpp/*.hpp generic/cpp/distributed.cpp generic/tunedb/* generic/harness/input.*
+	cd transitive-closure/c; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) impl/template-tiles.cpp ../../generic/cpp/distributed.cpp ../../generic/tunedb/tunedb.c ../../generic/harness/input.c;
+
+# generic - cache and TLB simulator
+gg-c-cachesim-gcc: generic/cachesim/* generic/cpp/*.hpp generic/harness/phases.h
+	cd generic/cachesim; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) cachesim.cpp;
+
+gg-c-cachesim-clang: generic/cachesim/* generic/cpp/*.hpp generic/harness/phases.h
+	cd generic/cachesim; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) cachesim.cpp;
+
+# generic - native comparator
+gg-c-comparator-gcc: comparator/compare.cpp
+	cd comparator; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) compare.cpp;
+
+gg-c-comparator-clang: comparator/compare.cpp
+	cd comparator; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) compare.cpp;
+
+# generic - query server client
+gg-c-query-gcc: generic/cpp/query.cpp generic/cpp/protocol.h
+	cd generic/cpp; \
+	g++ $(CFLAGS) -std=c++17 -o $(BUILD_DIR)/$(BUILD_NAME) query.cpp;
+
+gg-c-query-clang: generic/cpp/query.cpp generic/cpp/protocol.h
+	cd generic/cpp; \
+	clang++-13 $(CFLAGS) -std=c++17 -o $(BUILD_DIR)/$(BUILD_NAME) query.cpp;
+
+# generic - native graph generator
+gg-c-generator-gcc: generator/graph_generator.cpp
+	cd generator; \
+	g++ $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) graph_generator.cpp;
+
+gg-c-generator-clang: generator/graph_generator.cpp
+	cd generator; \
+	clang++-13 $(CFLAGS) -std=c++17 -pthread -o $(BUILD_DIR)/$(BUILD_NAME) graph_generator.cpp;
 
 # tc - tile
-tc-c-tile-gcc: transitive-closure/c/*.c transitive-closure/c/impl/tile.c transitive-closure/c/impl/tc.h
+tc-c-tile-gcc: transitive-closure/c/*.c transitive-closure/c/impl/tile.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-tc-c-tile-clang: transitive-closure/c/*.c transitive-closure/c/impl/tile.c transitive-closure/c/impl/tc.h
+tc-c-tile-clang: transitive-closure/c/*.c transitive-closure/c/impl/tile.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # mm - tile
-mm-c-tile-gcc: max-min/c/*.c max-min/c/impl/tile.c max-min/c/impl/mm.h
+mm-c-tile-gcc: max-min/c/*.c max-min/c/impl/tile.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-mm-c-tile-clang: max-min/c/*.c max-min/c/impl/tile.c max-min/c/impl/mm.h
+mm-c-tile-clang: max-min/c/*.c max-min/c/impl/tile.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - tile
-fw-c-tile-gcc: shortest-path/c/*.c shortest-path/c/impl/tile.c shortest-path/c/impl/sp.h
+fw-c-tile-gcc: shortest-path/c/*.c shortest-path/c/impl/tile.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-tile-clang: shortest-path/c/*.c shortest-path/c/impl/tile.c shortest-path/c/impl/sp.h
+fw-c-tile-clang: shortest-path/c/*.c shortest-path/c/impl/tile.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/tile.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - vector
-fw-c-vector-gcc: shortest-path/c/*.c shortest-path/c/impl/vector.c shortest-path/c/impl/sp.h
+fw-c-vector-gcc: shortest-path/c/*.c shortest-path/c/impl/vector.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-vector-clang: shortest-path/c/*.c shortest-path/c/impl/vector.c shortest-path/c/impl/sp.h
+fw-c-vector-clang: shortest-path/c/*.c shortest-path/c/impl/vector.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - naive
-fw-c-naive-gcc: shortest-path/c/*.c shortest-path/c/impl/naive.c shortest-path/c/impl/sp.h
+fw-c-naive-gcc: shortest-path/c/*.c shortest-path/c/impl/naive.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-naive-clang: shortest-path/c/*.c shortest-path/c/impl/naive.c shortest-path/c/impl/sp.h
+fw-c-naive-clang: shortest-path/c/*.c shortest-path/c/impl/naive.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - unroll
-fw-c-unroll-gcc: shortest-path/c/*.c shortest-path/c/impl/unroll.c shortest-path/c/impl/sp.h
+fw-c-unroll-gcc: shortest-path/c/*.c shortest-path/c/impl/unroll.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-unroll-clang: shortest-path/c/*.c shortest-path/c/impl/unroll.c shortest-path/c/impl/sp.h
+fw-c-unroll-clang: shortest-path/c/*.c shortest-path/c/impl/unroll.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - cache blocking
-fw-c-cache-blocking-gcc: shortest-path/c/*.c shortest-path/c/impl/cache_blocking.c shortest-path/c/impl/sp.h
+fw-c-cache-blocking-gcc: shortest-path/c/*.c shortest-path/c/impl/cache_blocking.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/cache_blocking.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/cache_blocking.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-fw-c-cache-blocking-clang: shortest-path/c/*.c shortest-path/c/impl/cache_blocking.c shortest-path/c/impl/sp.h
+fw-c-cache-blocking-clang: shortest-path/c/*.c shortest-path/c/impl/cache_blocking.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/cache_blocking.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/cache_blocking.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # fw - autotuning
-fw-c-autotune-gcc: shortest-path/c/*.c shortest-path/c/impl/fw_c-autotune*.c shortest-path/c/impl/sp.h
+fw-c-autotune-gcc: shortest-path/c/*.c shortest-path/c/impl/fw_c-autotune*.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c/impl; \
 	for f in fw_c-autotune*.c; do \
 		echo $$f; \
-		gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
+		gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../../generic/harness/harness.c ../../../generic/harness/counters.c ../../../generic/harness/phases.c ../../../generic/harness/pages.c ../../../generic/harness/input.c ../../../generic/harness/output.c ../main.c $(LDFLAGS); \
 	done
 
-fw-c-autotune-clang: shortest-path/c/*.c shortest-path/c/impl/fw_c-autotune*.c shortest-path/c/impl/sp.h
+fw-c-autotune-clang: shortest-path/c/*.c shortest-path/c/impl/fw_c-autotune*.c shortest-path/c/impl/sp.h generic/harness/*
 	cd shortest-path/c/impl; \
 	for f in fw_c-autotune*.c; do \
 		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
+		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../../generic/harness/harness.c ../../../generic/harness/counters.c ../../../generic/harness/phases.c ../../../generic/harness/pages.c ../../../generic/harness/input.c ../../../generic/harness/output.c ../main.c $(LDFLAGS); \
 	done
 
+# tc - strongly connected components and bitset rows
+tc-c-scc-bitset-gcc: transitive-closure/c/*.c transitive-closure/c/impl/scc-bitset.c transitive-closure/c/impl/tc.h generic/harness/*
+	cd transitive-closure/c; \
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/scc-bitset.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -pthread;
+
+tc-c-scc-bitset-clang: transitive-closure/c/*.c transitive-closure/c/impl/scc-bitset.c transitive-closure/c/impl/tc.h generic/harness/*
+	cd transitive-closure/c; \
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/scc-bitset.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS) -pthread;
+
 # tc - vector
-tc-c-vector-gcc: transitive-closure/c/*.c transitive-closure/c/impl/vector.c transitive-closure/c/impl/tc.h
+tc-c-vector-gcc: transitive-closure/c/*.c transitive-closure/c/impl/vector.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-tc-c-vector-clang: transitive-closure/c/*.c transitive-closure/c/impl/vector.c transitive-closure/c/impl/tc.h
+tc-c-vector-clang: transitive-closure/c/*.c transitive-closure/c/impl/vector.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c main.c $(LDFLAGS)
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS)
 
 # tc - naive
-tc-c-naive-gcc: transitive-closure/c/*.c transitive-closure/c/impl/naive.c transitive-closure/c/impl/tc.h
+tc-c-naive-gcc: transitive-closure/c/*.c transitive-closure/c/impl/naive.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-tc-c-naive-clang: transitive-closure/c/*.c transitive-closure/c/impl/naive.c transitive-closure/c/impl/tc.h
+tc-c-naive-clang: transitive-closure/c/*.c transitive-closure/c/impl/naive.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c main.c $(LDFLAGS)
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS)
 
 # tc - unroll
-tc-c-unroll-gcc: transitive-closure/c/*.c transitive-closure/c/impl/unroll.c transitive-closure/c/impl/tc.h
+tc-c-unroll-gcc: transitive-closure/c/*.c transitive-closure/c/impl/unroll.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-tc-c-unroll-clang: transitive-closure/c/*.c transitive-closure/c/impl/unroll.c transitive-closure/c/impl/tc.h
+tc-c-unroll-clang: transitive-closure/c/*.c transitive-closure/c/impl/unroll.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c main.c $(LDFLAGS)
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS)
 
 # tc - autotuning
-tc-c-autotune-gcc: transitive-closure/c/*.c transitive-closure/c/impl/tc_c-autotune*.c transitive-closure/c/impl/tc.h
+tc-c-autotune-gcc: transitive-closure/c/*.c transitive-closure/c/impl/tc_c-autotune*.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c/impl; \
 	for f in tc_c-autotune*.c; do \
 		echo $$f; \
-		gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
+		gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../../generic/harness/harness.c ../../../generic/harness/counters.c ../../../generic/harness/phases.c ../../../generic/harness/pages.c ../../../generic/harness/input.c ../../../generic/harness/output.c ../main.c $(LDFLAGS); \
 	done
 
-tc-c-autotune-clang: transitive-closure/c/*.c transitive-closure/c/impl/tc_c-autotune*.c transitive-closure/c/impl/tc.h
+tc-c-autotune-clang: transitive-closure/c/*.c transitive-closure/c/impl/tc_c-autotune*.c transitive-closure/c/impl/tc.h generic/harness/*
 	cd transitive-closure/c/impl; \
 	for f in tc_c-autotune*.c; do \
 		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
+		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../../generic/harness/harness.c ../../../generic/harness/counters.c ../../../generic/harness/phases.c ../../../generic/harness/pages.c ../../../generic/harness/input.c ../../../generic/harness/output.c ../main.c $(LDFLAGS); \
 	done
 
 # max-min: naive
-mm-c-naive-gcc: max-min/c/*.c max-min/c/impl/naive.c max-min/c/impl/mm.h
+mm-c-naive-gcc: max-min/c/*.c max-min/c/impl/naive.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-mm-c-naive-clang: max-min/c/*.c max-min/c/impl/naive.c max-min/c/impl/mm.h
+mm-c-naive-clang: max-min/c/*.c max-min/c/impl/naive.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/naive.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # max-min: unroll
-mm-c-unroll-gcc: max-min/c/*.c max-min/c/impl/unroll.c max-min/c/impl/mm.h
+mm-c-unroll-gcc: max-min/c/*.c max-min/c/impl/unroll.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-mm-c-unroll-clang: max-min/c/*.c max-min/c/impl/unroll.c max-min/c/impl/mm.h
+mm-c-unroll-clang: max-min/c/*.c max-min/c/impl/unroll.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/unroll.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # max-min: vector
-mm-c-vector-gcc: max-min/c/*.c max-min/c/impl/vector.c max-min/c/impl/mm.h
+mm-c-vector-gcc: max-min/c/*.c max-min/c/impl/vector.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c main.c $(LDFLAGS);
+	gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
-mm-c-vector-clang: max-min/c/*.c max-min/c/impl/vector.c max-min/c/impl/mm.h
+mm-c-vector-clang: max-min/c/*.c max-min/c/impl/vector.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c; \
-	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c main.c $(LDFLAGS);
+	clang-13 $(CFLAGS) -o $(BUILD_DIR)/$(BUILD_NAME) impl/vector.c ../../generic/harness/harness.c ../../generic/harness/counters.c ../../generic/harness/phases.c ../../generic/harness/pages.c ../../generic/harness/input.c ../../generic/harness/output.c main.c $(LDFLAGS);
 
 # max-min - autotuning
-mm-c-autotune-gcc: max-min/c/*.c max-min/c/impl/mm_c-autotune*.c max-min/c/impl/mm.h
+mm-c-autotune-gcc: max-min/c/*.c max-min/c/impl/mm_c-autotune*.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c/impl; \
 	for f in mm_c-autotune*.c; do \
 		echo $$f; \
-		gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
+		gcc-11 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../../generic/harness/harness.c ../../../generic/harness/counters.c ../../../generic/harness/phases.c ../../../generic/harness/pages.c ../../../generic/harness/input.c ../../../generic/harness/output.c ../main.c $(LDFLAGS); \
 	done
 
-mm-c-autotune-clang: max-min/c/*.c max-min/c/impl/mm_c-autotune*.c max-min/c/impl/mm.h
+mm-c-autotune-clang: max-min/c/*.c max-min/c/impl/mm_c-autotune*.c max-min/c/impl/mm.h generic/harness/*
 	cd max-min/c/impl; \
 	for f in mm_c-autotune*.c; do \
 		echo $$f; \
-		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../main.c $(LDFLAGS); \
+		clang-13 $(CFLAGS) -o $(BUILD_DIR)/$${f%.*} "$$f" ../../../generic/harness/harness.c ../../../generic/harness/counters.c ../../../generic/harness/phases.c ../../../generic/harness/pages.c ../../../generic/harness/input.c ../../../generic/harness/output.c ../main.c $(LDFLAGS); \
 	done
 
 # fw - go ref
@@ -10,6 +10,7 @@ parser.add_argument("--max-n", help="maximum n for the generated testcases", typ
 parser.add_argument("-d", "--density", action="count", help="increase density (not passed m=n log(n), -d: m=n log(n)^2, -dd: m=n ln(n)^2, -ddd: m=n^2/2")
 parser.add_argument("--exp2", help="double n in every step (cannot be used with --step)", action="store_true")
 parser.add_argument("--step", help="step by which to increase n in every step (cannot be used with --exp2)", type=int)
+parser.add_argument("--native", help="path of the native generator (graph_generator.cpp) to use instead of graph_generator.py", type=str)
 
 args = parser.parse_args()
 
@@ -31,7 +32,8 @@ while n <= args.max_n:
 
     folder = "{}/n{}".format(args.output_folder, n)
     subprocess.call(["mkdir", "-p", folder])
-    subprocess.call(["python3", "generator/graph_generator.py", "-d", "-n", "{}".format(n), "-m", "{}".format(m), "-o", "{}/graph_n{}_e{}_min{}_max{}_dense{}_connected.in.txt".format(folder, n, m, min_weight, max_weight, args.density), "--min-weight", "{}".format(min_weight), "--max-weight", "{}".format(max_weight), "--connected"])
+    generator = [args.native] if args.native else ["python3", "generator/graph_generator.py"]
+    subprocess.call(generator + ["-d", "-n", "{}".format(n), "-m", "{}".format(m), "-o", "{}/graph_n{}_e{}_min{}_max{}_dense{}_connected.in.txt".format(folder, n, m, min_weight, max_weight, args.density), "--min-weight", "{}".format(min_weight), "--max-weight", "{}".format(max_weight), "--connected"])
 
     if args.exp2:
         n *=2
@@ -0,0 +1,863 @@
+// Native test-case generator, a faster graph_generator.py for large n, see README.md.
+//
+// The edges are kept in an adjacency bitmap. The rows are split into blocks
+// of BLOCK_ROWS rows, each block draws its edges with its own random number
+// generator, so the blocks can be generated in parallel and the graph only
+// depends on the seed, not on the number of threads. An edge only sets bits
+// in the row of its block. The weights are a function of the seed and the
+// edge, so they don't have to be stored and the rows can be written in
+// parallel as well.
+
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define BLOCK_ROWS 64
+// rows formatted by a thread before they are written
+#define WRITE_ROWS 64
+// attempts per edge before a model gives up, e.g. if m exceeds what it can reach
+#define MAX_ATTEMPTS 1000
+
+// magic numbers of the binary formats, "FWG1" and "FWC1" in a little-endian file
+#define BINARY_MAGIC 0x31475746u
+#define CSR_MAGIC 0x31435746u
+
+// splitmix64, also used to derive the seeds of the blocks and of the weights
+static inline uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// small random number generator, a UniformRandomBitGenerator for <random>
+struct rng
+{
+    typedef uint64_t result_type;
+    uint64_t state;
+
+    explicit rng(uint64_t seed) : state(seed) {}
+    static constexpr uint64_t min() { return 0; }
+    static constexpr uint64_t max() { return ~(uint64_t)0; }
+    uint64_t operator()()
+    {
+        state += 0x9e3779b97f4a7c15ull;
+        return mix(state);
+    }
+    // uniform in [0, 1)
+    double uniform() { return ((*this)() >> 11) * 0x1.0p-53; }
+    // uniform in [0, n)
+    uint64_t below(uint64_t n) { return (uint64_t)(uniform() * n); }
+    double normal(double mu, double sigma)
+    {
+        // Box-Muller
+        double u = 1 - uniform();
+        double v = uniform();
+        return mu + sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+    }
+};
+
+// of the output file
+enum format
+{
+    TEXT,   // the dense matrix of graph_generator.py
+    EDGES,  // text edge list
+    BINARY, // binary edge list
+    CSR,    // binary compressed sparse rows
+};
+
+enum model
+{
+    GNM,
+    DAG,
+    POWERLAW,
+    GRID,
+};
+
+struct options
+{
+    long n = 30;
+    long m = 42;
+    int density = -1;
+    model type = GNM;
+    bool directed = false;
+    double gamma = 2.5;
+    double min_weight = 0.0;
+    double max_weight = 10.0;
+    bool connected = false;
+    bool no_neg_cycle = false;
+    uint64_t seed = 0;
+    bool seeded = false;
+    int threads = 0;
+    format output_format = TEXT;
+    const char *output = "graph.txt";
+    long tries = 10000;
+};
+
+struct graph
+{
+    long n;
+    bool directed;
+    size_t words; // per row
+    // row u holds the edges u -> v, undirected graphs only those with u < v
+    std::vector<uint64_t> bits;
+    uint64_t seed; // of the weights
+
+    graph(long n, bool directed) : n(n), directed(directed), words((n + 63) / 64), bits(n * words) {}
+
+    bool get(long u, long v) const { return bits[u * words + v / 64] >> (v % 64) & 1; }
+    void set(long u, long v) { bits[u * words + v / 64] |= (uint64_t)1 << (v % 64); }
+    void clear(long u, long v) { bits[u * words + v / 64] &= ~((uint64_t)1 << (v % 64)); }
+
+    // edge u -> v in both directions of undirected graphs
+    bool edge(long u, long v) const { return directed || u < v ? get(u, v) : get(v, u); }
+
+    long edges() const
+    {
+        long m = 0;
+        for (uint64_t w : bits)
+        {
+            m += __builtin_popcountll(w);
+        }
+        return m;
+    }
+};
+
+/*
+ * Weight of the edge u -> v: normally distributed with the mean and standard
+ * deviation of graph_generator.py, redrawn until it lies within the bounds.
+ * Both directions of an undirected edge have the same weight.
+ */
+static double weight(const graph &g, const options &o, long u, long v)
+{
+    if (!g.directed && u > v)
+    {
+        std::swap(u, v);
+    }
+    rng r(mix(g.seed ^ mix((uint64_t)u * g.n + v)));
+    double mu = (o.max_weight - o.min_weight) / 2.0;
+    double sigma = (o.max_weight - o.min_weight) / 3.0;
+    double w;
+    do
+    {
+        w = r.normal(mu, sigma);
+    } while (w < o.min_weight || w > o.max_weight);
+    return w;
+}
+
+// runs f(b) for the blocks b = 0 .. blocks - 1 on threads threads
+template <class F>
+static void parallel_for(long blocks, int threads, F f)
+{
+    std::atomic<long> next(0);
+    auto work = [&]() {
+        for (long b = next++; b < blocks; b = next++)
+        {
+            f(b);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads && t < blocks; t++)
+    {
+        pool.emplace_back(work);
+    }
+    work();
+    for (std::thread &t : pool)
+    {
+        t.join();
+    }
+}
+
+/*
+ * Splits m edges over blocks with the given capacities (number of possible
+ * edges) and masses (relative probability of their edges). The counts are
+ * drawn one block after the other as binomials of the remaining edges, which
+ * is the multinomial distribution instead of the exact hypergeometric one,
+ * clamped to what the capacities allow.
+ */
+static std::vector<long> split_edges(long m, const std::vector<double> &capacity, const std::vector<double> &mass,
+                                     rng &r)
+{
+    size_t blocks = capacity.size();
+    std::vector<long> counts(blocks);
+    double cap_left = 0, mass_left = 0;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        cap_left += capacity[b];
+        mass_left += mass[b];
+    }
+    long left = m;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        long k = left;
+        if (b + 1 < blocks && mass_left > 0)
+        {
+            std::binomial_distribution<long> d(left, std::min(1.0, mass[b] / mass_left));
+            k = d(r);
+        }
+        cap_left -= capacity[b];
+        mass_left -= mass[b];
+        k = std::max(k, left - (long)cap_left);
+        k = std::min(k, std::min(left, (long)capacity[b]));
+        counts[b] = k;
+        left -= k;
+    }
+    return counts;
+}
+
+/*
+ * Uniform sample of k of the possible edges row[i] -> row[j] with i in
+ * [first, last), which are those with j > i for triangular graphs (undirected
+ * and DAG), any j != i otherwise. row maps positions to nodes, the identity
+ * except for DAGs. Blocks that are more than half full draw the edges they
+ * don't have instead.
+ */
+static bool sample_uniform(graph &g, const std::vector<long> &row, bool triangle, long first, long last, long k,
+                           rng &r)
+{
+    const long n = g.n;
+    double capacity = 0;
+    for (long i = first; i < last; i++)
+    {
+        capacity += triangle ? n - 1 - i : n - 1;
+    }
+    bool complement = k > capacity / 2;
+    if (complement)
+    {
+        for (long i = first; i < last; i++)
+        {
+            for (long j = triangle ? i + 1 : 0; j < n; j++)
+            {
+                if (j != i)
+                {
+                    g.set(row[i], row[j]);
+                }
+            }
+        }
+        k = (long)capacity - k;
+    }
+    long attempts = 0;
+    while (k > 0)
+    {
+        if (++attempts > MAX_ATTEMPTS * (k + 1000))
+        {
+            return false;
+        }
+        long i = first + r.below(last - first);
+        long j = r.below(n);
+        if (j == i || (triangle && j < i) || g.get(row[i], row[j]) == !complement)
+        {
+            continue;
+        }
+        if (complement)
+        {
+            g.clear(row[i], row[j]);
+        }
+        else
+        {
+            g.set(row[i], row[j]);
+        }
+        k--;
+    }
+    return true;
+}
+
+// G(n, m) and DAGs: m edges drawn uniformly, DAGs only along a random order of the nodes
+static bool generate_uniform(graph &g, const options &o, long m, rng &r)
+{
+    const long n = g.n;
+    bool triangle = !g.directed || o.type == DAG;
+    std::vector<long> row(n);
+    for (long i = 0; i < n; i++)
+    {
+        row[i] = i;
+    }
+    if (o.type == DAG)
+    {
+        std::shuffle(row.begin(), row.end(), r);
+    }
+
+    long blocks = (n + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    std::vector<double> capacity(blocks, 0);
+    for (long i = 0; i < n; i++)
+    {
+        capacity[i / BLOCK_ROWS] += triangle ? n - 1 - i : n - 1;
+    }
+    std::vector<long> counts = split_edges(m, capacity, capacity, r);
+
+    std::atomic<bool> ok(true);
+    uint64_t seed = r();
+    parallel_for(blocks, o.threads, [&](long b) {
+        rng br(mix(seed + b));
+        long first = b * BLOCK_ROWS;
+        long last = std::min(n, first + BLOCK_ROWS);
+        if (!sample_uniform(g, row, triangle, first, last, counts[b], br))
+        {
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+/*
+ * Chung-Lu graph with a power-law degree distribution: node u has the weight
+ * (u + 1)^(-1 / (gamma - 1)), and the m edges u -> v are drawn with
+ * probabilities proportional to the product of the weights of u and v,
+ * without loops and duplicates. Node 0 has the highest expected degree.
+ */
+static bool generate_powerlaw(graph &g, const options &o, long m, rng &r)
+{
+    const long n = g.n;
+    std::vector<double> w(n), cdf(n + 1, 0);
+    for (long u = 0; u < n; u++)
+    {
+        w[u] = pow(u + 1, -1 / (o.gamma - 1));
+        cdf[u + 1] = cdf[u] + w[u];
+    }
+
+    long blocks = (n + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    std::vector<double> capacity(blocks, 0), mass(blocks, 0);
+    for (long u = 0; u < n; u++)
+    {
+        // undirected edges are drawn in the row of their smaller node
+        capacity[u / BLOCK_ROWS] += g.directed ? n - 1 : n - 1 - u;
+        mass[u / BLOCK_ROWS] += w[u] * (g.directed ? cdf[n] - w[u] : cdf[n] - cdf[u + 1]);
+    }
+    std::vector<long> counts = split_edges(m, capacity, mass, r);
+
+    std::atomic<bool> ok(true);
+    uint64_t seed = r();
+    parallel_for(blocks, o.threads, [&](long b) {
+        rng br(mix(seed + b));
+        long first = b * BLOCK_ROWS;
+        long last = std::min(n, first + BLOCK_ROWS);
+        long attempts = 0;
+        for (long k = counts[b]; k > 0;)
+        {
+            if (++attempts > MAX_ATTEMPTS * (counts[b] + 1000))
+            {
+                ok = false;
+                return;
+            }
+            // u in the block and v anywhere, both proportional to their weights
+            double x = cdf[first] + br.uniform() * (cdf[last] - cdf[first]);
+            long u = std::min(last - 1, (long)(std::upper_bound(cdf.begin(), cdf.end(), x) - cdf.begin()) - 1);
+            long v = std::min(n - 1, (long)(std::upper_bound(cdf.begin(), cdf.end(), br.uniform() * cdf[n]) - cdf.begin()) - 1);
+            if (v == u || (!g.directed && v < u) || g.get(u, v))
+            {
+                continue;
+            }
+            g.set(u, v);
+            k--;
+        }
+    });
+    return ok;
+}
+
+// nodes on a grid of ceil(sqrt(n)) columns, connected to their horizontal and vertical neighbours
+static bool generate_grid(graph &g, const options &o)
+{
+    const long n = g.n;
+    const long cols = (long)ceil(sqrt((double)n));
+    parallel_for((n + BLOCK_ROWS - 1) / BLOCK_ROWS, o.threads, [&](long b) {
+        for (long u = b * BLOCK_ROWS; u < std::min(n, (b + 1) * BLOCK_ROWS); u++)
+        {
+            long neighbours[4] = {u % cols > 0 ? u - 1 : -1, u % cols < cols - 1 ? u + 1 : -1, u - cols, u + cols};
+            for (long v : neighbours)
+            {
+                if (v >= 0 && v < n && (g.directed || u < v))
+                {
+                    g.set(u, v);
+                }
+            }
+        }
+    });
+    return true;
+}
+
+// weak connectivity for directed graphs, as in graph_generator.py
+static bool is_connected(const graph &g)
+{
+    std::vector<long> parent(g.n);
+    for (long u = 0; u < g.n; u++)
+    {
+        parent[u] = u;
+    }
+    auto find = [&](long u) {
+        while (parent[u] != u)
+        {
+            u = parent[u] = parent[parent[u]];
+        }
+        return u;
+    };
+    long components = g.n;
+    for (long u = 0; u < g.n; u++)
+    {
+        for (size_t i = 0; i < g.words; i++)
+        {
+            for (uint64_t w = g.bits[u * g.words + i]; w != 0; w &= w - 1)
+            {
+                long a = find(u), b = find(i * 64 + __builtin_ctzll(w));
+                if (a != b)
+                {
+                    parent[a] = b;
+                    components--;
+                }
+            }
+        }
+    }
+    return components <= 1;
+}
+
+// Bellman-Ford from a virtual source connected to every node
+static bool has_negative_cycle(const graph &g, const options &o)
+{
+    if (o.min_weight >= 0)
+    {
+        return false;
+    }
+    struct edge
+    {
+        long u, v;
+        double w;
+    };
+    std::vector<edge> edges;
+    for (long u = 0; u < g.n; u++)
+    {
+        for (long v = 0; v < g.n; v++)
+        {
+            if (v != u && g.edge(u, v))
+            {
+                edges.push_back({u, v, weight(g, o, u, v)});
+            }
+        }
+    }
+    std::vector<double> dist(g.n, 0);
+    for (long i = 0; i < g.n; i++)
+    {
+        bool changed = false;
+        for (const edge &e : edges)
+        {
+            if (dist[e.u] + e.w < dist[e.v])
+            {
+                dist[e.v] = dist[e.u] + e.w;
+                changed = true;
+            }
+        }
+        if (!changed)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// appends w as "%.6f" does
+static void format_weight(std::string &s, double w)
+{
+    if (w < 0)
+    {
+        s += '-';
+        w = -w;
+    }
+    uint64_t x = (uint64_t)llround(w * 1e6);
+    char buf[32];
+    int i = sizeof(buf);
+    for (int d = 0; d < 6; d++)
+    {
+        buf[--i] = '0' + x % 10;
+        x /= 10;
+    }
+    buf[--i] = '.';
+    do
+    {
+        buf[--i] = '0' + x % 10;
+        x /= 10;
+    } while (x != 0);
+    s.append(buf + i, sizeof(buf) - i);
+}
+
+// rows of the text format of graph_generator.py, empty entries are missing edges
+static void format_text(const graph &g, const options &o, long u, std::string &s)
+{
+    for (long v = 0; v < g.n; v++)
+    {
+        if (v != 0)
+        {
+            s += ',';
+        }
+        if (v != u && g.edge(u, v))
+        {
+            format_weight(s, weight(g, o, u, v));
+        }
+    }
+    s += '\n';
+}
+
+// edges of row u in the text edge list: "u v w" per line
+static void format_edges(const graph &g, const options &o, long u, std::string &s)
+{
+    for (long v = 0; v < g.n; v++)
+    {
+        if (v != u && g.edge(u, v))
+        {
+            s += std::to_string(u);
+            s += ' ';
+            s += std::to_string(v);
+            s += ' ';
+            format_weight(s, weight(g, o, u, v));
+            s += '\n';
+        }
+    }
+}
+
+// edges of row u in the binary format: uint32 u, uint32 v and a double weight per edge
+static void format_binary(const graph &g, const options &o, long u, std::string &s)
+{
+    for (long v = 0; v < g.n; v++)
+    {
+        if (v != u && g.edge(u, v))
+        {
+            uint32_t ends[2] = {(uint32_t)u, (uint32_t)v};
+            double w = weight(g, o, u, v);
+            s.append((const char *)ends, sizeof(ends));
+            s.append((const char *)&w, sizeof(w));
+        }
+    }
+}
+
+// uint32 targets of row u of the CSR
+static void format_targets(const graph &g, const options &, long u, std::string &s)
+{
+    for (long v = 0; v < g.n; v++)
+    {
+        if (v != u && g.edge(u, v))
+        {
+            uint32_t target = v;
+            s.append((const char *)&target, sizeof(target));
+        }
+    }
+}
+
+// double weights of row u of the CSR
+static void format_weights(const graph &g, const options &o, long u, std::string &s)
+{
+    for (long v = 0; v < g.n; v++)
+    {
+        if (v != u && g.edge(u, v))
+        {
+            double w = weight(g, o, u, v);
+            s.append((const char *)&w, sizeof(w));
+        }
+    }
+}
+
+// writes the rows as formatted by format
+static void write_rows(const graph &g, const options &o, FILE *f,
+                       void (*format)(const graph &, const options &, long, std::string &))
+{
+    // the threads format a batch of chunks of WRITE_ROWS rows, which are then written in order
+    long chunks = (g.n + WRITE_ROWS - 1) / WRITE_ROWS;
+    long batch = std::max(1, o.threads) * 4;
+    std::vector<std::string> buffers(batch);
+    for (long first = 0; first < chunks; first += batch)
+    {
+        long count = std::min(batch, chunks - first);
+        parallel_for(count, o.threads, [&](long c) {
+            std::string &s = buffers[c];
+            s.clear();
+            long u0 = (first + c) * WRITE_ROWS;
+            for (long u = u0; u < std::min(g.n, u0 + WRITE_ROWS); u++)
+            {
+                format(g, o, u, s);
+            }
+        });
+        for (long c = 0; c < count; c++)
+        {
+            fwrite(buffers[c].data(), 1, buffers[c].size(), f);
+        }
+    }
+}
+
+static bool write_graph(const graph &g, const options &o)
+{
+    FILE *f = fopen(o.output, "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "couldn't open %s\n", o.output);
+        return false;
+    }
+    // undirected edges are listed in both directions, as in the matrix
+    uint64_t m = g.edges() * (g.directed ? 1 : 2);
+    uint32_t header[2] = {o.output_format == CSR ? CSR_MAGIC : BINARY_MAGIC, (uint32_t)g.n};
+    switch (o.output_format)
+    {
+    case TEXT:
+        fprintf(f, "%ld\n", g.n);
+        write_rows(g, o, f, format_text);
+        break;
+    case EDGES:
+        fprintf(f, "%ld %llu\n", g.n, (unsigned long long)m);
+        write_rows(g, o, f, format_edges);
+        break;
+    case BINARY:
+        fwrite(header, sizeof(header), 1, f);
+        fwrite(&m, sizeof(m), 1, f);
+        write_rows(g, o, f, format_binary);
+        break;
+    case CSR:
+    {
+        // the row offsets from the out-degrees, then the targets and the weights
+        std::vector<uint64_t> offsets(g.n + 1, 0);
+        parallel_for(g.n, o.threads, [&](long u) {
+            for (long v = 0; v < g.n; v++)
+            {
+                offsets[u + 1] += v != u && g.edge(u, v);
+            }
+        });
+        for (long u = 0; u < g.n; u++)
+        {
+            offsets[u + 1] += offsets[u];
+        }
+        fwrite(header, sizeof(header), 1, f);
+        fwrite(&m, sizeof(m), 1, f);
+        fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), f);
+        write_rows(g, o, f, format_targets);
+        write_rows(g, o, f, format_weights);
+        break;
+    }
+    }
+    return fclose(f) == 0;
+}
+
+// number of edges of the densities of generate_tests.py
+static long density_edges(long n, int density)
+{
+    switch (density)
+    {
+    case 3:
+        return (long)floor(n * n / 2.0);
+    case 2:
+        return n * (long)floor(pow(log((double)n * n), 2));
+    case 1:
+        return n * (long)floor(pow(log((double)n), 2));
+    default:
+        return n * (long)floor(log((double)n));
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "call as: %s [options]\n"
+            "  -n, --nodes N              number of nodes in the graph (default 30)\n"
+            "  -m, --edges M              number of edges in the graph (default 42)\n"
+            "      --density K            number of edges of generate_tests.py -d: 0: n log(n), 1: n log(n)^2,\n"
+            "                             2: n ln(n^2)^2, 3: n^2/2\n"
+            "  -t, --type TYPE            gnm (default), dag, powerlaw or grid\n"
+            "  -d, --directed             is the graph directed, always for dag\n"
+            "      --gamma G              exponent of the degree distribution of powerlaw (default 2.5)\n"
+            "      --min-weight W         minimum edge weight (default 0)\n"
+            "      --max-weight W         maximum edge weight (default 10)\n"
+            "      --connected            generated graph must be (weakly) connected\n"
+            "      --no-neg-cycle         generated graph must not contain a negative cycle\n"
+            "      --tries T              graphs to try for --connected and --no-neg-cycle (default 10000)\n"
+            "  -s, --seed S               seed of the graph (default random)\n"
+            "  -j, --threads T            number of threads (default all cores)\n"
+            "  -b, --binary               write the binary edge list instead of the text matrix\n"
+            "      --edge-list            write the text edge list instead of the text matrix\n"
+            "      --csr                  write the binary CSR instead of the text matrix\n"
+            "  -o, --output FILE          output file name (default graph.txt)\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    options o;
+    static const struct option long_options[] = {
+        {"nodes", required_argument, NULL, 'n'},
+        {"edges", required_argument, NULL, 'm'},
+        {"density", required_argument, NULL, 'D'},
+        {"type", required_argument, NULL, 't'},
+        {"directed", no_argument, NULL, 'd'},
+        {"gamma", required_argument, NULL, 'g'},
+        {"min-weight", required_argument, NULL, 'w'},
+        {"max-weight", required_argument, NULL, 'W'},
+        {"connected", no_argument, NULL, 'c'},
+        {"no-neg-cycle", no_argument, NULL, 'N'},
+        {"tries", required_argument, NULL, 'T'},
+        {"seed", required_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 'j'},
+        {"binary", no_argument, NULL, 'b'},
+        {"edge-list", no_argument, NULL, 'e'},
+        {"csr", no_argument, NULL, 'C'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "n:m:t:ds:j:bo:h", long_options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            o.n = atol(optarg);
+            break;
+        case 'm':
+            o.m = atol(optarg);
+            break;
+        case 'D':
+            o.density = atoi(optarg);
+            break;
+        case 't':
+            if (strcmp(optarg, "gnm") == 0)
+            {
+                o.type = GNM;
+            }
+            else if (strcmp(optarg, "dag") == 0)
+            {
+                o.type = DAG;
+            }
+            else if (strcmp(optarg, "powerlaw") == 0)
+            {
+                o.type = POWERLAW;
+            }
+            else if (strcmp(optarg, "grid") == 0)
+            {
+                o.type = GRID;
+            }
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd':
+            o.directed = true;
+            break;
+        case 'g':
+            o.gamma = atof(optarg);
+            break;
+        case 'w':
+            o.min_weight = atof(optarg);
+            break;
+        case 'W':
+            o.max_weight = atof(optarg);
+            break;
+        case 'c':
+            o.connected = true;
+            break;
+        case 'N':
+            o.no_neg_cycle = true;
+            break;
+        case 'T':
+            o.tries = atol(optarg);
+            break;
+        case 's':
+            o.seed = strtoull(optarg, NULL, 0);
+            o.seeded = true;
+            break;
+        case 'j':
+            o.threads = atoi(optarg);
+            break;
+        case 'b':
+            o.output_format = BINARY;
+            break;
+        case 'e':
+            o.output_format = EDGES;
+            break;
+        case 'C':
+            o.output_format = CSR;
+            break;
+        case 'o':
+            o.output = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc || o.n < 1 || o.n > UINT32_MAX || (o.type == POWERLAW && o.gamma <= 1) ||
+        o.min_weight > o.max_weight)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (o.type == DAG)
+    {
+        o.directed = true;
+    }
+    if (o.threads <= 0)
+    {
+        o.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (!o.seeded)
+    {
+        o.seed = ((uint64_t)std::random_device()() << 32) | std::random_device()();
+    }
+
+    const long n = o.n;
+    long m = o.density >= 0 ? density_edges(n, o.density) : o.m;
+    // networkx returns the complete graph for too many edges
+    long max_edges = o.directed && o.type != DAG ? n * (n - 1) : n * (n - 1) / 2;
+    if (o.type != POWERLAW)
+    {
+        m = std::min(m, max_edges);
+    }
+    if (m < 0 || m > max_edges)
+    {
+        fprintf(stderr, "a graph with n=%ld can't have m=%ld edges, at most %ld\n", n, m, max_edges);
+        return 1;
+    }
+
+    for (long tries = 1;; tries++)
+    {
+        if (tries > o.tries)
+        {
+            fprintf(stderr, "Took too many tries to generate graph with n=%ld and m=%ld\n", n, m);
+            return 1;
+        }
+        rng r(mix(o.seed + tries - 1));
+        graph g(n, o.directed);
+        g.seed = r();
+        bool ok;
+        switch (o.type)
+        {
+        case POWERLAW:
+            ok = generate_powerlaw(g, o, m, r);
+            break;
+        case GRID:
+            ok = generate_grid(g, o);
+            break;
+        default:
+            ok = generate_uniform(g, o, m, r);
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "couldn't place m=%ld edges in a %s graph with n=%ld\n", m,
+                    o.type == POWERLAW ? "powerlaw" : "random", n);
+            return 1;
+        }
+        if (o.connected && !is_connected(g))
+        {
+            continue;
+        }
+        if (o.no_neg_cycle && has_negative_cycle(g, o))
+        {
+            continue;
+        }
+        fprintf(stderr, "generated graph with n=%ld and m=%ld in %ld tries\n", n, g.edges(), tries);
+        return write_graph(g, o) ? 0 : 1;
+    }
+}
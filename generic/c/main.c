@@ -1,65 +1,12 @@
-#include <malloc.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <papi.h>
-#include <immintrin.h>
 
+#include "../../generic/harness/harness.h"
+#include "../../generic/harness/pages.h"
 #include "impl/fw.h"
 
-#define NUM_RUNS 16
-#define CYCLES_REQUIRED 1e8
-#define FREQUENCY 2.3e9
-#define CALIBRATE
-
-#define ERROR_RETURN(retval)                                                         \
-    {                                                                                \
-        fprintf(stderr, "PAPI error %d %s:line %d: \n", retval, __FILE__, __LINE__); \
-        exit(retval);                                                                \
-    }
-
-// The number of PAPI events we measure
-#define NUM_EVENT 4
-
-// The PAPI events we subscribe to for the measurement
-// Only add events supported on your machine. Check with the papi_avail tool in the PAPI utils
-// IMPORTANT: DO NOT CHANGE ORDER! Otherwise the data readout in the measurement script breaks
-static int event_codes[NUM_EVENT] = {
-    PAPI_TOT_CYC, // Total cycles executed
-    PAPI_L3_TCM,  // L3 cache misses
-    PAPI_L2_TCM,  // L2 data cache misses
-    PAPI_L1_DCM,  // L1 data cache misses
-};
-
-void printMatrix(double *C, int N)
-{
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            fprintf(stderr, "%.2f, ", C[i * N + j]);
-        }
-        fprintf(stderr, "\n");
-    }
-}
-
-/*
-Copies data from one matrix to another.
-Assumes matrices 'from' and 'to' point to separate memory locations.
-*/
-void copyMatrix(float *from, float *to, int N)
-{
-#pragma ivdep
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            to[i * N + j] = from[i * N + j];
-        }
-    }
-}
-
 /*
  * Runs the FW implementation once for testing purposes
  * Note that the matrix C is modified in-place
@@ -74,136 +21,6 @@ void ref_output(double *C, int N)
     }
 }
 
-// fine, I'll do it myself
-void flush_cache(void *addr, int nbytes)
-{
-    // assume cache line of 64 bytes, cause why wouldn't it be
-    void *p = addr;
-    while (p < addr + nbytes)
-    {
-        // Invalidate and flush the cache line that contains p from all levels of the cache hierarchy
-        _mm_clflush(p);
-        p += 64;
-    }
-    // Ensure cache flushes have completed
-    _mm_mfence();
-}
-
-/*
- * Timing function based on the TimeStep Counter of the CPU.
- *
- * We don't particularly care about the input, so we just
- * run FW on the same matrix C for each run even though it
- * modifies it in-place.
- *
- * The function returns the average number of cycles per run.
- */
-int measure(double *C, int N, int WarmupEventSet, int MeasurementEventSet, long long *measured_values)
-{
-    int i, retval;
-    int num_runs = NUM_RUNS;
-
-    // Compute how many runs we need to do and warm up cache
-    long long warmup_cycles[1];
-    long long warmup_cycles_tmp[1];
-    /* Start counting */
-    long long cycles = 0;
-    while (num_runs < (1 << 14))
-    {
-
-        for (i = 0; i < num_runs; ++i)
-        {
-            if ((retval = PAPI_start(WarmupEventSet)) != PAPI_OK)
-            {
-                ERROR_RETURN(retval);
-            }
-
-            floydWarshall(C, N);
-
-            /* Stop counting, this reads from the counter as well as stop it. */
-            if ((retval = PAPI_stop(WarmupEventSet, warmup_cycles_tmp)) != PAPI_OK)
-            {
-                ERROR_RETURN(retval);
-            }
-
-            warmup_cycles[0] += warmup_cycles_tmp[0]; // accumulate
-
-            flush_cache((void *)C, N * N * sizeof(double));
-        }
-
-        cycles += warmup_cycles[0];
-
-        if (cycles >= CYCLES_REQUIRED)
-        {
-            break;
-        }
-
-        num_runs *= 2;
-        if ((retval = PAPI_reset(WarmupEventSet)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-    }
-
-    fprintf(stderr, "#runs: %d\n", num_runs);
-    /*
-     * Alternatives to the current approach:
-     * - Measure #cycles for each run separately
-     *  --> Suffers from timing bias and requires cache warmup
-     *  --> Allows for more fine-grained statistics, e.g. median, variance, etc.
-     */
-
-    long long measured_values_tmp[NUM_EVENT];
-
-    // ------- MEASURE CACHE MISSES ON COLD CACHE -------
-    for (i = 0; i < num_runs; ++i)
-    {
-        /* Start counting */
-        if ((retval = PAPI_start(MeasurementEventSet)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-
-        floydWarshall(C, N);
-
-        /* Stop counting, this reads from the counter as well as stop it. */
-        if ((retval = PAPI_stop(MeasurementEventSet, measured_values_tmp)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-
-        for (int i = 0; i < NUM_EVENT; i++)
-        {
-            measured_values[i] += measured_values_tmp[i]; // accumulate
-        }
-
-        flush_cache((void *)C, N * N * sizeof(double));
-    }
-
-    // ------- MEASURE NUMBER OF CYCLES ON WARM CACHE -------
-    /* Start counting */
-    if ((retval = PAPI_start(MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    for (i = 0; i < num_runs; ++i)
-    {
-        floydWarshall(C, N);
-    }
-
-    /* Stop counting, this reads from the counter as well as stop it. */
-    if ((retval = PAPI_stop(MeasurementEventSet, measured_values_tmp)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    // overwrite total cycles
-    measured_values[0] = measured_values_tmp[0];
-
-    return num_runs;
-}
-
 void output_matrix(char *filename, double *C, int N)
 {
     fprintf(stderr, "outputting shortest-path matrix to %s...\n", filename);
@@ -227,6 +44,16 @@ void output_matrix(char *filename, double *C, int N)
     }
 }
 
+static int run_floydWarshall(void *C, int N)
+{
+    return floydWarshall((double *)C, N);
+}
+
+// the kernels the harness can measure, selected with FW_KERNEL
+static const struct harness_kernel kernels[] = {
+    {"floydWarshall", run_floydWarshall, 64},
+};
+
 int main(int argc, char **argv)
 {
     if (argc != 3)
@@ -236,40 +63,6 @@ int main(int argc, char **argv)
         return -1;
     }
 
-    // setup PAPI
-    int retval;
-    int WarmupEventSet = PAPI_NULL;
-    int MeasurementEventSet = PAPI_NULL;
-    char errstring[PAPI_MAX_STR_LEN];
-    long long measured_values[NUM_EVENT];
-
-    if ((retval = PAPI_library_init(PAPI_VER_CURRENT)) != PAPI_VER_CURRENT)
-    {
-        fprintf(stderr, "Error: %s\n", errstring);
-        return 1;
-    }
-
-    /* Creating event set   */
-    if ((retval = PAPI_create_eventset(&MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_create_eventset(&WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    // add events to event sets
-    if ((retval = PAPI_add_event(WarmupEventSet, PAPI_TOT_CYC)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    if ((retval = PAPI_add_events(MeasurementEventSet, event_codes, NUM_EVENT)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
     // read input
     char *input_fname = argv[1];
     char *output_fname = argv[2];
@@ -283,7 +76,7 @@ int main(int argc, char **argv)
     }
 
     fprintf(stderr, "allocating memory...\n");
-    double *C = (double *)aligned_alloc(32, N * N * sizeof(double));
+    double *C = (double *)pages_alloc(N * N * sizeof(double));
     fprintf(stderr, "parsing input matrix...\n");
     for (int i = 0; i < N; i++)
     {
@@ -316,39 +109,10 @@ int main(int argc, char **argv)
 
     // run measurements
     fprintf(stderr, "running floyd-warshall for n=%d\n", N);
-    int num_runs = measure(C, N, WarmupEventSet, MeasurementEventSet, measured_values);
-
-    // output measurements
-    printf("%d", num_runs);
-    for (int i = 0; i < NUM_EVENT; i++)
-    {
-        printf("\n%lld", measured_values[i] / num_runs);
-    }
+    int err = harness_run(kernels, sizeof(kernels) / sizeof(kernels[0]), C, N * N * sizeof(double), N);
 
     // clean up
-    free(C);
-
-    /* Free all memory and data structures, EventSet must be empty. */
-    if ((retval = PAPI_cleanup_eventset(WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_cleanup_eventset(MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
+    pages_free(C);
 
-    if ((retval = PAPI_destroy_eventset(&WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_destroy_eventset(&MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    /* free the resources used by PAPI */
-    PAPI_shutdown();
-
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return err == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
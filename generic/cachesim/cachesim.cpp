@@ -0,0 +1,795 @@
+// Trace-driven cache and TLB simulator for FWT, see README.md.
+//
+// The hooks of generic/harness/phases.h are defined below, they tell the
+// simulator which phase the instrumented kernels are in.
+#define FW_PHASES
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cachesim.hpp"
+#include "replay.hpp"
+
+using namespace cachesim;
+
+// registers of the instrumented kernels, as in impl/template-tiles.cpp
+#ifdef __AVX2__
+typedef __m256d DREG;
+typedef __m256i CREG;
+#else
+typedef double DREG;
+typedef char CREG;
+#endif
+
+// parameters the instrumented kernels are instantiated for, a subset of the
+// grids of impl/template-tiles.cpp. The replay takes any parameters.
+struct double_grid
+{
+    static constexpr int L1[] = {32, 64, 128};
+    static constexpr int Ui[] = {2, 4};
+    static constexpr int Uj[] = {4, 8};
+    static constexpr int Uii[] = {2, 4};
+    static constexpr int Ujj[] = {4, 8};
+    static constexpr int Ukk[] = {1, 2};
+};
+
+struct char_grid
+{
+    static constexpr int L1[] = {256, 512, 768};
+    static constexpr int Ui[] = {2, 4};
+    static constexpr int Uj[] = {32, 64};
+    static constexpr int Uii[] = {2, 4};
+    static constexpr int Ujj[] = {32, 64};
+    static constexpr int Ukk[] = {1, 2};
+};
+
+// defaults of impl/template-tiles.cpp
+static const fw::params double_defaults = {32, 4, 4, 4, 4, 2};
+static const fw::params char_defaults = {768, 4, 32, 2, 32, 2};
+
+extern "C"
+{
+    void phases_begin(int, int phase) { current_tracer.s->phase(phase); }
+    void phases_end(int, int) { current_tracer.s->phase(0); }
+    void phases_tile(unsigned long long, int, int) {}
+}
+
+struct options
+{
+    bool packed = false;
+    bool vector = true;
+    bool naive = false;
+    bool kernel = false;
+    bool verify = false;
+    std::vector<fw::params> params;
+    std::vector<level_config> caches;
+    int line = 64;
+    std::vector<level_config> tlbs;
+    long page = 4096;
+    int rounds = 2;
+    int rows = 4;
+    const char *csv = NULL;
+    const char *algo = "fw";
+};
+
+// accesses of the kernel handed to the replay at a time by --verify, and the
+// most chunks in flight, so the streams are compared in bounded memory
+#define VERIFY_CHUNK (1 << 16)
+#define VERIFY_CHUNKS 4
+
+// an access of a stream, for --verify
+struct access_entry
+{
+    uint64_t addr;
+    int bytes;
+    bool write;
+    int phase;
+
+    bool operator!=(const access_entry &o) const
+    {
+        return addr != o.addr || bytes != o.bytes || write != o.write || phase != o.phase;
+    }
+};
+
+// hands the stream of the kernel, which runs on a thread of its own, to the replay in chunks
+class stream_pipe final : public sink
+{
+  public:
+    void access(uint64_t addr, int bytes, bool write) override
+    {
+        if (chunk.size() == VERIFY_CHUNK)
+        {
+            push();
+        }
+        chunk.push_back({addr, bytes, write, current});
+    }
+    void phase(int p) override { current = p; }
+
+    // the kernel is done
+    void close()
+    {
+        push();
+        std::lock_guard<std::mutex> lock(m);
+        done = true;
+        changed.notify_all();
+    }
+
+    // the reader stops, the rest of the stream is dropped
+    void abandon()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        abandoned = true;
+        queue.clear();
+        changed.notify_all();
+    }
+
+    // the next chunk of the stream, false at its end
+    bool pop(std::vector<access_entry> &out)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        changed.wait(lock, [this] { return !queue.empty() || done; });
+        if (queue.empty())
+        {
+            return false;
+        }
+        out = std::move(queue.front());
+        queue.pop_front();
+        changed.notify_all();
+        return true;
+    }
+
+  private:
+    void push()
+    {
+        std::unique_lock<std::mutex> lock(m);
+        changed.wait(lock, [this] { return queue.size() < VERIFY_CHUNKS || abandoned; });
+        if (!abandoned && !chunk.empty())
+        {
+            queue.push_back(std::move(chunk));
+            changed.notify_all();
+        }
+        chunk.clear();
+    }
+
+    int current = 0;
+    std::vector<access_entry> chunk;
+    std::mutex m;
+    std::condition_variable changed;
+    std::deque<std::vector<access_entry>> queue;
+    bool done = false, abandoned = false;
+};
+
+// compares the stream of the replay with the one of the kernel as it comes in
+class stream_check final : public sink
+{
+  public:
+    explicit stream_check(stream_pipe &kernel) : kernel(kernel) {}
+
+    void access(uint64_t addr, int bytes, bool write) override
+    {
+        replayed++;
+        // past the end of the kernel, the replay is only counted
+        if (differs || !next())
+        {
+            return;
+        }
+        const access_entry b = {addr, bytes, write, current};
+        if (chunk[pos] != b)
+        {
+            differs = true;
+            first_difference = {chunk[pos], b};
+            kernel.abandon();
+            return;
+        }
+        pos++;
+        matched++;
+    }
+    void phase(int p) override { current = p; }
+
+    // accesses of the kernel, once the replay is done and the streams are the same so far
+    size_t kernel_accesses()
+    {
+        size_t n = matched;
+        while (next())
+        {
+            n += chunk.size() - pos;
+            pos = chunk.size();
+        }
+        return n;
+    }
+
+    bool differs = false;
+    std::pair<access_entry, access_entry> first_difference; // kernel, replay
+    size_t matched = 0, replayed = 0;
+
+  private:
+    // whether the kernel has an access at pos
+    bool next()
+    {
+        while (pos == chunk.size() && !ended)
+        {
+            pos = 0;
+            chunk.clear();
+            ended = !kernel.pop(chunk);
+        }
+        return pos < chunk.size();
+    }
+
+    stream_pipe &kernel;
+    int current = 0;
+    std::vector<access_entry> chunk;
+    size_t pos = 0;
+    bool ended = false;
+};
+
+// parses sizes such as 48K, 2M or 1536
+static long parse_size(const char *s)
+{
+    char *end;
+    long x = strtol(s, &end, 10);
+    switch (*end)
+    {
+    case 'G':
+        x <<= 10;
+        // fall through
+    case 'M':
+        x <<= 10;
+        // fall through
+    case 'K':
+        x <<= 10;
+    }
+    return x;
+}
+
+// parses SIZE:WAYS[,SIZE:WAYS ...]
+static bool parse_levels(const char *s, std::vector<level_config> *levels)
+{
+    levels->clear();
+    std::string list(s);
+    size_t start = 0;
+    while (start < list.size())
+    {
+        size_t end = list.find(',', start);
+        std::string item = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        size_t colon = item.find(':');
+        if (colon == std::string::npos)
+        {
+            return false;
+        }
+        level_config c = {parse_size(item.c_str()), atoi(item.c_str() + colon + 1)};
+        if (c.size <= 0 || c.ways <= 0)
+        {
+            return false;
+        }
+        levels->push_back(c);
+        start = end == std::string::npos ? list.size() : end + 1;
+    }
+    return !levels->empty();
+}
+
+static bool read_line(const std::string &path, char *buf, int size)
+{
+    FILE *f = fopen(path.c_str(), "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+    bool ok = fgets(buf, size, f) != NULL;
+    fclose(f);
+    return ok;
+}
+
+// data and unified caches of cpu0, ordered by level
+static std::vector<level_config> sysfs_caches(int *line)
+{
+    std::vector<level_config> caches;
+    std::vector<int> order;
+    for (int i = 0;; i++)
+    {
+        std::string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+        char level[16], type[32], size[32], ways[16], ls[16];
+        if (!read_line(dir + "level", level, sizeof(level)))
+        {
+            break;
+        }
+        if (!read_line(dir + "type", type, sizeof(type)) || strncmp(type, "Instruction", 11) == 0 ||
+            !read_line(dir + "size", size, sizeof(size)) || !read_line(dir + "ways_of_associativity", ways, sizeof(ways)))
+        {
+            continue;
+        }
+        if (read_line(dir + "coherency_line_size", ls, sizeof(ls)))
+        {
+            *line = atoi(ls);
+        }
+        // insert sorted by level
+        size_t pos = 0;
+        while (pos < order.size() && order[pos] < atoi(level))
+        {
+            pos++;
+        }
+        order.insert(order.begin() + pos, atoi(level));
+        caches.insert(caches.begin() + pos, {parse_size(size), atoi(ways)});
+    }
+    return caches;
+}
+
+// attributes of DREG and CREG ignored as template arguments, see reg in fw.hpp
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+template <class E>
+static const fw::variant<E> *kernel_variant(fw::params p)
+{
+    if constexpr (std::is_same<E, char>::value)
+    {
+        static const std::vector<fw::variant<char>> table =
+            fw::build_table<traced_semiring<fw::OrAnd>, traced<CREG>, char_grid>();
+        return fw::find(table, p);
+    }
+    else
+    {
+        // min-plus and max-min have the same stream
+        static const std::vector<fw::variant<double>> table =
+            fw::build_table<traced_semiring<fw::MinPlus>, traced<DREG>, double_grid>();
+        return fw::find(table, p);
+    }
+}
+
+// the instrumented kernel for p is part of the tables, for the registers of the build
+static bool has_kernel(const options &o, fw::params p)
+{
+    if (o.naive)
+    {
+        return true;
+    }
+    bool found = o.packed ? kernel_variant<char>(p) != NULL : kernel_variant<double>(p) != NULL;
+    return found && o.vector == (fw::reg<DREG>::width > 1);
+}
+
+/*
+ * Runs the instrumented kernel (FWT with parameters p, or FWnaive) on an n x n
+ * matrix at address base, reporting its accesses to s.
+ * Returns false if the kernel isn't part of the tables.
+ */
+template <class E>
+static bool run_kernel(const options &o, sink *s, int n, fw::params p, uint64_t base)
+{
+    const fw::variant<E> *v = o.naive ? NULL : kernel_variant<E>(p);
+    // the tables have the registers of the build, FWnaive scalar ones
+    if (!o.naive && (v == NULL || o.vector != (fw::reg<DREG>::width > 1)))
+    {
+        return false;
+    }
+    int ld = fw::reg<E>::ld(n);
+    size_t bytes = ((size_t)n * ld * sizeof(E) + 4095) / 4096 * 4096;
+    // page aligned, like the simulated matrix
+    E *C = (E *)aligned_alloc(4096, bytes);
+    memset(C, 0, bytes);
+    current_tracer = {s, (const char *)C, base};
+    if constexpr (!std::is_same<E, char>::value)
+    {
+        if (o.naive)
+        {
+            fw::FWI_kernel<traced_semiring<fw::MinPlus>, traced<E>, 1, 1>(C, C, C, ld, n);
+        }
+    }
+    if (!o.naive)
+    {
+        v->run(C, C, C, n);
+    }
+    free(C);
+    return true;
+}
+#pragma GCC diagnostic pop
+
+static bool run_kernel(const options &o, sink *s, int n, fw::params p, uint64_t base)
+{
+    if (o.packed)
+    {
+        return run_kernel<char>(o, s, n, p, base);
+    }
+    return run_kernel<double>(o, s, n, p, base);
+}
+
+// name of the kernel for messages
+static std::string label(const options &o, fw::params p)
+{
+    char buf[64];
+    if (o.naive)
+    {
+        return "FWnaive";
+    }
+    snprintf(buf, sizeof(buf), "FWT (%d, %d, %d, %d, %d, %d)", p.L1, p.ui, p.uj, p.uii, p.ujj, p.ukk);
+    return buf;
+}
+
+// same checks as fw::valid, at runtime
+static bool valid(const options &o, int n, fw::params p)
+{
+    if (o.naive)
+    {
+        return true;
+    }
+    geometry g(n, o.packed, o.vector, 0);
+    int cols = g.cols(p.L1);
+    return n % p.L1 == 0 && p.L1 % p.ui == 0 && cols % p.uj == 0 && p.uj % g.width == 0 && p.L1 % p.uii == 0 &&
+           p.L1 % p.ukk == 0 && cols % p.ujj == 0 && p.ujj % g.width == 0;
+}
+
+// sum over the phases
+static double total(const double *x)
+{
+    double sum = 0;
+    for (int p = 0; p < CACHESIM_PHASES; p++)
+    {
+        sum += x[p];
+    }
+    return sum;
+}
+
+static void print_level(const char *name, const hierarchy::stats &s, bool phases)
+{
+    double accesses = total(s.accesses), misses = total(s.misses);
+    printf("%-6s %12.4g %12.4g %9.3f %%", name, accesses, misses, accesses > 0 ? 100 * misses / accesses : 0);
+    for (int p = 1; phases && p < CACHESIM_PHASES; p++)
+    {
+        printf(" %9.3f %%", s.accesses[p] > 0 ? 100 * s.misses[p] / s.accesses[p] : 0);
+    }
+    printf("\n");
+}
+
+static void write_csv(const options &o, int n, fw::params p, const char *name, const hierarchy::stats &s)
+{
+    FILE *f = fopen(o.csv, "a");
+    if (f == NULL)
+    {
+        perror(o.csv);
+        exit(1);
+    }
+    if (ftell(f) == 0)
+    {
+        fprintf(f, "algo,n,kernel,L1,Ui,Uj,Uii,Ujj,Ukk,level,phase,accesses,misses,writebacks\n");
+    }
+    const char *kernel = o.naive ? "naive" : "fwt";
+    fprintf(f, "%s,%d,%s,%d,%d,%d,%d,%d,%d,%s,all,%.0f,%.0f,%.0f\n", o.algo, n, kernel, p.L1, p.ui, p.uj, p.uii, p.ujj,
+            p.ukk, name, total(s.accesses), total(s.misses), total(s.writebacks));
+    for (int q = 1; !o.naive && q < CACHESIM_PHASES; q++)
+    {
+        fprintf(f, "%s,%d,%s,%d,%d,%d,%d,%d,%d,%s,%d,%.0f,%.0f,%.0f\n", o.algo, n, kernel, p.L1, p.ui, p.uj, p.uii,
+                p.ujj, p.ukk, name, q, s.accesses[q], s.misses[q], s.writebacks[q]);
+    }
+    fclose(f);
+}
+
+static void simulate(const options &o, int n, fw::params p)
+{
+    if (!valid(o, n, p))
+    {
+        fprintf(stderr, "%s doesn't fit n = %d, skipping\n", label(o, p).c_str(), n);
+        return;
+    }
+    hierarchy h(o.caches, o.line, o.tlbs, o.page);
+    geometry g(n, o.packed, o.vector, 0);
+    int M = o.naive ? n : n / p.L1;
+    int rows = M - 1;
+    auto round = [&](int k, bool warm_up) {
+        if (o.naive)
+        {
+            h.count(!warm_up);
+            replay_naive_round(h, g, n, k);
+            h.count(true);
+        }
+        else if (warm_up)
+        {
+            replay_fwt_round(h, g, p, n, k, REPLAY_TOUCH, std::vector<char>(M, REPLAY_TOUCH));
+        }
+        else
+        {
+            replay_fwt_round(h, g, p, n, k, REPLAY_COUNT, sample_rows(M, k, o.rows, &rows));
+        }
+    };
+
+    int rounds = M;
+    if (o.kernel)
+    {
+        if (!run_kernel(o, &h, n, p, g.base))
+        {
+            fprintf(stderr, "%s isn't instantiated for --kernel, skipping\n", label(o, p).c_str());
+            return;
+        }
+    }
+    else if (o.rounds <= 0 || 2 * o.rounds > M)
+    {
+        for (int k = 0; k < M; k++)
+        {
+            round(k, false);
+        }
+    }
+    else
+    {
+        // evenly spaced rounds, each after a warm-up round
+        for (int r = 0; r < o.rounds; r++)
+        {
+            int k = (2 * r + 1) * M / (2 * o.rounds);
+            round(k - 1, true);
+            round(k, false);
+        }
+        rounds = o.rounds;
+    }
+
+    // extrapolate to all rounds, and phase 4 to all tile rows
+    double scale[CACHESIM_PHASES];
+    for (int q = 0; q < CACHESIM_PHASES; q++)
+    {
+        scale[q] = (double)M / rounds * (q == 4 && rows > 0 ? (double)(M - 1) / rows : 1);
+    }
+
+    printf("%s n = %d, %s, %s, %d of %d %s", o.algo, n, label(o, p).c_str(),
+           o.kernel ? "instrumented kernel" : "replay", rounds, M, o.naive ? "iterations" : "k-rounds");
+    if (!o.naive)
+    {
+        printf(", %d of %d tile rows in phase 4", rows, M - 1);
+    }
+    printf("\n");
+    printf("%-6s %12s %12s %11s", "level", "accesses", "misses", "miss rate");
+    for (int q = 1; !o.naive && q < CACHESIM_PHASES; q++)
+    {
+        printf("   phase %d", q);
+    }
+    printf("\n");
+
+    double dram_reads = 0, dram_writes = 0;
+    for (size_t i = 0; i < h.caches() + h.tlbs(); i++)
+    {
+        char name[16];
+        if (i < h.caches())
+        {
+            snprintf(name, sizeof(name), i == 0 ? "L%zud" : "L%zu", i + 1);
+        }
+        else if (i - h.caches() < 2)
+        {
+            snprintf(name, sizeof(name), "%s", i == h.caches() ? "dTLB" : "STLB");
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "TLB%zu", i - h.caches() + 1);
+        }
+        hierarchy::stats s = h.result(i, scale);
+        print_level(name, s, !o.naive);
+        if (o.csv != NULL)
+        {
+            write_csv(o, n, p, name, s);
+        }
+        if (i + 1 == h.caches())
+        {
+            dram_reads = total(s.misses) * h.line_size();
+            dram_writes = total(s.writebacks) * h.line_size();
+        }
+    }
+    double traffic = dram_reads + dram_writes;
+    printf("DRAM: %.4g bytes read, %.4g bytes written, intensity %.3f flops/byte\n\n", dram_reads, dram_writes,
+           traffic > 0 ? 2.0 * n * n * n / traffic : 0);
+}
+
+/*
+ * Compares the stream of the instrumented kernel with the replay. The kernel
+ * runs on a thread of its own and hands its accesses to the replay through a
+ * bounded queue, so neither stream is stored.
+ */
+static bool verify(const options &o, int n, fw::params p)
+{
+    if (!valid(o, n, p))
+    {
+        fprintf(stderr, "%s doesn't fit n = %d, skipping\n", label(o, p).c_str(), n);
+        return true;
+    }
+    if (!has_kernel(o, p))
+    {
+        fprintf(stderr, "%s isn't instantiated for --kernel, skipping\n", label(o, p).c_str());
+        return true;
+    }
+    geometry g(n, o.packed, o.vector, 0);
+    stream_pipe kernel;
+    std::thread runner([&]() {
+        run_kernel(o, &kernel, n, p, g.base);
+        kernel.close();
+    });
+    stream_check replay(kernel);
+    int M = o.naive ? n : n / p.L1;
+    for (int k = 0; k < M && !replay.differs; k++)
+    {
+        if (o.naive)
+        {
+            replay_naive_round(replay, g, n, k);
+        }
+        else
+        {
+            replay_fwt_round(replay, g, p, n, k, REPLAY_COUNT, std::vector<char>(M, REPLAY_COUNT));
+        }
+    }
+    size_t kernel_accesses = replay.differs ? 0 : replay.kernel_accesses();
+    runner.join();
+
+    if (replay.differs)
+    {
+        const access_entry &a = replay.first_difference.first, &b = replay.first_difference.second;
+        fprintf(stderr, "n = %d, %s: access %zu differs: kernel %s %d bytes at %lu in phase %d, "
+                        "replay %s %d bytes at %lu in phase %d\n",
+                n, label(o, p).c_str(), replay.matched, a.write ? "writes" : "reads", a.bytes,
+                (unsigned long)a.addr, a.phase, b.write ? "writes" : "reads", b.bytes, (unsigned long)b.addr, b.phase);
+        return false;
+    }
+    if (kernel_accesses != replay.replayed)
+    {
+        fprintf(stderr, "n = %d, %s: the kernel makes %zu accesses, the replay %zu\n", n, label(o, p).c_str(),
+                kernel_accesses, replay.replayed);
+        return false;
+    }
+    printf("n = %d, %s: %zu accesses match\n", n, label(o, p).c_str(), replay.matched);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "call as: %s [options] n1 [n2 ...]\n"
+            "  -a, --algo fw|mm|tc             algorithm (default fw), fw and mm have the same stream\n"
+            "  -p, --params L1,Ui,Uj,Ui',Uj',Uk'  FWT parameters, may be repeated (default: impl/template-tiles.cpp)\n"
+            "      --naive                     simulate FWnaive instead of FWT\n"
+            "      --scalar                    scalar instead of AVX2 registers\n"
+            "  -c, --caches SIZE:WAYS,...      data caches from L1 (default: /sys/devices/system/cpu/cpu0/cache)\n"
+            "  -l, --line BYTES                cache line size\n"
+            "  -t, --tlbs ENTRIES:WAYS,...     data TLBs (default 64:4,1536:12, or 32:4,1536:12 with 2M pages)\n"
+            "      --page 4K|2M                page size (default 4K)\n"
+            "  -r, --rounds R                  simulate R sampled k-rounds, 0 for all (default 2)\n"
+            "  -R, --rows R                    simulate R sampled tile rows of phase 4 per round, 0 for all (default 4)\n"
+            "  -k, --kernel                    trace the instrumented kernels instead of replaying the loop nest\n"
+            "      --verify                    check that the replay matches the instrumented kernels\n"
+            "  -o, --csv FILE                  append the results to FILE\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    options o;
+    o.caches = sysfs_caches(&o.line);
+    if (o.caches.empty())
+    {
+        parse_levels("32K:8,256K:4,8M:16", &o.caches);
+    }
+    const char *tlbs = NULL;
+
+    static const struct option long_options[] = {
+        {"algo", required_argument, NULL, 'a'},  {"params", required_argument, NULL, 'p'},
+        {"naive", no_argument, NULL, 'N'},       {"scalar", no_argument, NULL, 'S'},
+        {"caches", required_argument, NULL, 'c'}, {"line", required_argument, NULL, 'l'},
+        {"tlbs", required_argument, NULL, 't'},  {"page", required_argument, NULL, 'P'},
+        {"rounds", required_argument, NULL, 'r'}, {"rows", required_argument, NULL, 'R'},
+        {"kernel", no_argument, NULL, 'k'},      {"verify", no_argument, NULL, 'V'},
+        {"csv", required_argument, NULL, 'o'},   {NULL, 0, NULL, 0}};
+    int c;
+    while ((c = getopt_long(argc, argv, "a:p:c:l:t:r:R:ko:", long_options, NULL)) != -1)
+    {
+        fw::params p;
+        switch (c)
+        {
+        case 'a':
+            o.algo = optarg;
+            o.packed = strcmp(optarg, "tc") == 0;
+            if (!o.packed && strcmp(optarg, "fw") != 0 && strcmp(optarg, "mm") != 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'p':
+            if (sscanf(optarg, "%d,%d,%d,%d,%d,%d", &p.L1, &p.ui, &p.uj, &p.uii, &p.ujj, &p.ukk) != 6)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            o.params.push_back(p);
+            break;
+        case 'N':
+            o.naive = true;
+            break;
+        case 'S':
+            o.vector = false;
+            break;
+        case 'c':
+            if (!parse_levels(optarg, &o.caches))
+            {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'l':
+            o.line = atoi(optarg);
+            break;
+        case 't':
+            tlbs = optarg;
+            break;
+        case 'P':
+            o.page = parse_size(optarg);
+            break;
+        case 'r':
+            o.rounds = atoi(optarg);
+            break;
+        case 'R':
+            o.rows = atoi(optarg);
+            break;
+        case 'k':
+            o.kernel = true;
+            break;
+        case 'V':
+            o.verify = true;
+            break;
+        case 'o':
+            o.csv = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!parse_levels(tlbs != NULL ? tlbs : o.page >= (2l << 20) ? "32:4,1536:12" : "64:4,1536:12", &o.tlbs))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (o.naive)
+    {
+        // FWnaive uses scalar registers and no unrolling
+        o.vector = false;
+        o.params = {{0, 1, 1, 1, 1, 1}};
+        if (o.packed)
+        {
+            fprintf(stderr, "--naive is only supported for fw and mm\n");
+            return 1;
+        }
+    }
+    if (o.params.empty())
+    {
+        o.params.push_back(o.packed ? char_defaults : double_defaults);
+    }
+
+    std::vector<int> sizes;
+    for (int i = optind; i < argc; i++)
+    {
+        if (atoi(argv[i]) <= 0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        sizes.push_back(atoi(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bool ok = true;
+    for (int n : sizes)
+    {
+        for (fw::params p : o.params)
+        {
+            if (o.verify)
+            {
+                ok = verify(o, n, p) && ok;
+            }
+            else
+            {
+                simulate(o, n, p);
+            }
+        }
+    }
+    return ok ? 0 : 1;
+}
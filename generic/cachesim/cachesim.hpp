@@ -0,0 +1,291 @@
+#ifndef CACHESIM_HPP
+#define CACHESIM_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Trace-driven model of the data cache hierarchy and the data TLBs.
+//
+// Every level is set-associative with LRU replacement. The caches are
+// write-back and write-allocate: a demand miss fills the line into every level
+// it missed in, a dirty line evicted from level l is written back into level
+// l + 1, and dirty lines evicted from the last level are written to DRAM.
+// Hardware prefetchers, the replacement policies of real L3 slices and the
+// hashing of addresses onto them are not modelled.
+//
+// The TLBs are modelled the same way, as a dTLB backed by a second level
+// (STLB) that is filled on every miss. A miss in the last TLB level is a page
+// walk.
+
+namespace cachesim
+{
+
+// phases of FWT, as in generic/harness/phases.h; 0 is everything else
+#define CACHESIM_PHASES 5
+
+struct level_config
+{
+    long size; // in bytes for caches, in entries for TLBs
+    int ways;
+};
+
+// receives the address stream of a kernel
+class sink
+{
+  public:
+    virtual ~sink() {}
+    virtual void access(uint64_t addr, int bytes, bool write) = 0;
+    virtual void phase(int p) = 0;
+    // warm-up accesses change the state but are not counted
+    virtual void count(bool) {}
+};
+
+// one set-associative level with LRU replacement
+class cache
+{
+  public:
+    // an entry is the line or page number shifted left by one with the dirty
+    // bit below, invalid entries are ~0
+    static constexpr uint64_t invalid = ~(uint64_t)0;
+
+    cache(long entries, int ways) : ways(ways), sets(entries / ways)
+    {
+        if (sets <= 0)
+        {
+            fprintf(stderr, "cachesim: %ld entries don't fill a single set of %d ways\n", entries, ways);
+            exit(1);
+        }
+        mask = (sets & (sets - 1)) == 0 ? sets - 1 : 0;
+        table.assign((size_t)sets * ways, invalid);
+    }
+
+    uint64_t num_sets() const { return sets; }
+
+    /*
+     * Looks up tag and moves it to the front of its set, which is kept in LRU
+     * order, dirty is or-ed into the entry. On a miss, the last entry of the
+     * set is replaced: *hit is set to false and *victim to the evicted entry,
+     * which is invalid on a hit. Returns the entry of tag.
+     */
+    uint64_t *lookup(uint64_t tag, bool dirty, bool *hit, uint64_t *victim)
+    {
+        uint64_t *set = &table[(size_t)(mask != 0 ? tag & mask : tag % sets) * ways];
+        int e = 0;
+        while (e < ways && set[e] >> 1 != tag)
+        {
+            e++;
+        }
+        *hit = e < ways;
+        *victim = invalid;
+        uint64_t entry;
+        if (*hit)
+        {
+            entry = set[e] | dirty;
+        }
+        else
+        {
+            e = ways - 1;
+            *victim = set[e];
+            entry = tag << 1 | dirty;
+        }
+        for (; e > 0; e--)
+        {
+            set[e] = set[e - 1];
+        }
+        set[0] = entry;
+        return set;
+    }
+
+    static bool dirty(uint64_t entry) { return entry != invalid && (entry & 1); }
+    static uint64_t tag(uint64_t entry) { return entry >> 1; }
+
+  private:
+    int ways;
+    uint64_t sets;
+    uint64_t mask;
+    std::vector<uint64_t> table;
+};
+
+class hierarchy final : public sink
+{
+  public:
+    // counts of a level per phase
+    template <class T>
+    struct counters
+    {
+        T accesses[CACHESIM_PHASES];
+        T misses[CACHESIM_PHASES];
+        T writebacks[CACHESIM_PHASES]; // dirty lines written to the next level
+    };
+    typedef counters<double> stats;
+
+    // caches and tlbs are ordered from the level closest to the core
+    hierarchy(const std::vector<level_config> &caches, int line, const std::vector<level_config> &tlbs, long page)
+        : line_bits(log2(line)), page_bits(log2(page)), num_caches(caches.size()), current(0), counting(1)
+    {
+        for (const level_config &c : caches)
+        {
+            levels.emplace_back(c.size / line, c.ways);
+        }
+        for (const level_config &t : tlbs)
+        {
+            levels.emplace_back(t.size, t.ways);
+        }
+        reset();
+    }
+
+    void access(uint64_t addr, int bytes, bool write) override
+    {
+        uint64_t end = addr + bytes - 1;
+        for (uint64_t l = addr >> line_bits; l <= end >> line_bits; l++)
+        {
+            access_line(l, write);
+        }
+        for (uint64_t p = addr >> page_bits; p <= end >> page_bits; p++)
+        {
+            access_page(p);
+        }
+    }
+
+    void phase(int p) override { current = p; }
+
+    void count(bool on) override { counting = on; }
+
+    // clears the counts, but not the contents of the levels
+    void reset()
+    {
+        counts.assign(levels.size(), counters<uint64_t>{});
+        last_line = last_page = ~(uint64_t)0;
+        last_entry = NULL;
+    }
+
+    size_t caches() const { return num_caches; }
+    size_t tlbs() const { return levels.size() - num_caches; }
+    int line_size() const { return 1 << line_bits; }
+
+    // counts of level i (caches first, then TLBs), the counts of phase p multiplied by scale[p]
+    stats result(size_t i, const double *scale) const
+    {
+        stats s;
+        for (int p = 0; p < CACHESIM_PHASES; p++)
+        {
+            s.accesses[p] = counts[i].accesses[p] * scale[p];
+            s.misses[p] = counts[i].misses[p] * scale[p];
+            s.writebacks[p] = counts[i].writebacks[p] * scale[p];
+        }
+        return s;
+    }
+
+  private:
+    static int log2(long x)
+    {
+        int b = 0;
+        while ((1l << b) < x)
+        {
+            b++;
+        }
+        if ((1l << b) != x)
+        {
+            fprintf(stderr, "cachesim: %ld is not a power of two\n", x);
+            exit(1);
+        }
+        return b;
+    }
+
+    void access_line(uint64_t line, bool write)
+    {
+        counts[0].accesses[current] += counting;
+        // the most recently used line can't miss and stays most recently used
+        if (line == last_line)
+        {
+            *last_entry |= write;
+            return;
+        }
+        last_line = line;
+
+        for (size_t l = 0; l < num_caches; l++)
+        {
+            bool hit;
+            uint64_t victim;
+            uint64_t *e = levels[l].lookup(line, write && l == 0, &hit, &victim);
+            if (l == 0)
+            {
+                last_entry = e;
+            }
+            else
+            {
+                counts[l].accesses[current] += counting;
+            }
+            if (cache::dirty(victim))
+            {
+                write_back(l, cache::tag(victim));
+            }
+            if (hit)
+            {
+                return;
+            }
+            counts[l].misses[current] += counting;
+        }
+    }
+
+    // writes a dirty line evicted from level l back to level l + 1
+    void write_back(size_t l, uint64_t line)
+    {
+        counts[l].writebacks[current] += counting;
+        if (l + 1 == num_caches)
+        {
+            return;
+        }
+        bool hit;
+        uint64_t victim;
+        levels[l + 1].lookup(line, true, &hit, &victim);
+        if (cache::dirty(victim))
+        {
+            write_back(l + 1, cache::tag(victim));
+        }
+    }
+
+    void access_page(uint64_t page)
+    {
+        if (num_caches == levels.size())
+        {
+            return;
+        }
+        counts[num_caches].accesses[current] += counting;
+        if (page == last_page)
+        {
+            return;
+        }
+        last_page = page;
+        for (size_t l = num_caches; l < levels.size(); l++)
+        {
+            bool hit;
+            uint64_t victim;
+            levels[l].lookup(page, false, &hit, &victim);
+            if (l > num_caches)
+            {
+                counts[l].accesses[current] += counting;
+            }
+            if (hit)
+            {
+                return;
+            }
+            counts[l].misses[current] += counting;
+        }
+    }
+
+    int line_bits, page_bits;
+    size_t num_caches;
+    std::vector<cache> levels;
+    std::vector<counters<uint64_t>> counts;
+    int current;
+    int counting;
+    uint64_t last_line, last_page;
+    uint64_t *last_entry; // L1 entry of last_line
+};
+
+} // namespace cachesim
+
+#endif
@@ -0,0 +1,343 @@
+#ifndef CACHESIM_REPLAY_HPP
+#define CACHESIM_REPLAY_HPP
+
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+#include "../cpp/variants.hpp"
+#include "cachesim.hpp"
+
+// Address streams of the kernels of generic/cpp/fw.hpp.
+//
+// replay_* regenerate the stream from the loop nests of FWI_kernel, FWIabc and
+// FWT without computing anything, for any parameters and for single k-rounds.
+// To predict large n quickly, tile updates can be replaced by touching every
+// line of their tiles once, which keeps the contents of the large levels (L3,
+// STLB) close to those of the exact stream at a fraction of the accesses.
+// traced<T> is a register type for fw.hpp that reports every load, store and
+// broadcast to a sink while computing the real result, i.e. an instrumented
+// build of the kernels. Both emit the same accesses in the same order, see
+// --verify of cachesim.cpp.
+
+namespace cachesim
+{
+
+// layout of the matrix and of the registers
+struct geometry
+{
+    uint64_t base; // address of the matrix
+    int entry;     // bytes per stored matrix entry, 1 for the bit-packed tc
+    bool packed;   // bit-packed rows, i.e. bit k of a row lives in byte k / 8
+    int width;     // matrix entries per register (bytes for tc)
+    int ld;        // stored entries per matrix line
+
+    geometry(int N, bool packed, bool vector, uint64_t base)
+        : base(base), entry(packed ? 1 : 8), packed(packed), width(vector ? (packed ? 32 : 4) : 1),
+          ld(packed ? (N + 7) / 8 : N)
+    {
+    }
+
+    // stored entries per tile line, as reg<T>::cols
+    int cols(int L1) const { return packed ? (L1 + 7) / 8 : L1; }
+
+    uint64_t addr(uint64_t offset) const { return base + offset * entry; }
+
+    // offset of the upper-left entry of tile X_uv, as SUBM
+    uint64_t subm(uint64_t X, int u, int v, int L1) const { return X + (uint64_t)u * ld * L1 + v * cols(L1); }
+
+    // entry read by reg<T>::broadcast(A, ld, i, k)
+    uint64_t broadcast(uint64_t A, int i, int k) const { return A + (uint64_t)i * ld + (packed ? k / 8 : k); }
+};
+
+// FWI_kernel<S, T, Ui, Uj> on an L1 x L1 tile, restricted to k in [k0, k1)
+template <class Sink>
+void replay_fwi(Sink &s, const geometry &g, uint64_t A, uint64_t B, uint64_t C, int L1, int Ui, int Uj, int k0,
+                int k1)
+{
+    const int W = g.width;
+    const int Vj = Uj / W;
+    const int reg = W * g.entry;
+    const int cols = g.cols(L1);
+    for (int k = k0; k < k1; k++)
+    {
+        for (int i = 0; i < L1 - (Ui - 1); i += Ui)
+        {
+            for (int u = 0; u < Ui; u++)
+            {
+                s.access(g.addr(g.broadcast(A, i + u, k)), g.entry, false);
+            }
+            for (int j = 0; j < cols - (Uj - 1); j += Uj)
+            {
+                for (int u = 0; u < Ui; u++)
+                {
+                    for (int v = 0; v < Vj; v++)
+                    {
+                        s.access(g.addr(C + (uint64_t)(i + u) * g.ld + j + v * W), reg, false);
+                    }
+                }
+                for (int v = 0; v < Vj; v++)
+                {
+                    s.access(g.addr(B + (uint64_t)k * g.ld + j + v * W), reg, false);
+                }
+                for (int u = 0; u < Ui; u++)
+                {
+                    for (int v = 0; v < Vj; v++)
+                    {
+                        s.access(g.addr(C + (uint64_t)(i + u) * g.ld + j + v * W), reg, true);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// FWIabc<S, T, L1, Uii, Ujj, Ukk>
+template <class Sink>
+void replay_fwiabc(Sink &s, const geometry &g, uint64_t A, uint64_t B, uint64_t C, int L1, int Uii, int Ujj, int Ukk)
+{
+    const int W = g.width;
+    const int Vj = Ujj / W;
+    const int reg = W * g.entry;
+    const int cols = g.cols(L1);
+    for (int i = 0; i < L1; i += Uii)
+    {
+        for (int j = 0; j < cols; j += Ujj)
+        {
+            for (int k = 0; k < L1; k += Ukk)
+            {
+                for (int u = 0; u < Uii; u++)
+                {
+                    for (int w = 0; w < Ukk; w++)
+                    {
+                        s.access(g.addr(g.broadcast(A, i + u, k + w)), g.entry, false);
+                    }
+                }
+                for (int w = 0; w < Ukk; w++)
+                {
+                    for (int v = 0; v < Vj; v++)
+                    {
+                        s.access(g.addr(B + (uint64_t)(k + w) * g.ld + j + v * W), reg, false);
+                    }
+                }
+                for (int u = 0; u < Uii; u++)
+                {
+                    for (int v = 0; v < Vj; v++)
+                    {
+                        s.access(g.addr(C + (uint64_t)(i + u) * g.ld + j + v * W), reg, false);
+                    }
+                }
+                for (int u = 0; u < Uii; u++)
+                {
+                    for (int v = 0; v < Vj; v++)
+                    {
+                        s.access(g.addr(C + (uint64_t)(i + u) * g.ld + j + v * W), reg, true);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// touches every line of the L1 x L1 tile X once
+template <class Sink>
+void touch_tile(Sink &s, const geometry &g, uint64_t X, int L1, bool write)
+{
+    for (int i = 0; i < L1; i++)
+    {
+        s.access(g.addr(X + (uint64_t)i * g.ld), g.cols(L1) * g.entry, write);
+    }
+}
+
+// how a tile update is replayed
+#define REPLAY_TOUCH 0 // touch the tiles instead, uncounted
+#define REPLAY_WARM 1  // exactly, uncounted
+#define REPLAY_COUNT 2 // exactly and counted
+
+// FWI (abc false) or FWIabc on the tiles A, B and C
+template <class Sink>
+void replay_update(Sink &s, const geometry &g, const fw::params &p, bool abc, uint64_t A, uint64_t B, uint64_t C,
+                   int mode)
+{
+    s.count(mode == REPLAY_COUNT);
+    if (mode == REPLAY_TOUCH)
+    {
+        touch_tile(s, g, A, p.L1, false);
+        touch_tile(s, g, B, p.L1, false);
+        touch_tile(s, g, C, p.L1, true);
+    }
+    else if (abc)
+    {
+        replay_fwiabc(s, g, A, B, C, p.L1, p.uii, p.ujj, p.ukk);
+    }
+    else
+    {
+        replay_fwi(s, g, A, B, C, p.L1, p.ui, p.uj, 0, p.L1);
+    }
+}
+
+/*
+ * Round k of FWT<S, T, L1, Ui, Uj, Uii, Ujj, Ukk> on an N x N matrix (A = B = C).
+ * mode is applied to the tile updates of phases 1 to 3, rows[i] to tile row i
+ * of phase 4.
+ */
+template <class Sink>
+void replay_fwt_round(Sink &s, const geometry &g, const fw::params &p, int N, int k, int mode,
+                      const std::vector<char> &rows)
+{
+    const int L1 = p.L1;
+    const int M = N / L1;
+
+    s.phase(1);
+    replay_update(s, g, p, false, g.subm(0, k, k, L1), g.subm(0, k, k, L1), g.subm(0, k, k, L1), mode);
+
+    s.phase(2);
+    for (int j = 0; j < M; j++)
+    {
+        if (j != k)
+        {
+            replay_update(s, g, p, false, g.subm(0, k, k, L1), g.subm(0, k, j, L1), g.subm(0, k, j, L1), mode);
+        }
+    }
+
+    s.phase(3);
+    for (int i = 0; i < M; i++)
+    {
+        if (i != k)
+        {
+            replay_update(s, g, p, false, g.subm(0, i, k, L1), g.subm(0, k, k, L1), g.subm(0, i, k, L1), mode);
+        }
+    }
+
+    s.phase(4);
+    for (int i = 0; i < M; i++)
+    {
+        if (i != k)
+        {
+            for (int j = 0; j < M; j++)
+            {
+                if (j != k)
+                {
+                    replay_update(s, g, p, true, g.subm(0, i, k, L1), g.subm(0, k, j, L1), g.subm(0, i, j, L1),
+                                  rows[i]);
+                }
+            }
+        }
+    }
+    s.phase(0);
+    s.count(true);
+}
+
+/*
+ * Modes of the tile rows of phase 4 in round k of M: R rows spread evenly over
+ * the M - 1 rows are counted, each after the row before it as a warm-up, the
+ * others are touched. All rows are counted if R is 0 or there are too few.
+ * *counted is set to the number of counted rows.
+ */
+static inline std::vector<char> sample_rows(int M, int k, int R, int *counted)
+{
+    if (R <= 0 || 2 * R > M - 1)
+    {
+        *counted = M - 1;
+        return std::vector<char>(M, REPLAY_COUNT);
+    }
+    std::vector<char> rows(M, REPLAY_TOUCH);
+    for (int r = 0; r < R; r++)
+    {
+        // r-th row of phase 4, skipping row k
+        int x = (2 * r + 1) * (M - 1) / (2 * R);
+        int i = x < k ? x : x + 1;
+        rows[i] = REPLAY_COUNT;
+        int prev = i - 1 == k ? i - 2 : i - 1;
+        if (prev >= 0 && rows[prev] == REPLAY_TOUCH)
+        {
+            rows[prev] = REPLAY_WARM;
+        }
+    }
+    *counted = R;
+    return rows;
+}
+
+// iteration k of FWnaive, i.e. of the untiled scalar FWI on the whole matrix
+template <class Sink>
+void replay_naive_round(Sink &s, const geometry &g, int N, int k)
+{
+    replay_fwi(s, g, 0, 0, 0, N, 1, 1, k, k + 1);
+}
+
+// ---------------------------------------------------------------------------
+// instrumented kernels
+// ---------------------------------------------------------------------------
+
+// receives the accesses of traced registers, matrix is the address of the
+// matrix, which is mapped to geometry::base
+struct tracer
+{
+    sink *s;
+    const char *matrix;
+    uint64_t base;
+};
+
+inline tracer current_tracer;
+
+inline void trace(const void *p, int bytes, bool write)
+{
+    current_tracer.s->access(current_tracer.base + ((const char *)p - current_tracer.matrix), bytes, write);
+}
+
+// register of type T that reports its loads, stores and broadcasts
+template <class T>
+struct traced
+{
+    T x;
+};
+
+// semiring S on traced registers
+template <class S>
+struct traced_semiring
+{
+    template <class T>
+    static inline traced<T> plus(traced<T> x, traced<T> y)
+    {
+        return {S::plus(x.x, y.x)};
+    }
+    template <class T>
+    static inline traced<T> times(traced<T> x, traced<T> y)
+    {
+        return {S::times(x.x, y.x)};
+    }
+};
+
+} // namespace cachesim
+
+namespace fw
+{
+
+template <class T>
+struct reg<cachesim::traced<T>>
+{
+    typedef typename reg<T>::elem elem;
+    static constexpr int width = reg<T>::width;
+    static constexpr int ld(int N) { return reg<T>::ld(N); }
+    static constexpr int cols(int L1) { return reg<T>::cols(L1); }
+    static inline cachesim::traced<T> load(const elem *p)
+    {
+        cachesim::trace(p, width * sizeof(elem), false);
+        return {reg<T>::load(p)};
+    }
+    static inline void store(elem *p, cachesim::traced<T> x)
+    {
+        cachesim::trace(p, width * sizeof(elem), true);
+        reg<T>::store(p, x.x);
+    }
+    static inline cachesim::traced<T> broadcast(const elem *A, int ld, int i, int k)
+    {
+        // the bit-packed rows keep bit k in byte k / 8
+        cachesim::trace(&A[i * ld + (std::is_same<elem, char>::value ? k / 8 : k)], sizeof(elem), false);
+        return {reg<T>::broadcast(A, ld, i, k)};
+    }
+};
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,8 @@
+// The table to tune is linked in from one of the impl/template-tiles.cpp files,
+// see fw::autotune in autotune.hpp.
+extern "C" int fw_autotune(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    return fw_autotune(argc, argv) == 0 ? 0 : 1;
+}
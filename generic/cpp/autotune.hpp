@@ -0,0 +1,285 @@
+#ifndef FW_AUTOTUNE_HPP
+#define FW_AUTOTUNE_HPP
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+#include "../tunedb/tunedb.h"
+#include "tsc_x86.h"
+#include "variants.hpp"
+
+// In-process autotuner for the prebuilt tables of variants.hpp.
+//
+// Follows the same steps as autotuning/autotune.py, but times the kernels
+// directly instead of generating, building and measuring a binary per point:
+//  1. for every tile size L1 dividing n, find the best (Ui,Uj) for FWI and the
+//     best (Ui',Uj',Uk') for FWIabc by timing them on tiles of the n x n matrix
+//  2. validate the resulting FWT variants against FWnaive
+//  3. time them on the whole matrix and keep the fastest one
+// The winner is stored in the tuning database (see generic/tunedb).
+
+#define TUNE_CYCLES_REQUIRED 1e7
+#define TUNE_REPETITIONS 2
+
+// entry point for the autotune binary, defined by impl/template-tiles.cpp
+extern "C" int fw_autotune(int argc, char **argv);
+
+namespace fw
+{
+
+template <class S, class E>
+static void random_matrix(E *C, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        // tc stores bits, any byte pattern is a valid matrix
+        if constexpr (std::is_same<E, char>::value)
+        {
+            C[i] = (char)rand();
+        }
+        else
+        {
+            C[i] = (rand() % 2) ? S::zero() : (E)(1 + rand() % 9);
+        }
+    }
+}
+
+template <class E>
+static E *alloc_matrix(size_t size)
+{
+    // round up to a multiple of the alignment as required by aligned_alloc
+    size_t bytes = (size * sizeof(E) + 31) / 32 * 32;
+    return (E *)aligned_alloc(32, bytes);
+}
+
+/*
+ * Returns the minimum number of cycles of f() over enough repetitions to
+ * reach TUNE_CYCLES_REQUIRED cycles in total.
+ */
+template <class F>
+static double time_min(F f)
+{
+    double best = INFINITY;
+    double total = 0;
+    int runs = 0;
+    while (total < TUNE_CYCLES_REQUIRED || runs < 3)
+    {
+        myInt64 start = start_tsc();
+        f();
+        double cycles = (double)stop_tsc(start);
+        total += cycles;
+        best = cycles < best ? cycles : best;
+        runs++;
+    }
+    return best;
+}
+
+/*
+ * Runs v on a random (2 L1) x (2 L1) matrix, which covers all phases of FWT,
+ * and compares the result against FWnaive.
+ */
+template <class S, class T>
+static bool validate(const variant<typename reg<T>::elem> &v)
+{
+    typedef typename reg<T>::elem E;
+    int N = 2 * v.L1;
+    size_t size = (size_t)N * reg<T>::ld(N);
+    E *C = alloc_matrix<E>(size);
+    E *D = alloc_matrix<E>(size);
+    random_matrix<S, E>(C, size);
+    memcpy(D, C, size * sizeof(E));
+
+    v.run(C, C, C, N);
+    FWnaive<S, T>(D, N);
+
+    bool ok = memcmp(C, D, size * sizeof(E)) == 0;
+    free(C);
+    free(D);
+    return ok;
+}
+
+// index into the table of the variant with the given parameters
+template <class E>
+static int index_of(const std::vector<variant<E>> &table, int L1, int ui, int uj, int uii, int ujj, int ukk)
+{
+    params p = {L1, ui, uj, uii, ujj, ukk};
+    const variant<E> *v = find(table, p);
+    return v == NULL ? -1 : (int)(v - table.data());
+}
+
+/*
+ * Finds the best variant of table for an n x n matrix.
+ * Returns the index of the winner or -1 if no variant fits n.
+ */
+template <class S, class T>
+static int tune(const std::vector<variant<typename reg<T>::elem>> &table, int n, double *winner_cycles)
+{
+    typedef typename reg<T>::elem E;
+    int ld = reg<T>::ld(n);
+    size_t size = (size_t)n * ld;
+    E *C = alloc_matrix<E>(size);
+    E *D = alloc_matrix<E>(size);
+    random_matrix<S, E>(D, size);
+
+    // step 1: best unrolling factors per tile size
+    std::vector<int> candidates;
+    std::vector<int> tile_sizes;
+    for (const variant<E> &v : table)
+    {
+        if (n % v.L1 == 0 && (tile_sizes.empty() || tile_sizes.back() != v.L1))
+        {
+            tile_sizes.push_back(v.L1);
+        }
+    }
+    for (int L1 : tile_sizes)
+    {
+        // tiles (0,0), (0,1), (1,0) and (1,1), or four times (0,0) if n = L1
+        int o = n > L1 ? 1 : 0;
+        E *T00 = SUBM<T>(C, 0, 0, ld, L1);
+        E *T01 = SUBM<T>(C, 0, o, ld, L1);
+        E *T10 = SUBM<T>(C, o, 0, ld, L1);
+        E *T11 = SUBM<T>(C, o, o, ld, L1);
+
+        double best_fwi = INFINITY, best_fwiabc = INFINITY;
+        const variant<E> *fwi = NULL, *fwiabc = NULL;
+        // the table contains each kernel several times, only time it once
+        std::vector<void *> timed;
+        for (const variant<E> &v : table)
+        {
+            if (v.L1 != L1)
+            {
+                continue;
+            }
+            if (std::find(timed.begin(), timed.end(), (void *)v.fwi) == timed.end())
+            {
+                timed.push_back((void *)v.fwi);
+                memcpy(C, D, size * sizeof(E));
+                double cycles = time_min([&]() { v.fwi(T00, T01, T01, ld); });
+                if (cycles < best_fwi)
+                {
+                    best_fwi = cycles;
+                    fwi = &v;
+                }
+            }
+            if (std::find(timed.begin(), timed.end(), (void *)v.fwiabc) == timed.end())
+            {
+                timed.push_back((void *)v.fwiabc);
+                memcpy(C, D, size * sizeof(E));
+                double cycles = time_min([&]() { v.fwiabc(T10, T01, T11, ld); });
+                if (cycles < best_fwiabc)
+                {
+                    best_fwiabc = cycles;
+                    fwiabc = &v;
+                }
+            }
+        }
+        fprintf(stderr, "L1 = %d: FWI (Ui,Uj) = (%d, %d), FWIabc (Ui',Uj',Uk') = (%d, %d, %d)\n",
+                L1, fwi->ui, fwi->uj, fwiabc->uii, fwiabc->ujj, fwiabc->ukk);
+        candidates.push_back(index_of(table, L1, fwi->ui, fwi->uj, fwiabc->uii, fwiabc->ujj, fwiabc->ukk));
+    }
+
+    // steps 2 and 3: validate and time the candidates on the whole matrix
+    int winner = -1;
+    *winner_cycles = INFINITY;
+    for (int i : candidates)
+    {
+        const variant<E> &v = table[i];
+        if (!validate<S, T>(v))
+        {
+            fprintf(stderr, "validation failed for (%d, %d, %d, %d, %d, %d), skipping\n",
+                    v.L1, v.ui, v.uj, v.uii, v.ujj, v.ukk);
+            continue;
+        }
+
+        double best = INFINITY;
+        for (int r = 0; r < TUNE_REPETITIONS; r++)
+        {
+            memcpy(C, D, size * sizeof(E));
+            myInt64 start = start_tsc();
+            v.run(C, C, C, n);
+            double cycles = (double)stop_tsc(start);
+            best = cycles < best ? cycles : best;
+        }
+        fprintf(stderr, "FWT (%d, %d, %d, %d, %d, %d): %.0f cycles\n",
+                v.L1, v.ui, v.uj, v.uii, v.ujj, v.ukk, best);
+        if (best < *winner_cycles)
+        {
+            *winner_cycles = best;
+            winner = i;
+        }
+    }
+
+    free(C);
+    free(D);
+    return winner;
+}
+
+/*
+ * Command line driver: autotune [-o tunedb.csv] n1 [n2 ...]
+ * algo is the name of the algorithm the table belongs to (fw, mm or tc).
+ * Prints the optimal parameters per n in the format of optimal-parameters.log
+ * and stores them in the tuning database, FW_TUNEDB or TUNEDB_PATH unless -o
+ * is given.
+ */
+template <class S, class T>
+int autotune(const std::vector<variant<typename reg<T>::elem>> &table, const char *algo, int argc, char **argv)
+{
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            setenv("FW_TUNEDB", argv[++i], 1);
+        }
+        else if (atoi(argv[i]) > 0)
+        {
+            sizes.push_back(atoi(argv[i]));
+        }
+        else
+        {
+            fprintf(stderr, "call as: %s [-o tunedb.csv] n1 [n2 ...]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (sizes.empty())
+    {
+        fprintf(stderr, "call as: %s [-o tunedb.csv] n1 [n2 ...]\n", argv[0]);
+        return -1;
+    }
+
+    struct tunedb_cpu cpu;
+    tunedb_cpu(&cpu);
+    fprintf(stderr, "tuning %zu %s variants on family %d model %d (L1d %d KiB, L2 %d KiB, L3 %d KiB)\n",
+            table.size(), algo, cpu.family, cpu.model, cpu.l1d, cpu.l2, cpu.l3);
+
+    for (int n : sizes)
+    {
+        double cycles;
+        int w = tune<S, T>(table, n, &cycles);
+        if (w < 0)
+        {
+            fprintf(stderr, "no variant fits n = %d, skipping\n", n);
+            continue;
+        }
+        const variant<typename reg<T>::elem> &v = table[w];
+        params p = {v.L1, v.ui, v.uj, v.uii, v.ujj, v.ukk};
+        printf("\n        Optimal parameters for N = %d:\n", n);
+        printf("            - FWT (L1, Ui, Uj, Ui', Uj'. Uk'): (%d, %d, %d, %d, %d, %d)\n\n",
+               p.L1, p.ui, p.uj, p.uii, p.ujj, p.ukk);
+        struct tunedb_entry e = {p.L1, p.ui, p.uj, p.uii, p.ujj, p.ukk, cycles};
+        if (tunedb_store(algo, n, &e) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,8 @@
+// The batch API to benchmark is linked in from one of the impl/template-tiles.cpp
+// files, see fw::batch_bench in batch.hpp.
+extern "C" int fw_batch_bench(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    return fw_batch_bench(argc, argv) == 0 ? 0 : 1;
+}
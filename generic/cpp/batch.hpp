@@ -0,0 +1,497 @@
+#ifndef FW_BATCH_HPP
+#define FW_BATCH_HPP
+
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "autotune.hpp"
+#include "fixed.hpp"
+#include "fw.hpp"
+
+// Batched FW for many small graphs of the same size.
+//
+// For small n, a single call of floydWarshall is dominated by loop overhead
+// and partially filled registers. Instead, the graphs of a batch are packed in
+// groups into an interleaved (struct-of-arrays) layout where one register
+// holds the same entry (i, j) of every graph of the group, so a single stream
+// of vector instructions runs FW on all of them at once:
+// - fw and mm: entry (i, j) of graph g of the group is G[(i * N + j) * W + g],
+//   i.e. 4 graphs per __m256d
+// - tc: the bits are sliced across the graphs, bit g of the W bytes of entry
+//   (i, j) is entry (i, j) of graph g, i.e. 256 graphs per __m256i
+// The groups are spread over threads, every thread packs, solves and unpacks
+// one group at a time in its own buffer.
+//
+// Interleaving only pays off while a single graph leaves the registers partly
+// empty. For fw and mm that ends at n = 32, where a row of one graph fills the
+// registers of the tuned kernels, and an interleaved group does the same work
+// per graph with more memory traffic: it ties at n = 33 to 48 and loses at 96
+// and 128. Above reg<interleaved<T>>::max_n, and for the n of the kernels of
+// fixed.hpp (8, 16, 32 and 64), batch is therefore no more than a loop over
+// the graphs on threads that calls the kernel of a single graph for each.
+
+// entry point for the batch benchmark binary, defined by impl/template-tiles.cpp
+extern "C" int fw_batch_bench(int argc, char **argv);
+
+namespace fw
+{
+
+// ---------------------------------------------------------------------------
+// interleaved register types
+//
+// reg<interleaved<T>> describes a group in the interleaved layout for the
+// register type T, where entry (i, k) of a row is a register of its own:
+// broadcast loads it instead of replicating a single entry. Every kernel of
+// fw.hpp then runs on the whole group as if it was a single matrix whose
+// entries are stride elems wide. interleaved<T> wraps T, so it only differs
+// from T in the specialization of reg it selects.
+// graphs: number of graphs per group
+// stride: number of elems per entry (i, j) of the group
+// max_n:  largest n for which a group beats solving its graphs one after the
+//         other with impl/template-tiles.cpp, as measured with batch_bench
+// beats_fixed: whether a group also beats the kernels of fixed.hpp
+// ---------------------------------------------------------------------------
+template <class T>
+struct interleaved
+{
+    T x;
+    interleaved() = default;
+    interleaved(T x) : x(x) {}
+    operator T() const { return x; }
+};
+
+template <>
+struct reg<interleaved<double>>
+{
+    typedef double elem;
+    static constexpr int width = 1;
+    static constexpr int graphs = 1;
+    static constexpr int stride = 1;
+    static constexpr int max_n = 31;
+    static constexpr bool beats_fixed = false;
+    static constexpr int ld(int N) { return N; }
+    static constexpr int cols(int L1) { return L1; }
+    static inline double load(const double *p) { return *p; }
+    static inline void store(double *p, double x) { *p = x; }
+    static inline double broadcast(const double *A, int ld, int i, int k) { return A[i * ld + k]; }
+};
+
+// attributes of __m256d and __m256i ignored as template arguments, see reg in fw.hpp
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+template <>
+struct reg<interleaved<__m256d>>
+{
+    typedef double elem;
+    static constexpr int width = 4;
+    static constexpr int graphs = 4;
+    static constexpr int stride = 4;
+    static constexpr int max_n = 31;
+    static constexpr bool beats_fixed = false;
+    static constexpr int ld(int N) { return 4 * N; }
+    static constexpr int cols(int L1) { return 4 * L1; }
+    static inline __m256d load(const double *p) { return _mm256_load_pd(p); }
+    static inline void store(double *p, __m256d x) { _mm256_store_pd(p, x); }
+    static inline __m256d broadcast(const double *A, int ld, int i, int k) { return _mm256_load_pd(&A[i * ld + 4 * k]); }
+};
+#pragma GCC diagnostic pop
+
+// transitive closure: bit g of the bytes of an entry belongs to graph g
+template <>
+struct reg<interleaved<char>>
+{
+    typedef char elem;
+    static constexpr int width = 1;
+    static constexpr int graphs = 8;
+    static constexpr int stride = 1;
+    static constexpr int max_n = 64;
+    static constexpr bool beats_fixed = false;
+    static constexpr int ld(int N) { return N; }
+    static constexpr int cols(int L1) { return L1; }
+    static inline char load(const char *p) { return *p; }
+    static inline void store(char *p, char x) { *p = x; }
+    static inline char broadcast(const char *A, int ld, int i, int k) { return A[i * ld + k]; }
+};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+template <>
+struct reg<interleaved<__m256i>>
+{
+    typedef char elem;
+    static constexpr int width = 32;
+    static constexpr int graphs = 256;
+    static constexpr int stride = 32;
+    static constexpr int max_n = 255;
+    static constexpr bool beats_fixed = true;
+    static constexpr int ld(int N) { return 32 * N; }
+    static constexpr int cols(int L1) { return 32 * L1; }
+    static inline __m256i load(const char *p) { return _mm256_load_si256((__m256i const *)p); }
+    static inline void store(char *p, __m256i x) { _mm256_store_si256((__m256i *)p, x); }
+    static inline __m256i broadcast(const char *A, int ld, int i, int k)
+    {
+        return _mm256_load_si256((__m256i const *)&A[i * ld + 32 * k]);
+    }
+};
+#pragma GCC diagnostic pop
+
+// tile size of FWbatch, three tiles of a group take 24 KiB
+#define BATCH_L1 16
+
+// FW on a group of graphs in the interleaved layout: FWT if BATCH_L1 divides
+// N, FWI on the whole group otherwise
+template <class S, class T>
+int FWbatch(typename reg<interleaved<T>>::elem *G, int N)
+{
+    typedef interleaved<T> I;
+    constexpr int W = reg<I>::width;
+    if (N % BATCH_L1 == 0)
+    {
+        return FWT<S, I, BATCH_L1, 4, 2 * W, 2, 2 * W, 2>(G, G, G, N);
+    }
+    if (N % 4 == 0)
+    {
+        FWI_kernel<S, I, 4, 2 * W>(G, G, G, reg<I>::ld(N), N);
+    }
+    else
+    {
+        FWI_kernel<S, I, 1, W>(G, G, G, reg<I>::ld(N), N);
+    }
+    return 0;
+}
+
+// Transposes the 8 x 8 bit matrix x, byte r holds row r with column c in bit c.
+static inline uint64_t transpose8(uint64_t x)
+{
+    x = (x & 0xaa55aa55aa55aa55ULL) | ((x & 0x00aa00aa00aa00aaULL) << 7) | ((x >> 7) & 0x00aa00aa00aa00aaULL);
+    x = (x & 0xcccc3333cccc3333ULL) | ((x & 0x0000cccc0000ccccULL) << 14) | ((x >> 14) & 0x0000cccc0000ccccULL);
+    x = (x & 0xf0f0f0f00f0f0f0fULL) | ((x & 0x00000000f0f0f0f0ULL) << 28) | ((x >> 28) & 0x00000000f0f0f0f0ULL);
+    return x;
+}
+
+// Copies the count <= reg<interleaved<T>>::graphs matrices C[0 .. count - 1] into the group G.
+template <class T>
+void pack(typename reg<interleaved<T>>::elem *G, double *const *C, int N, int count)
+{
+    constexpr int W = reg<interleaved<T>>::stride;
+    size_t size = (size_t)N * N;
+    memset(G, 0, size * W * sizeof(G[0]));
+    for (int g = 0; g < count; g++)
+    {
+        for (size_t e = 0; e < size; e++)
+        {
+            G[e * W + g] = C[g][e];
+        }
+    }
+}
+
+template <class T>
+void unpack(double *const *C, const typename reg<interleaved<T>>::elem *G, int N, int count)
+{
+    constexpr int W = reg<interleaved<T>>::stride;
+    size_t size = (size_t)N * N;
+    for (int g = 0; g < count; g++)
+    {
+        for (size_t e = 0; e < size; e++)
+        {
+            C[g][e] = G[e * W + g];
+        }
+    }
+}
+
+// Bit-packed matrices: the bytes of 8 graphs at the same position are an 8 x 8
+// bit matrix, its transpose holds the bits of 8 entries (i, j) of the group.
+template <class T>
+void pack(typename reg<interleaved<T>>::elem *G, char *const *C, int N, int count)
+{
+    constexpr int W = reg<interleaved<T>>::stride;
+    const int bpl = reg<char>::ld(N);
+    memset(G, 0, (size_t)N * N * W);
+    for (int o = 0; o * 8 < count; o++)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int jb = 0; jb < bpl; jb++)
+            {
+                uint64_t x = 0;
+                for (int t = 0; t < 8 && o * 8 + t < count; t++)
+                {
+                    x |= (uint64_t)(unsigned char)C[o * 8 + t][i * bpl + jb] << (8 * t);
+                }
+                x = transpose8(x);
+                for (int b = 0; b < 8 && jb * 8 + b < N; b++)
+                {
+                    G[((size_t)i * N + jb * 8 + b) * W + o] = (char)(x >> (8 * b));
+                }
+            }
+        }
+    }
+}
+
+// keeps the padding bits of the last byte of every row
+template <class T>
+void unpack(char *const *C, const typename reg<interleaved<T>>::elem *G, int N, int count)
+{
+    constexpr int W = reg<interleaved<T>>::stride;
+    const int bpl = reg<char>::ld(N);
+    for (int o = 0; o * 8 < count; o++)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int jb = 0; jb < bpl; jb++)
+            {
+                uint64_t x = 0;
+                for (int b = 0; b < 8 && jb * 8 + b < N; b++)
+                {
+                    x |= (uint64_t)(unsigned char)G[((size_t)i * N + jb * 8 + b) * W + o] << (8 * b);
+                }
+                x = transpose8(x);
+                char valid = N - jb * 8 >= 8 ? (char)0xff : (char)((1 << (N - jb * 8)) - 1);
+                for (int t = 0; t < 8 && o * 8 + t < count; t++)
+                {
+                    char &c = C[o * 8 + t][i * bpl + jb];
+                    c = (char)((c & ~valid) | ((char)(x >> (8 * t)) & valid));
+                }
+            }
+        }
+    }
+}
+
+// whether batch solves graphs of size N in groups
+template <class S, class T>
+bool interleave(int N)
+{
+    typedef interleaved<T> I;
+    return N <= reg<I>::max_n && (reg<I>::beats_fixed || fixed<S, T>(N) == NULL);
+}
+
+// calls f(0, t) ... f(count - 1, t) on threads threads, t is the thread index
+template <class F>
+static void parallel_for(int count, int threads, F f)
+{
+    std::atomic<int> next(0);
+    auto work = [&](int t) {
+        for (int g = next++; g < count; g = next++)
+        {
+            f(g, t);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads && t < count; t++)
+    {
+        pool.emplace_back(work, t);
+    }
+    work(0);
+    for (std::thread &t : pool)
+    {
+        t.join();
+    }
+}
+
+/*
+ * Runs FW on the count N x N matrices C[0 .. count - 1] with threads threads,
+ * all cores if threads <= 0. Up to reg<interleaved<T>>::max_n, the graphs are
+ * solved in groups in the interleaved layout, unless the kernels of fixed.hpp
+ * are faster for N, the last group with single, one graph after the other, if
+ * less than half of its lanes would be used. Otherwise this is only a thread
+ * loop that calls single for every graph. single is called once before any
+ * other thread is started.
+ */
+template <class S, class T>
+int batch(typename reg<interleaved<T>>::elem *const *C, int N, int count, int threads,
+          int (*single)(typename reg<interleaved<T>>::elem *C, int N))
+{
+    typedef interleaved<T> I;
+    typedef typename reg<I>::elem E;
+    constexpr int L = reg<I>::graphs;
+    if (N <= 0 || count <= 0)
+    {
+        return 0;
+    }
+    if (threads <= 0)
+    {
+        threads = (int)std::thread::hardware_concurrency();
+    }
+
+    int groups = 0;
+    int rest = count;
+    if (interleave<S, T>(N))
+    {
+        groups = count / L;
+        rest = count % L;
+        if (rest >= (L + 1) / 2)
+        {
+            groups++;
+            rest = 0;
+        }
+    }
+    if (rest > 0 && single(C[count - rest], N) != 0)
+    {
+        return -1;
+    }
+    std::atomic<bool> failed(false);
+    parallel_for(rest - 1, threads, [&](int g, int) {
+        if (single(C[count - rest + 1 + g], N) != 0)
+        {
+            failed = true;
+        }
+    });
+
+    size_t size = (size_t)N * N * reg<I>::stride;
+    // one buffer per thread
+    std::vector<E *> buffers(threads, NULL);
+    parallel_for(groups, threads, [&](int g, int t) {
+        if (buffers[t] == NULL)
+        {
+            buffers[t] = alloc_matrix<E>(size);
+        }
+        int n = count - rest - g * L < L ? count - rest - g * L : L;
+        pack<T>(buffers[t], &C[g * L], N, n);
+        FWbatch<S, T>(buffers[t], N);
+        unpack<T>(&C[g * L], buffers[t], N, n);
+    });
+    for (E *G : buffers)
+    {
+        free(G);
+    }
+    return failed ? -1 : 0;
+}
+
+// compares the entries of two matrices, ignoring the padding bits of tc
+template <class E>
+static bool same_matrix(const E *C, const E *D, int N)
+{
+    const int ld = reg<E>::ld(N);
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+        {
+            bool equal;
+            if constexpr (std::is_same<E, char>::value)
+            {
+                equal = ((C[i * ld + j / 8] ^ D[i * ld + j / 8]) & (1 << (j % 8))) == 0;
+            }
+            else
+            {
+                equal = C[i * ld + j] == D[i * ld + j];
+            }
+            if (!equal)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Command line driver: batch [-c count] [-j threads] n1 [n2 ...]
+ * Times count random graphs per n, solved one after the other with single and
+ * with batch on one and on all threads, validates the batch against FWnaive
+ * and prints the cycles per graph.
+ */
+template <class S, class T>
+int batch_bench(const char *algo, int (*single)(typename reg<interleaved<T>>::elem *C, int N), int argc, char **argv)
+{
+    typedef typename reg<interleaved<T>>::elem E;
+    int count = 1024;
+    int threads = (int)std::thread::hardware_concurrency();
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (atoi(argv[i]) > 0)
+        {
+            sizes.push_back(atoi(argv[i]));
+        }
+        else
+        {
+            sizes.clear();
+            break;
+        }
+    }
+    if (sizes.empty() || count <= 0 || threads <= 0)
+    {
+        fprintf(stderr, "call as: %s [-c count] [-j threads] n1 [n2 ...]\n", argv[0]);
+        return -1;
+    }
+
+    fprintf(stderr, "%s: %d graphs per n, %d graphs per group, %d threads\n", algo, count, reg<interleaved<T>>::graphs, threads);
+    printf("%6s %14s %14s %14s %9s %9s  %s\n", "n", "single", "batch", "batch (-j)", "speedup", "(-j)", "layout");
+    for (int n : sizes)
+    {
+        size_t size = (size_t)n * reg<E>::ld(n);
+        std::vector<E *> C(count), D(count);
+        for (int g = 0; g < count; g++)
+        {
+            C[g] = alloc_matrix<E>(size);
+            D[g] = alloc_matrix<E>(size);
+            random_matrix<S, E>(D[g], size);
+        }
+        auto reset = [&]() {
+            for (int g = 0; g < count; g++)
+            {
+                memcpy(C[g], D[g], size * sizeof(E));
+            }
+        };
+
+        // best of TUNE_REPETITIONS, the copies are not timed
+        double cycles[3] = {INFINITY, INFINITY, INFINITY};
+        for (int r = 0; r < TUNE_REPETITIONS; r++)
+        {
+            reset();
+            myInt64 start = start_tsc();
+            for (int g = 0; g < count; g++)
+            {
+                single(C[g], n);
+            }
+            cycles[0] = fmin(cycles[0], (double)stop_tsc(start) / count);
+
+            reset();
+            start = start_tsc();
+            batch<S, T>(C.data(), n, count, 1, single);
+            cycles[1] = fmin(cycles[1], (double)stop_tsc(start) / count);
+
+            reset();
+            start = start_tsc();
+            batch<S, T>(C.data(), n, count, threads, single);
+            cycles[2] = fmin(cycles[2], (double)stop_tsc(start) / count);
+        }
+
+        // the last batch against FWnaive
+        int wrong = 0;
+        for (int g = 0; g < count; g++)
+        {
+            FWnaive<S, E>(D[g], n);
+            wrong += !same_matrix<E>(C[g], D[g], n);
+            free(C[g]);
+            free(D[g]);
+        }
+        if (wrong > 0)
+        {
+            fprintf(stderr, "validation failed for %d of %d graphs with n = %d\n", wrong, count, n);
+            return -1;
+        }
+        printf("%6d %14.0f %14.0f %14.0f %8.2fx %8.2fx  %s\n", n, cycles[0], cycles[1], cycles[2],
+               cycles[0] / cycles[1], cycles[0] / cycles[2],
+               interleave<S, T>(n) ? "interleaved" : "single");
+    }
+    return 0;
+}
+
+} // namespace fw
+
+#endif
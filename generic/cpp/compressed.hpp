@@ -0,0 +1,467 @@
+#ifndef FW_COMPRESSED_HPP
+#define FW_COMPRESSED_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Compressed transitive closure, for the query server (-z).
+//
+// The bit-packed closure still takes N^2 / 8 bytes, 1.25 GB at N = 100k,
+// although its rows are very repetitive: every vertex of a strongly connected
+// component has the same row, and so do the vertices whose only way out leads
+// into the same component. So the closure is stored as its distinct rows and
+// the distinct row of every vertex, which are found by a hash of the rows.
+//
+// A distinct row is split into chunks of 2^16 columns, like a roaring bitmap,
+// and every chunk with a column set is stored in the smallest of:
+// - array: the set columns, 2 bytes each, for sparse chunks
+// - runs: the first column and the length - 1 of every run of set columns,
+//   4 bytes per run, e.g. for the rows of a giant component
+// - bitmap: the 8 KB of the chunk as it is
+// reach(u, v) and for_each(u) only decode the chunks they touch.
+//
+// The closure is built one row at a time, so the N^2 bits are never held at
+// once: from the rows of a closure, or from the graph, component by component.
+
+namespace fw
+{
+
+#define COMPRESSED_CHUNK_BITS 16
+#define COMPRESSED_CHUNK (1 << COMPRESSED_CHUNK_BITS)
+// 64 bit words of a bitmap
+#define COMPRESSED_BITMAP_WORDS (COMPRESSED_CHUNK / 64)
+
+class compressed_closure
+{
+public:
+    /*
+     * Compresses the closure of N vertices whose row u is written by
+     * row(u, bits), into words() cleared words of bits.
+     */
+    template <class F>
+    compressed_closure(int N, F row) : compressed_closure(N)
+    {
+        row_index index;
+        std::vector<uint64_t> bits(words());
+        for (int u = 0; u < N; u++)
+        {
+            std::fill(bits.begin(), bits.end(), 0);
+            row(u, bits.data());
+            row_of[u] = add(index, bits.data());
+        }
+    }
+
+    /*
+     * The closure of the graph of N vertices whose edges leave a for
+     * targets[offsets[a]] to targets[offsets[a + 1] - 1]. The strongly
+     * connected components are found with Tarjan's algorithm, which completes
+     * a component after all components it reaches, so the row of a component
+     * is the union of the rows of the components its edges lead to, and of
+     * the component itself if it has a cycle.
+     */
+    compressed_closure(int N, const uint64_t *offsets, const uint32_t *targets) : compressed_closure(N)
+    {
+        row_index index;
+        std::vector<uint64_t> bits(words());
+        std::vector<int> order(N, -1), low(N), comp(N, -1), stack;
+        std::vector<uint32_t> comp_row;
+        std::vector<int> single; // the vertex of a component without a cycle, -1 otherwise
+        std::vector<int> seen;   // the last component that added the row of a component
+        std::vector<std::pair<int, uint64_t>> path; // of the search, with the next edge of every vertex
+        int visited = 0;
+        for (int root = 0; root < N; root++)
+        {
+            if (order[root] >= 0)
+            {
+                continue;
+            }
+            order[root] = low[root] = visited++;
+            stack.push_back(root);
+            path.push_back({root, offsets[root]});
+            while (!path.empty())
+            {
+                const int a = path.back().first;
+                if (path.back().second < offsets[a + 1])
+                {
+                    const int b = targets[path.back().second++];
+                    if (order[b] < 0)
+                    {
+                        order[b] = low[b] = visited++;
+                        stack.push_back(b);
+                        path.push_back({b, offsets[b]});
+                    }
+                    else if (comp[b] < 0)
+                    {
+                        low[a] = std::min(low[a], order[b]);
+                    }
+                    continue;
+                }
+                path.pop_back();
+                if (!path.empty())
+                {
+                    low[path.back().first] = std::min(low[path.back().first], low[a]);
+                }
+                if (low[a] != order[a])
+                {
+                    continue;
+                }
+
+                // a is the root of the component c, the vertices above it on the stack
+                const int c = comp_row.size();
+                const size_t members = std::find(stack.rbegin(), stack.rend(), a) - stack.rbegin() + 1;
+                for (size_t m = stack.size() - members; m < stack.size(); m++)
+                {
+                    comp[stack[m]] = c;
+                }
+                seen.push_back(-1);
+                std::fill(bits.begin(), bits.end(), 0);
+                bool cycle = members > 1;
+                for (size_t m = stack.size() - members; m < stack.size(); m++)
+                {
+                    for (uint64_t x = offsets[stack[m]]; x < offsets[stack[m] + 1]; x++)
+                    {
+                        const int d = comp[targets[x]];
+                        cycle = cycle || targets[x] == (uint32_t)stack[m];
+                        if (d != c && seen[d] != c)
+                        {
+                            seen[d] = c;
+                            or_row(comp_row[d], bits.data());
+                            if (single[d] >= 0)
+                            {
+                                bits[single[d] / 64] |= (uint64_t)1 << (single[d] % 64);
+                            }
+                        }
+                    }
+                }
+                for (size_t m = stack.size() - members; cycle && m < stack.size(); m++)
+                {
+                    bits[stack[m] / 64] |= (uint64_t)1 << (stack[m] % 64);
+                }
+                const uint32_t r = add(index, bits.data());
+                for (size_t m = stack.size() - members; m < stack.size(); m++)
+                {
+                    row_of[stack[m]] = r;
+                }
+                comp_row.push_back(r);
+                single.push_back(cycle ? -1 : a);
+                stack.resize(stack.size() - members);
+            }
+        }
+    }
+
+    // of the rows passed to the constructor, the columns of whole chunks
+    size_t words() const { return (size_t)keys() * COMPRESSED_BITMAP_WORDS; }
+
+    int size() const { return N; }
+    int distinct_rows() const { return row_start.size() - 1; }
+
+    // of the whole representation
+    size_t bytes() const
+    {
+        return row_of.size() * sizeof(uint32_t) + row_start.size() * sizeof(uint64_t) +
+               chunks.size() * sizeof(chunk) + values.size() * sizeof(uint16_t) + bitmaps.size() * sizeof(uint64_t);
+    }
+
+    // v is reachable from u
+    bool reach(int u, int v) const
+    {
+        const chunk *c = find_chunk(row_of[u], v >> COMPRESSED_CHUNK_BITS);
+        if (c == NULL)
+        {
+            return false;
+        }
+        const uint16_t low = v & (COMPRESSED_CHUNK - 1);
+        switch (c->type)
+        {
+        case ARRAY:
+        {
+            const uint16_t *a = &values[c->offset];
+            int lo = 0, hi = c->count;
+            while (lo < hi)
+            {
+                int mid = (lo + hi) / 2;
+                if (a[mid] < low)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            return lo < (int)c->count && a[lo] == low;
+        }
+        case RUNS:
+        {
+            // the last run that starts at or before low
+            const uint16_t *runs = &values[c->offset];
+            int lo = 0, hi = c->count;
+            while (lo < hi)
+            {
+                int mid = (lo + hi) / 2;
+                if (runs[2 * mid] <= low)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            return lo > 0 && low - runs[2 * (lo - 1)] <= runs[2 * (lo - 1) + 1];
+        }
+        default:
+            return (bitmaps[c->offset + low / 64] >> (low % 64)) & 1;
+        }
+    }
+
+    /* Calls f(v) for every v reachable from u, in ascending order. */
+    template <class F>
+    void for_each(int u, F f) const
+    {
+        const uint32_t r = row_of[u];
+        for (uint64_t x = row_start[r]; x < row_start[r + 1]; x++)
+        {
+            const chunk &c = chunks[x];
+            const int base = c.key << COMPRESSED_CHUNK_BITS;
+            if (c.type == ARRAY)
+            {
+                for (uint32_t y = 0; y < c.count; y++)
+                {
+                    f(base + values[c.offset + y]);
+                }
+            }
+            else if (c.type == RUNS)
+            {
+                for (uint32_t y = 0; y < c.count; y++)
+                {
+                    const int start = base + values[c.offset + 2 * y];
+                    for (int v = start; v <= start + values[c.offset + 2 * y + 1]; v++)
+                    {
+                        f(v);
+                    }
+                }
+            }
+            else
+            {
+                for (int w = 0; w < COMPRESSED_BITMAP_WORDS; w++)
+                {
+                    for (uint64_t word = bitmaps[c.offset + w]; word != 0; word &= word - 1)
+                    {
+                        f(base + w * 64 + __builtin_ctzll(word));
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    enum chunk_type : uint8_t
+    {
+        ARRAY,
+        RUNS,
+        BITMAP
+    };
+
+    struct chunk
+    {
+        uint32_t key;     // columns [key * 2^16, (key + 1) * 2^16)
+        chunk_type type;
+        uint32_t count;   // values of an array, runs
+        uint64_t offset;  // into values, or bitmaps
+    };
+
+    // the distinct rows by hash
+    typedef std::unordered_multimap<uint64_t, uint32_t> row_index;
+
+    explicit compressed_closure(int N) : N(N), row_of(N), row_start(1, 0) {}
+
+    int keys() const { return (N + COMPRESSED_CHUNK - 1) / COMPRESSED_CHUNK; }
+
+    /* The distinct row of row, which is encoded if it's a new one. */
+    uint32_t add(row_index &index, const uint64_t *row)
+    {
+        uint64_t h = 0x9e3779b97f4a7c15ull;
+        for (size_t w = 0; w < words(); w++)
+        {
+            h = (h ^ row[w]) * 0xff51afd7ed558ccdull;
+            h ^= h >> 32;
+        }
+        auto range = index.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (same_row(it->second, row))
+            {
+                return it->second;
+            }
+        }
+        const uint32_t r = distinct_rows();
+        index.emplace(h, r);
+        encode(row);
+        return r;
+    }
+
+    // ors the chunk c into bits, the words of its columns
+    void or_chunk(const chunk &c, uint64_t *bits) const
+    {
+        if (c.type == ARRAY)
+        {
+            for (uint32_t y = 0; y < c.count; y++)
+            {
+                const uint16_t v = values[c.offset + y];
+                bits[v / 64] |= (uint64_t)1 << (v % 64);
+            }
+        }
+        else if (c.type == RUNS)
+        {
+            for (uint32_t y = 0; y < c.count; y++)
+            {
+                const int start = values[c.offset + 2 * y], end = start + values[c.offset + 2 * y + 1];
+                for (int v = start; v <= end; v++)
+                {
+                    bits[v / 64] |= (uint64_t)1 << (v % 64);
+                }
+            }
+        }
+        else
+        {
+            for (int w = 0; w < COMPRESSED_BITMAP_WORDS; w++)
+            {
+                bits[w] |= bitmaps[c.offset + w];
+            }
+        }
+    }
+
+    // ors the distinct row r into row, of words() words
+    void or_row(uint32_t r, uint64_t *row) const
+    {
+        for (uint64_t x = row_start[r]; x < row_start[r + 1]; x++)
+        {
+            or_chunk(chunks[x], &row[(size_t)chunks[x].key * COMPRESSED_BITMAP_WORDS]);
+        }
+    }
+
+    bool same_row(uint32_t r, const uint64_t *row) const
+    {
+        uint64_t bits[COMPRESSED_BITMAP_WORDS];
+        uint64_t x = row_start[r];
+        for (int key = 0; key < keys(); key++)
+        {
+            memset(bits, 0, sizeof(bits));
+            if (x < row_start[r + 1] && chunks[x].key == (uint32_t)key)
+            {
+                or_chunk(chunks[x++], bits);
+            }
+            if (memcmp(bits, &row[(size_t)key * COMPRESSED_BITMAP_WORDS], sizeof(bits)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // first bit of bits at or after b that is set, or clear, COMPRESSED_CHUNK if there is none
+    static int next_bit(const uint64_t *bits, int b, bool set)
+    {
+        for (int w = b / 64; w < COMPRESSED_BITMAP_WORDS; w++)
+        {
+            uint64_t x = set ? bits[w] : ~bits[w];
+            if (w == b / 64)
+            {
+                x &= ~(uint64_t)0 << (b % 64);
+            }
+            if (x != 0)
+            {
+                return w * 64 + __builtin_ctzll(x);
+            }
+        }
+        return COMPRESSED_CHUNK;
+    }
+
+    // appends the chunks of row, of words() words, as the next distinct row
+    void encode(const uint64_t *row)
+    {
+        for (int key = 0; key < keys(); key++)
+        {
+            const uint64_t *bits = &row[(size_t)key * COMPRESSED_BITMAP_WORDS];
+            uint32_t count = 0, runs = 0;
+            uint64_t carry = 0; // the last bit of the previous word
+            for (int w = 0; w < COMPRESSED_BITMAP_WORDS; w++)
+            {
+                uint64_t x = bits[w];
+                count += __builtin_popcountll(x);
+                runs += __builtin_popcountll(x & ~(x << 1 | carry));
+                carry = x >> 63;
+            }
+            if (count == 0)
+            {
+                continue;
+            }
+
+            chunk c;
+            c.key = key;
+            c.offset = values.size();
+            if (2 * count <= 4 * runs && 2 * count <= COMPRESSED_CHUNK / 8)
+            {
+                c.type = ARRAY;
+                c.count = count;
+                for (int w = 0; w < COMPRESSED_BITMAP_WORDS; w++)
+                {
+                    for (uint64_t x = bits[w]; x != 0; x &= x - 1)
+                    {
+                        values.push_back(w * 64 + __builtin_ctzll(x));
+                    }
+                }
+            }
+            else if (4 * runs <= COMPRESSED_CHUNK / 8)
+            {
+                c.type = RUNS;
+                c.count = runs;
+                for (int b = next_bit(bits, 0, true); b < COMPRESSED_CHUNK; b = next_bit(bits, b, true))
+                {
+                    int end = next_bit(bits, b, false);
+                    values.push_back(b);
+                    values.push_back(end - 1 - b);
+                    b = end;
+                }
+            }
+            else
+            {
+                c.type = BITMAP;
+                c.count = count;
+                c.offset = bitmaps.size();
+                bitmaps.insert(bitmaps.end(), bits, bits + COMPRESSED_BITMAP_WORDS);
+            }
+            chunks.push_back(c);
+        }
+        row_start.push_back(chunks.size());
+    }
+
+    // the chunk key of distinct row r, NULL if none of its columns are set
+    const chunk *find_chunk(uint32_t r, uint32_t key) const
+    {
+        for (uint64_t x = row_start[r]; x < row_start[r + 1] && chunks[x].key <= key; x++)
+        {
+            if (chunks[x].key == key)
+            {
+                return &chunks[x];
+            }
+        }
+        return NULL;
+    }
+
+    int N;
+    std::vector<uint32_t> row_of;    // distinct row of every vertex
+    std::vector<uint64_t> row_start; // chunks of distinct row r are chunks[row_start[r]..row_start[r + 1])
+    std::vector<chunk> chunks;
+    std::vector<uint16_t> values;    // of the arrays and runs
+    std::vector<uint64_t> bitmaps;
+};
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,8 @@
+// The distributed FWT is linked in from one of the impl/template-tiles.cpp
+// files, see fw::distributed in distributed.hpp.
+extern "C" int fw_distributed(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    return fw_distributed(argc, argv) == 0 ? 0 : 1;
+}
@@ -0,0 +1,447 @@
+#ifndef FW_DISTRIBUTED_HPP
+#define FW_DISTRIBUTED_HPP
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "autotune.hpp"
+#include "transport.hpp"
+
+// FWT distributed over processes, which exchange the tiles of row and column k
+// through a transport (transport.hpp) instead of sharing the matrix.
+//
+// The M x M tiles are dealt 2D block-cyclically to a pr x pc grid of
+// processes: process (r, c) owns the tiles (i, j) with i % pr = r and
+// j % pc = c, stored one after the other as contiguous L1 x L1 tiles, so every
+// process holds about 1 / P of the matrix and the kernels of the table run on
+// them as they are. In round k the owner of the diagonal tile updates it and
+// broadcasts it along its process row and column, the processes that own tiles
+// of row and column k update them, and then every tile of row k is broadcast
+// down its process column and every tile of column k along its process row,
+// one message per process for all of its tiles. Phase 4 needs nothing else.
+
+// entry point for the distributed benchmark, defined by impl/template-tiles.cpp
+extern "C" int fw_distributed(int argc, char **argv);
+
+namespace fw
+{
+
+// placement of the tiles on a pr x pc process grid
+struct dist_layout
+{
+    int M, pr, pc;
+    int r, c;   // of this process
+    int mr, mc; // number of local tile rows and columns
+    size_t T;   // entries per tile
+
+    dist_layout(int M, int P, int rank, size_t T) : M(M), T(T)
+    {
+        // the most square grid
+        pr = (int)sqrt((double)P);
+        while (P % pr != 0)
+        {
+            pr--;
+        }
+        pc = P / pr;
+        r = rank / pc;
+        c = rank % pc;
+        mr = local_count(M, pr, r);
+        mc = local_count(M, pc, c);
+    }
+
+    static int local_count(int M, int p, int q) { return q < M ? (M - q + p - 1) / p : 0; }
+
+    // offset of the tile (i, j) in the local tiles of its owner
+    size_t local(int i, int j) const { return ((size_t)(i / pr) * local_count(M, pc, j % pc) + j / pc) * T; }
+
+    // ranks of a process row and of a process column
+    std::vector<int> row_group(int row) const
+    {
+        std::vector<int> g(pc);
+        for (int q = 0; q < pc; q++)
+        {
+            g[q] = row * pc + q;
+        }
+        return g;
+    }
+
+    std::vector<int> col_group(int col) const
+    {
+        std::vector<int> g(pr);
+        for (int q = 0; q < pr; q++)
+        {
+            g[q] = q * pc + col;
+        }
+        return g;
+    }
+};
+
+/*
+ * Runs the FWT of v on the local tiles L of an N x N matrix distributed over
+ * the ranks of t as in dist_layout. Every rank calls it with its own tiles.
+ */
+template <class E>
+int FWdist(const variant<E> &v, transport &t, E *L, int N)
+{
+    const int L1 = v.L1;
+    const int cols = reg<E>::cols(L1);
+    const dist_layout l(N / L1, t.size(), t.rank(), (size_t)L1 * cols);
+    const size_t T = l.T;
+    const std::vector<int> my_row = l.row_group(l.r);
+    const std::vector<int> my_col = l.col_group(l.c);
+
+    // the diagonal tile, and the tiles of row k in my process columns and of column k in my process rows
+    static std::vector<E> scratch;
+    scratch.resize((1 + l.mr + l.mc) * T + 32 / sizeof(E));
+    E *diag = (E *)(((size_t)scratch.data() + 31) / 32 * 32);
+    E *col = diag + T;
+    E *row = col + l.mr * T;
+
+    for (int k = 0; k < l.M; k++)
+    {
+        const bool in_row = k % l.pr == l.r; // owns tiles of row k
+        const bool in_col = k % l.pc == l.c; // owns tiles of column k
+        E *Ckk = in_row && in_col ? &L[l.local(k, k)] : diag;
+
+        // phase 1: the diagonal tile, by its owner, which then sends it to the owners of row and column k
+        if (in_row && in_col)
+        {
+            v.fwi(Ckk, Ckk, Ckk, cols);
+        }
+        if (in_row)
+        {
+            t.broadcast(my_row, k % l.pc, Ckk, T * sizeof(E));
+        }
+        if (in_col)
+        {
+            t.broadcast(my_col, k % l.pr, Ckk, T * sizeof(E));
+        }
+
+        // phases 2 and 3: the local tiles of row and column k
+        for (int lj = 0; in_row && lj < l.mc; lj++)
+        {
+            int j = lj * l.pc + l.c;
+            if (j != k)
+            {
+                v.fwi(Ckk, &L[l.local(k, j)], &L[l.local(k, j)], cols);
+            }
+        }
+        for (int li = 0; in_col && li < l.mr; li++)
+        {
+            int i = li * l.pr + l.r;
+            if (i != k)
+            {
+                v.fwi(&L[l.local(i, k)], Ckk, &L[l.local(i, k)], cols);
+            }
+        }
+
+        // the tiles of row k are local tiles already, those of column k are packed first
+        E *panel_row = in_row ? &L[l.local(k, l.c)] : row;
+        for (int li = 0; in_col && li < l.mr; li++)
+        {
+            memcpy(&col[li * T], &L[l.local(li * l.pr + l.r, k)], T * sizeof(E));
+        }
+        t.broadcast(my_col, k % l.pr, panel_row, l.mc * T * sizeof(E));
+        t.broadcast(my_row, k % l.pc, col, l.mr * T * sizeof(E));
+
+        // phase 4: the remaining local tiles
+        for (int li = 0; li < l.mr; li++)
+        {
+            int i = li * l.pr + l.r;
+            for (int lj = 0; lj < l.mc && i != k; lj++)
+            {
+                int j = lj * l.pc + l.c;
+                if (j != k)
+                {
+                    v.fwiabc(&col[li * T], &panel_row[lj * T], &L[l.local(i, j)], cols);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Copies the tiles of rank p between the N x N matrix C and the local tiles
+ * L, to L if scatter and back otherwise.
+ */
+template <class E>
+static void copy_tiles(E *C, E *L, int N, int L1, const dist_layout &l, int p, bool scatter)
+{
+    const int ld = reg<E>::ld(N);
+    const int cols = reg<E>::cols(L1);
+    for (int i = p / l.pc; i < l.M; i += l.pr)
+    {
+        for (int j = p % l.pc; j < l.M; j += l.pc)
+        {
+            E *tile = &L[l.local(i, j)];
+            for (int r = 0; r < L1; r++)
+            {
+                E *entries = &C[(size_t)(i * L1 + r) * ld + j * cols];
+                memcpy(scatter ? &tile[r * cols] : entries, scatter ? entries : &tile[r * cols], cols * sizeof(E));
+            }
+        }
+    }
+}
+
+static std::vector<int> all_ranks(int P)
+{
+    std::vector<int> g(P);
+    for (int p = 0; p < P; p++)
+    {
+        g[p] = p;
+    }
+    return g;
+}
+
+/*
+ * Runs one rank of the benchmark: rank 0 deals the tiles of a random matrix to
+ * all ranks, they run FWdist, and rank 0 collects the tiles and compares them
+ * against FWT in a single process. Prints the time and the bytes sent and
+ * moved per process. Returns false if the result is wrong.
+ */
+template <class S, class T>
+static bool dist_run(transport &t, const variant<typename reg<T>::elem> &v, int N)
+{
+    typedef typename reg<T>::elem E;
+    const int L1 = v.L1;
+    const size_t size = (size_t)N * reg<T>::ld(N);
+    const size_t tile = (size_t)L1 * reg<T>::cols(L1);
+    const int M = N / L1;
+    const int P = t.size();
+
+    std::vector<dist_layout> layouts;
+    for (int p = 0; p < P; p++)
+    {
+        layouts.emplace_back(M, P, p, tile);
+    }
+    const dist_layout &mine = layouts[t.rank()];
+    E *L = alloc_matrix<E>((size_t)mine.mr * mine.mc * tile);
+    E *C = NULL, *D = NULL;
+    if (t.rank() == 0)
+    {
+        C = alloc_matrix<E>(size);
+        D = alloc_matrix<E>(size);
+        random_matrix<S, E>(C, size);
+        memcpy(D, C, size * sizeof(E));
+        for (int p = P - 1; p >= 0; p--)
+        {
+            const dist_layout &l = layouts[p];
+            E *tiles = p == 0 ? L : alloc_matrix<E>((size_t)l.mr * l.mc * tile);
+            copy_tiles(C, tiles, N, L1, l, p, true);
+            if (p > 0)
+            {
+                t.send(p, tiles, (size_t)l.mr * l.mc * tile * sizeof(E));
+                free(tiles);
+            }
+        }
+    }
+    else
+    {
+        t.recv(0, L, (size_t)mine.mr * mine.mc * tile * sizeof(E));
+    }
+
+    t.barrier();
+    uint64_t sent = t.sent, received = t.received;
+    double start = transport_seconds();
+    FWdist(v, t, L, N);
+    t.barrier();
+    double seconds = transport_seconds() - start;
+    uint64_t bytes[2] = {t.sent - sent, t.received - received};
+
+    bool ok = true;
+    if (t.rank() == 0)
+    {
+        std::vector<uint64_t> all(2 * P);
+        all[0] = bytes[0];
+        all[1] = bytes[1];
+        for (int p = 1; p < P; p++)
+        {
+            t.recv(p, &all[2 * p], sizeof(bytes));
+        }
+        copy_tiles(C, L, N, L1, mine, 0, false);
+        for (int p = 1; p < P; p++)
+        {
+            const dist_layout &l = layouts[p];
+            E *tiles = alloc_matrix<E>((size_t)l.mr * l.mc * tile);
+            t.recv(p, tiles, (size_t)l.mr * l.mc * tile * sizeof(E));
+            copy_tiles(C, tiles, N, L1, l, p, false);
+            free(tiles);
+        }
+
+        v.run(D, D, D, N);
+        ok = memcmp(C, D, size * sizeof(E)) == 0;
+        double max_moved = 0, total_sent = 0, total_moved = 0;
+        for (int p = 0; p < P; p++)
+        {
+            max_moved = fmax(max_moved, all[2 * p] + all[2 * p + 1]);
+            total_sent += all[2 * p];
+            total_moved += all[2 * p] + all[2 * p + 1];
+        }
+        char grid[32];
+        snprintf(grid, sizeof(grid), "%dx%d", mine.pr, mine.pc);
+        printf("%6d %4d %9s %5d %12.4f %14.0f %14.0f %14.0f  %s\n", N, P, grid, L1, seconds, total_sent / P,
+               total_moved / P, max_moved, ok ? "ok" : "WRONG");
+        fflush(stdout);
+        free(C);
+        free(D);
+    }
+    else
+    {
+        t.send(0, bytes, sizeof(bytes));
+        t.send(0, L, (size_t)mine.mr * mine.mc * tile * sizeof(E));
+    }
+    free(L);
+
+    // every rank learns whether the result is right
+    t.broadcast(all_ranks(P), 0, &ok, sizeof(ok));
+    return ok;
+}
+
+static std::vector<std::string> split_hosts(const char *list)
+{
+    std::vector<std::string> hosts;
+    std::string s(list);
+    for (size_t start = 0; start <= s.size();)
+    {
+        size_t end = s.find(',', start);
+        end = end == std::string::npos ? s.size() : end;
+        hosts.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return hosts;
+}
+
+/*
+ * Main of the distributed benchmark: for every n, deals a random matrix to the
+ * processes, runs FWdist with the variant of the table for n and validates
+ * the result. Without -r, forks the processes on this machine, otherwise runs
+ * the rank -r of a run over TCP between the hosts of -H, one rank per host.
+ */
+template <class S, class T>
+int distributed(const std::vector<variant<typename reg<T>::elem>> &table, params defaults, const char *algo, int argc,
+                char **argv)
+{
+    std::string kind = "shm";
+    int P = 4;
+    int rank = -1;
+    int port = 47000;
+    std::vector<std::string> hosts;
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            kind = argv[++i];
+        }
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+        {
+            P = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            rank = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc)
+        {
+            hosts = split_hosts(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            port = atoi(argv[++i]);
+        }
+        else if (atoi(argv[i]) > 0)
+        {
+            sizes.push_back(atoi(argv[i]));
+        }
+        else
+        {
+            sizes.clear();
+            break;
+        }
+    }
+    if (rank >= 0)
+    {
+        kind = "tcp";
+        P = hosts.size();
+    }
+    if (sizes.empty() || P <= 0 || (kind != "shm" && kind != "tcp") || (rank >= 0 && rank >= P))
+    {
+        fprintf(stderr, "call as: %s [-t shm|tcp] [-P processes] [-p port] n1 [n2 ...]\n", argv[0]);
+        fprintf(stderr, "     or: %s -r rank -H host0,host1,... [-p port] n1 [n2 ...]\n", argv[0]);
+        return -1;
+    }
+    if (hosts.empty())
+    {
+        hosts.assign(P, "127.0.0.1");
+    }
+
+    // without -r, this process is rank 0 and forks the others
+    const std::string shm_name = "/fw-dist-" + std::to_string(getpid());
+    std::vector<pid_t> children;
+    const bool fork_ranks = rank < 0;
+    if (fork_ranks)
+    {
+        fflush(stdout);
+        rank = 0;
+        for (int p = 1; p < P && rank == 0; p++)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                rank = p;
+            }
+            else
+            {
+                children.push_back(pid);
+            }
+        }
+    }
+
+    transport *t = kind == "shm" ? (transport *)shm_transport::create(shm_name, rank, P)
+                                 : (transport *)tcp_transport::create(hosts, port, rank);
+    bool ok = t != NULL;
+    if (ok && rank == 0)
+    {
+        fprintf(stderr, "%s: %d processes over %s\n", algo, P, kind.c_str());
+        printf("%6s %4s %9s %5s %12s %14s %14s %14s\n", "n", "P", "grid", "L1", "seconds", "sent/process", "moved/process",
+               "max moved");
+    }
+    for (int i = 0; ok && i < (int)sizes.size(); i++)
+    {
+        const int n = sizes[i];
+        const variant<typename reg<T>::elem> *v = select(table, n, tuned(table, algo, n, defaults));
+        if (v == NULL)
+        {
+            if (rank == 0)
+            {
+                fprintf(stderr, "no tile size of the table divides n = %d\n", n);
+            }
+            continue;
+        }
+        ok = dist_run<S, T>(*t, *v, n);
+    }
+    delete t;
+
+    if (fork_ranks && rank > 0)
+    {
+        // a forked rank must not return into the caller's main
+        _exit(ok ? 0 : 1);
+    }
+    for (pid_t pid : children)
+    {
+        int status;
+        ok = waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && ok;
+    }
+    return ok ? 0 : -1;
+}
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef FW_FIXED_HPP
+#define FW_FIXED_HPP
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <type_traits>
+
+#include "fw.hpp"
+
+// Fully unrolled kernels for the small sizes N = 8, 16, 32 and 64.
+//
+// For N <= 64, FWT degenerates to a single tile or a handful of them and most
+// of the time goes into loop overhead. With N known at compile time, the i and
+// j loops are unrolled completely, so every entry of the matrix has a fixed
+// register or stack slot, and so is the k loop for N <= FIXED_UNROLL_K, where
+// the whole matrix stays in registers. The transitive closure keeps a row in
+// one integer register, up to 64 bits, as the AVX2 registers are wider than
+// its rows.
+
+namespace fw
+{
+
+// largest N for which the k loop is unrolled as well
+#define FIXED_UNROLL_K 8
+// number of registers the rows of an iteration of the i loop may take
+#define FIXED_REGISTERS 16
+
+// register type of the fixed-size kernel for N with the register type T of the build
+template <class T, int N>
+struct fixed_reg
+{
+    typedef T type;
+};
+
+// attributes of __m256i ignored as a template argument, see reg in fw.hpp
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+template <int N>
+struct fixed_reg<__m256i, N>
+{
+    typedef typename std::conditional<N == 64, uint64_t,
+            typename std::conditional<N == 32, uint32_t,
+            typename std::conditional<N == 16, uint16_t, char>::type>::type>::type type;
+};
+
+template <int N>
+struct fixed_reg<char, N> : fixed_reg<__m256i, N>
+{
+};
+#pragma GCC diagnostic pop
+
+// round k of FW on the rows i .. i + Ui - 1, b holds row k, which doesn't change in round k
+template <class S, class T, int N, int Ui>
+inline __attribute__((always_inline)) void FWfixed_rows(typename reg<T>::elem *C, const T *b, int i, int k)
+{
+    constexpr int W = reg<T>::width;
+    constexpr int ld = reg<T>::ld(N);
+    constexpr int V = reg<T>::cols(N) / W; // registers per row
+
+    T a[Ui];
+    T c[Ui][V];
+    unroll<Ui>([&](auto u) { a[u] = reg<T>::broadcast(C, ld, i + u, k); });
+    unroll<Ui>([&](auto u) {
+        unroll<V>([&](auto v) { c[u][v] = reg<T>::load(&C[(i + u) * ld + v * W]); });
+    });
+    unroll<Ui>([&](auto u) {
+        unroll<V>([&](auto v) { c[u][v] = S::plus(c[u][v], S::times(a[u], b[v])); });
+    });
+    unroll<Ui>([&](auto u) {
+        unroll<V>([&](auto v) { reg<T>::store(&C[(i + u) * ld + v * W], c[u][v]); });
+    });
+}
+
+// rows per iteration of the i loop above FIXED_UNROLL_K: the most of 4, 2 and
+// 1 whose rows, row k and the broadcasts fit into FIXED_REGISTERS
+template <class T, int N>
+constexpr int fixed_ui()
+{
+    constexpr int V = reg<T>::cols(N) / reg<T>::width;
+    for (int ui = 4; ui > 1; ui /= 2)
+    {
+        if (N % ui == 0 && ui * (V + 1) + V <= FIXED_REGISTERS)
+        {
+            return ui;
+        }
+    }
+    return 1;
+}
+
+// round k of FW on all rows
+template <class S, class T, int N>
+inline __attribute__((always_inline)) void FWfixed_round(typename reg<T>::elem *C, int k)
+{
+    constexpr int W = reg<T>::width;
+    constexpr int ld = reg<T>::ld(N);
+    constexpr int V = reg<T>::cols(N) / W;
+
+    T b[V];
+    unroll<V>([&](auto v) { b[v] = reg<T>::load(&C[k * ld + v * W]); });
+    if constexpr (N <= FIXED_UNROLL_K)
+    {
+        unroll<N>([&](auto i) {
+            T a = reg<T>::broadcast(C, ld, i, k);
+            unroll<V>([&](auto v) {
+                reg<T>::store(&C[i * ld + v * W], S::plus(reg<T>::load(&C[i * ld + v * W]), S::times(a, b[v])));
+            });
+        });
+    }
+    else
+    {
+        constexpr int Ui = fixed_ui<T, N>();
+        for (int i = 0; i < N; i += Ui)
+        {
+            FWfixed_rows<S, T, N, Ui>(C, b, i, k);
+        }
+    }
+}
+
+// FW for an N x N matrix with the j loop unrolled completely, and the i and k
+// loops too if the matrix fits into the registers. Same result as FWnaive.
+template <class S, class T, int N>
+int FWfixed(typename reg<T>::elem *C, int)
+{
+    static_assert(reg<T>::cols(N) % reg<T>::width == 0, "the rows must fill the registers");
+    if constexpr (N <= FIXED_UNROLL_K)
+    {
+        unroll<N>([&](auto k) { FWfixed_round<S, T, N>(C, k); });
+    }
+    else
+    {
+        for (int k = 0; k < N; k++)
+        {
+            FWfixed_round<S, T, N>(C, k);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Returns the fixed-size kernel for an N x N matrix, NULL if there is none
+ * for N and T or if FW_PARAMS asks for a variant of the table.
+ */
+template <class S, class T>
+int (*fixed(int N))(typename reg<T>::elem *C, int N)
+{
+    // scalar builds: the compiler vectorizes FWnaive, which beats scalar rows
+    if (std::is_same<T, double>::value || getenv("FW_PARAMS") != NULL)
+    {
+        return NULL;
+    }
+    switch (N)
+    {
+    case 8:
+        return &FWfixed<S, typename fixed_reg<T, 8>::type, 8>;
+    case 16:
+        return &FWfixed<S, typename fixed_reg<T, 16>::type, 16>;
+    case 32:
+        return &FWfixed<S, typename fixed_reg<T, 32>::type, 32>;
+    case 64:
+        return &FWfixed<S, typename fixed_reg<T, 64>::type, 64>;
+    default:
+        return NULL;
+    }
+}
+
+} // namespace fw
+
+#endif
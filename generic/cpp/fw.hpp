@@ -0,0 +1,365 @@
+#ifndef FW_HPP
+#define FW_HPP
+
+#include <immintrin.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+#include "../harness/phases.h"
+
+// Compile-time counterpart of the jinja templates in autotuning/templates.
+// The semiring replaces outer_op/inner_op, the register type T replaces the
+// vector flag and the unrolling factors are template parameters, so every
+// instantiation of FWT<Semiring, T, L1, Ui, Uj, Uii, Ujj, Ukk> yields the same
+// fully unrolled register-blocked code as the corresponding generated file.
+
+namespace fw
+{
+
+// calls f(std::integral_constant<int, 0>) ... f(std::integral_constant<int, U - 1>)
+template <class F, int... I>
+inline __attribute__((always_inline)) void unroll(F &&f, std::integer_sequence<int, I...>)
+{
+    (f(std::integral_constant<int, I>{}), ...);
+}
+
+template <int U, class F>
+inline __attribute__((always_inline)) void unroll(F &&f)
+{
+    unroll(f, std::make_integer_sequence<int, U>{});
+}
+
+// ---------------------------------------------------------------------------
+// register types
+//
+// Describes how a register of type T is loaded from and stored to the matrix.
+// elem:  type of the matrix entries
+// width: number of matrix entries (along j) held by one register
+// ld:    number of matrix entries per matrix line
+// cols:  number of matrix entries per tile line
+// ---------------------------------------------------------------------------
+template <class T>
+struct reg;
+
+template <>
+struct reg<double>
+{
+    typedef double elem;
+    static constexpr int width = 1;
+    static constexpr int ld(int N) { return N; }
+    static constexpr int cols(int L1) { return L1; }
+    static inline double load(const double *p) { return *p; }
+    static inline void store(double *p, double x) { *p = x; }
+    static inline double broadcast(const double *A, int ld, int i, int k) { return A[i * ld + k]; }
+};
+
+// g++ warns that the attributes of __m256d and __m256i are ignored as template
+// arguments, reg and the kernels only use them as types of registers
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+template <>
+struct reg<__m256d>
+{
+    typedef double elem;
+    static constexpr int width = 4;
+    static constexpr int ld(int N) { return N; }
+    static constexpr int cols(int L1) { return L1; }
+    static inline __m256d load(const double *p) { return _mm256_load_pd(p); }
+    static inline void store(double *p, __m256d x) { _mm256_store_pd(p, x); }
+    static inline __m256d broadcast(const double *A, int ld, int i, int k) { return _mm256_broadcast_sd(&A[i * ld + k]); }
+};
+
+// transitive closure: bit-packed rows, bit k of a row lives in byte k / 8
+template <>
+struct reg<char>
+{
+    typedef char elem;
+    static constexpr int width = 1;
+    static constexpr int ld(int N) { return (N + 7) / 8; }
+    static constexpr int cols(int L1) { return (L1 + 7) / 8; }
+    static inline char load(const char *p) { return *p; }
+    static inline void store(char *p, char x) { *p = x; }
+    static inline char broadcast(const char *A, int ld, int i, int k)
+    {
+        return A[i * ld + k / 8] & (1 << (k % 8)) ? 0xff : 0x00;
+    }
+};
+
+template <>
+struct reg<__m256i>
+{
+    typedef char elem;
+    static constexpr int width = 32;
+    static constexpr int ld(int N) { return (N + 7) / 8; }
+    static constexpr int cols(int L1) { return (L1 + 7) / 8; }
+    static inline __m256i load(const char *p) { return _mm256_loadu_si256((__m256i const *)p); }
+    static inline void store(char *p, __m256i x) { _mm256_storeu_si256((__m256i *)p, x); }
+    static inline __m256i broadcast(const char *A, int ld, int i, int k)
+    {
+        return _mm256_set1_epi8(A[i * ld + k / 8] & (1 << (k % 8)) ? 0xff : 0x00);
+    }
+};
+#pragma GCC diagnostic pop
+
+// transitive closure: a whole bit-packed row in an integer register, for rows
+// of 16 to 64 bits (see fixed.hpp)
+template <class U>
+struct reg_bits
+{
+    typedef char elem;
+    static constexpr int width = sizeof(U);
+    static constexpr int ld(int N) { return (N + 7) / 8; }
+    static constexpr int cols(int L1) { return (L1 + 7) / 8; }
+    static inline U load(const char *p)
+    {
+        U x;
+        memcpy(&x, p, sizeof(U));
+        return x;
+    }
+    static inline void store(char *p, U x) { memcpy(p, &x, sizeof(U)); }
+    static inline U broadcast(const char *A, int ld, int i, int k)
+    {
+        return A[i * ld + k / 8] & (1 << (k % 8)) ? (U)~(U)0 : (U)0;
+    }
+};
+
+template <>
+struct reg<uint16_t> : reg_bits<uint16_t>
+{
+};
+
+template <>
+struct reg<uint32_t> : reg_bits<uint32_t>
+{
+};
+
+template <>
+struct reg<uint64_t> : reg_bits<uint64_t>
+{
+};
+
+// ---------------------------------------------------------------------------
+// semirings
+//
+// plus is the outer operation, times the inner one: c = plus(c, times(a, b))
+// zero is the neutral element of plus, i.e. the value of a missing edge
+// ---------------------------------------------------------------------------
+
+// shortest path
+struct MinPlus
+{
+    static inline double zero() { return __builtin_inf(); }
+    static inline double plus(double x, double y) { return ((x) < (y)) ? (x) : (y); }
+    static inline double times(double x, double y) { return x + y; }
+    static inline __m256d plus(__m256d x, __m256d y) { return _mm256_min_pd(x, y); }
+    static inline __m256d times(__m256d x, __m256d y) { return _mm256_add_pd(x, y); }
+};
+
+// max-min
+struct MaxMin
+{
+    static inline double zero() { return 0.0; }
+    static inline double plus(double x, double y) { return ((x) > (y)) ? (x) : (y); }
+    static inline double times(double x, double y) { return ((x) < (y)) ? (x) : (y); }
+    static inline __m256d plus(__m256d x, __m256d y) { return _mm256_max_pd(x, y); }
+    static inline __m256d times(__m256d x, __m256d y) { return _mm256_min_pd(x, y); }
+};
+
+// transitive closure
+struct OrAnd
+{
+    static inline char zero() { return 0; }
+    static inline char plus(char x, char y) { return x | y; }
+    static inline char times(char x, char y) { return x & y; }
+    static inline __m256i plus(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+    static inline __m256i times(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+    static inline uint16_t plus(uint16_t x, uint16_t y) { return x | y; }
+    static inline uint16_t times(uint16_t x, uint16_t y) { return x & y; }
+    static inline uint32_t plus(uint32_t x, uint32_t y) { return x | y; }
+    static inline uint32_t times(uint32_t x, uint32_t y) { return x & y; }
+    static inline uint64_t plus(uint64_t x, uint64_t y) { return x | y; }
+    static inline uint64_t times(uint64_t x, uint64_t y) { return x & y; }
+};
+
+// ---------------------------------------------------------------------------
+// kernels
+// ---------------------------------------------------------------------------
+
+// iterative FW algorithm (FWI) on an L1 x L1 tile
+// tiling factors Ui and Uj (in matrix entries along j)
+template <class S, class T, int Ui, int Uj>
+inline __attribute__((always_inline)) void FWI_kernel(typename reg<T>::elem *A, typename reg<T>::elem *B,
+                                                      typename reg<T>::elem *C, int ld, int L1)
+{
+    constexpr int W = reg<T>::width;
+    constexpr int Vj = Uj / W; // registers per unrolled row
+    static_assert(Uj % W == 0, "Uj must be a multiple of the register width");
+
+    // NOTE: We assume Ui and Uj divide L1 for simplicity
+    const int cols = reg<T>::cols(L1);
+    for (int k = 0; k < L1; k++)
+    {
+        for (int i = 0; i < L1 - (Ui - 1); i += Ui)
+        {
+            T a[Ui];
+            unroll<Ui>([&](auto u) { a[u] = reg<T>::broadcast(A, ld, i + u, k); });
+            for (int j = 0; j < cols - (Uj - 1); j += Uj)
+            {
+                T b[Vj];
+                T c[Ui][Vj];
+
+                // load
+                unroll<Ui>([&](auto u) {
+                    unroll<Vj>([&](auto v) { c[u][v] = reg<T>::load(&C[(i + u) * ld + j + v * W]); });
+                });
+                unroll<Vj>([&](auto v) { b[v] = reg<T>::load(&B[k * ld + j + v * W]); });
+
+                // op 1 and op 2
+                unroll<Ui>([&](auto u) {
+                    unroll<Vj>([&](auto v) { c[u][v] = S::plus(c[u][v], S::times(a[u], b[v])); });
+                });
+
+                // store
+                unroll<Ui>([&](auto u) {
+                    unroll<Vj>([&](auto v) { reg<T>::store(&C[(i + u) * ld + j + v * W], c[u][v]); });
+                });
+            }
+        }
+    }
+}
+
+template <class S, class T, int L1, int Ui, int Uj>
+void FWI(typename reg<T>::elem *A, typename reg<T>::elem *B, typename reg<T>::elem *C, int ld)
+{
+    static_assert(L1 % Ui == 0 && reg<T>::cols(L1) % Uj == 0, "Ui and Uj must divide L1");
+    FWI_kernel<S, T, Ui, Uj>(A, B, C, ld, L1);
+}
+
+// FWI for 3 distinct matrices (FWIabc)
+// tiling factors Uk', Ui' and Uj' (in matrix entries along j)
+template <class S, class T, int L1, int Uii, int Ujj, int Ukk>
+void FWIabc(typename reg<T>::elem *A, typename reg<T>::elem *B, typename reg<T>::elem *C, int ld)
+{
+    constexpr int W = reg<T>::width;
+    constexpr int Vj = Ujj / W; // registers per unrolled row
+    constexpr int cols = reg<T>::cols(L1);
+    static_assert(Ujj % W == 0, "Uj' must be a multiple of the register width");
+    static_assert(L1 % Uii == 0 && L1 % Ukk == 0 && cols % Ujj == 0, "Ui', Uj' and Uk' must divide L1");
+
+    for (int i = 0; i < L1; i += Uii)
+    {
+        for (int j = 0; j < cols; j += Ujj)
+        {
+            for (int k = 0; k < L1; k += Ukk)
+            {
+                T a[Uii][Ukk];
+                T b[Ukk][Vj];
+                T c[Uii][Vj];
+
+                // load
+                unroll<Uii>([&](auto u) {
+                    unroll<Ukk>([&](auto w) { a[u][w] = reg<T>::broadcast(A, ld, i + u, k + w); });
+                });
+                unroll<Ukk>([&](auto w) {
+                    unroll<Vj>([&](auto v) { b[w][v] = reg<T>::load(&B[(k + w) * ld + j + v * W]); });
+                });
+                unroll<Uii>([&](auto u) {
+                    unroll<Vj>([&](auto v) { c[u][v] = reg<T>::load(&C[(i + u) * ld + j + v * W]); });
+                });
+
+                // for k + 0 ... k + Uk' - 1
+                unroll<Ukk>([&](auto w) {
+                    unroll<Uii>([&](auto u) {
+                        unroll<Vj>([&](auto v) { c[u][v] = S::plus(c[u][v], S::times(a[u][w], b[w][v])); });
+                    });
+                });
+
+                // store
+                unroll<Uii>([&](auto u) {
+                    unroll<Vj>([&](auto v) { reg<T>::store(&C[(i + u) * ld + j + v * W], c[u][v]); });
+                });
+            }
+        }
+    }
+}
+
+// Computes the address of the upper-left element of tile X_uv
+template <class T>
+inline typename reg<T>::elem *SUBM(typename reg<T>::elem *X, int u, int v, int ld, int L1)
+{
+    return X + u * ld * L1 + v * reg<T>::cols(L1);
+}
+
+// tiled FW algorithm (FWT)
+// tile size: L1 x L1
+template <class S, class T, int L1, int Ui, int Uj, int Uii, int Ujj, int Ukk>
+int FWT(typename reg<T>::elem *A, typename reg<T>::elem *B, typename reg<T>::elem *C, int N)
+{
+    // NOTE: We assume L1 divides N for simplicity
+    // Notation: A_ij is the L1 x L1 submatrix (i,j) of A
+    const int ld = reg<T>::ld(N);
+    const int M = N / L1;
+    for (int k = 0; k < M; k++)
+    {
+        // phase 1: update all diagonal tiles
+        PHASES_BEGIN(k, 1);
+        PHASES_TILE(k, k, FWI<S, T, L1, Ui, Uj>(SUBM<T>(A, k, k, ld, L1), SUBM<T>(B, k, k, ld, L1), SUBM<T>(C, k, k, ld, L1), ld));
+        PHASES_END(k, 1);
+
+        // phase 2: update all tiles in row k
+        PHASES_BEGIN(k, 2);
+        for (int j = 0; j < M; j++)
+        {
+            if (j != k)
+            {
+                PHASES_TILE(k, j, FWI<S, T, L1, Ui, Uj>(SUBM<T>(A, k, k, ld, L1), SUBM<T>(B, k, j, ld, L1), SUBM<T>(C, k, j, ld, L1), ld));
+            }
+        }
+        PHASES_END(k, 2);
+
+        // phase 3: update all tiles in column k
+        PHASES_BEGIN(k, 3);
+        for (int i = 0; i < M; i++)
+        {
+            if (i != k)
+            {
+                PHASES_TILE(i, k, FWI<S, T, L1, Ui, Uj>(SUBM<T>(A, i, k, ld, L1), SUBM<T>(B, k, k, ld, L1), SUBM<T>(C, i, k, ld, L1), ld));
+            }
+        }
+        PHASES_END(k, 3);
+
+        // phase 4: update all remaining tiles
+        PHASES_BEGIN(k, 4);
+        for (int i = 0; i < M; i++)
+        {
+            if (i != k)
+            {
+                for (int j = 0; j < M; j++)
+                {
+                    if (j != k)
+                    {
+                        PHASES_TILE(i, j, FWIabc<S, T, L1, Uii, Ujj, Ukk>(SUBM<T>(A, i, k, ld, L1), SUBM<T>(B, k, j, ld, L1),
+                                                                          SUBM<T>(C, i, j, ld, L1), ld));
+                    }
+                }
+            }
+        }
+        PHASES_END(k, 4);
+    }
+    return 0;
+}
+
+// Untiled fallback for inputs no table entry fits: FWI on the whole matrix
+// with scalar registers and no unrolling.
+template <class S, class T>
+int FWnaive(typename reg<T>::elem *C, int N)
+{
+    typedef typename reg<T>::elem elem;
+    FWI_kernel<S, elem, 1, 1>(C, C, C, reg<elem>::ld(N), N);
+    return 0;
+}
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,508 @@
+#ifndef FW_PARALLEL_HPP
+#define FW_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <immintrin.h>
+#include <mutex>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "variants.hpp"
+
+// NUMA-aware parallel FWT.
+//
+// The tiles are distributed over the threads in 2D blocks: the block rows are
+// split between the NUMA nodes in proportion to their threads, and the block
+// rows of a node in a grid over its threads. Every thread is pinned to a cpu
+// of its node and only ever writes its own tiles, so they are placed on the
+// node of their owner: by first touch for the buffers the threads allocate,
+// and by migrating the pages for the matrix, which the driver has already
+// touched while parsing. In phase 4 of round k, a thread reads the tiles
+// (i, k) of its own block rows, which are local, and the row panel k, which
+// is copied to every node after phase 2, so all reads of phase 4 stay local.
+
+namespace fw
+{
+
+// number of spins of a barrier before it yields the cpu
+#define PARALLEL_SPINS (1 << 12)
+
+// cpus we may run on, in the order of their NUMA nodes
+struct topology
+{
+    std::vector<int> cpus;
+    std::vector<int> node;     // of every cpu, numbered from 0 to nodes - 1
+    std::vector<int> os_nodes; // number of the node for the kernel
+    int nodes;
+};
+
+// parses a list of the form "0-3,8,10-11"
+static std::vector<int> parse_cpulist(const char *s)
+{
+    std::vector<int> list;
+    while (*s != '\0' && *s != '\n')
+    {
+        char *end;
+        int first = strtol(s, &end, 10);
+        if (end == s)
+        {
+            break; // malformed
+        }
+        int last = first;
+        if (*end == '-')
+        {
+            last = strtol(end + 1, &end, 10);
+        }
+        for (int c = first; c <= last; c++)
+        {
+            list.push_back(c);
+        }
+        s = *end == ',' ? end + 1 : end;
+    }
+    return list;
+}
+
+static std::vector<int> read_cpulist(const char *path)
+{
+    char line[4096];
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return std::vector<int>();
+    }
+    std::vector<int> list;
+    if (fgets(line, sizeof(line), f) != NULL)
+    {
+        list = parse_cpulist(line);
+    }
+    fclose(f);
+    return list;
+}
+
+/*
+ * Reads the NUMA nodes from /sys/devices/system/node, restricted to the cpus
+ * of our affinity mask. Without it, all cpus are on a single node.
+ */
+static topology numa_topology()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        CPU_SET(0, &allowed);
+    }
+
+    topology topo;
+    topo.nodes = 0;
+    for (int os_node : read_cpulist("/sys/devices/system/node/online"))
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", os_node);
+        bool used = false;
+        for (int cpu : read_cpulist(path))
+        {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+            {
+                topo.cpus.push_back(cpu);
+                topo.node.push_back(topo.nodes);
+                used = true;
+            }
+        }
+        if (used)
+        {
+            topo.os_nodes.push_back(os_node);
+            topo.nodes++;
+        }
+    }
+    if (topo.cpus.empty())
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+            {
+                topo.cpus.push_back(cpu);
+                topo.node.push_back(0);
+            }
+        }
+        topo.os_nodes.assign(1, -1);
+        topo.nodes = 1;
+    }
+    return topo;
+}
+
+static inline void pin(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+/*
+ * Threads pinned to the given cpus, which run a job together. The caller of
+ * run is thread 0. Not reentrant.
+ */
+class team
+{
+public:
+    team(const std::vector<int> &cpus) : cpus(cpus)
+    {
+        for (int t = 1; t < size(); t++)
+        {
+            workers.emplace_back(&team::work, this, t);
+        }
+    }
+
+    ~team()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        start.notify_all();
+        for (std::thread &w : workers)
+        {
+            w.join();
+        }
+    }
+
+    int size() const { return cpus.size(); }
+
+    // runs f(t) on every thread t and returns when all of them are done
+    void run(const std::function<void(int)> &f)
+    {
+        cpu_set_t saved;
+        bool restore = sched_getaffinity(0, sizeof(saved), &saved) == 0;
+        pin(cpus[0]);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &f;
+            pending = size() - 1;
+            generation++;
+        }
+        start.notify_all();
+        f(0);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return pending == 0; });
+        }
+        if (restore)
+        {
+            sched_setaffinity(0, sizeof(saved), &saved);
+        }
+    }
+
+    // waits until every thread of the job arrived, spinning for a while
+    void barrier()
+    {
+        int phase = barrier_phase.load(std::memory_order_acquire);
+        if (barrier_arrived.fetch_add(1, std::memory_order_acq_rel) == size() - 1)
+        {
+            barrier_arrived.store(0, std::memory_order_relaxed);
+            barrier_phase.store(phase + 1, std::memory_order_release);
+            return;
+        }
+        for (int spins = 0; barrier_phase.load(std::memory_order_acquire) == phase; spins++)
+        {
+            if (spins < PARALLEL_SPINS)
+            {
+                _mm_pause();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    void work(int t)
+    {
+        pin(cpus[t]);
+        int seen = 0;
+        while (true)
+        {
+            const std::function<void(int)> *f;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [&] { return stop || generation != seen; });
+                if (stop)
+                {
+                    return;
+                }
+                seen = generation;
+                f = job;
+            }
+            (*f)(t);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    std::vector<int> cpus;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start, done;
+    const std::function<void(int)> *job = NULL;
+    int generation = 0;
+    int pending = 0;
+    bool stop = false;
+    std::atomic<int> barrier_arrived{0};
+    std::atomic<int> barrier_phase{0};
+};
+
+/* Number of threads given by FW_THREADS, 1 if it isn't set. */
+static int env_threads()
+{
+    const char *env = getenv("FW_THREADS");
+    return env == NULL ? 1 : atoi(env);
+}
+
+// the tiles [r0, r1) x [c0, c1) of a thread, and the node it runs on
+struct block
+{
+    int node;
+    int r0, r1, c0, c1;
+    int first, count; // threads of the node, and the index of the first one
+};
+
+/*
+ * 2D block distribution of the M x M tiles over the threads of the given
+ * nodes, where thread t runs on node thread_node[t] and the threads of a node
+ * are numbered consecutively.
+ */
+static std::vector<block> distribute(int M, const std::vector<int> &thread_node)
+{
+    int T = thread_node.size();
+    std::vector<block> blocks(T);
+    for (int first = 0; first < T;)
+    {
+        int count = 0;
+        while (first + count < T && thread_node[first + count] == thread_node[first])
+        {
+            count++;
+        }
+        // the block rows of the node, in proportion to its threads
+        int R0 = first * M / T;
+        int R1 = (first + count) * M / T;
+        // grid of qr x qc threads, as square as count allows
+        int qr = 1;
+        for (int q = 1; q * q <= count; q++)
+        {
+            if (count % q == 0)
+            {
+                qr = q;
+            }
+        }
+        int qc = count / qr;
+        for (int l = 0; l < count; l++)
+        {
+            block &b = blocks[first + l];
+            b.node = thread_node[first];
+            b.r0 = R0 + (R1 - R0) * (l / qc) / qr;
+            b.r1 = R0 + (R1 - R0) * (l / qc + 1) / qr;
+            b.c0 = M * (l % qc) / qc;
+            b.c1 = M * (l % qc + 1) / qc;
+            b.first = first;
+            b.count = count;
+        }
+        first += count;
+    }
+    return blocks;
+}
+
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+/*
+ * Moves the pages of the rows [r0, r1) of the matrix C with ld elems per row
+ * to the node os_node. Pages shared with the neighbouring rows go to the node
+ * of their first row.
+ */
+template <class E>
+void migrate(E *C, int ld, int r0, int r1, int os_node)
+{
+    const size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = ((size_t)&C[(size_t)r0 * ld] + page - 1) / page * page;
+    size_t end = ((size_t)&C[(size_t)r1 * ld] + page - 1) / page * page;
+    if (r0 == 0)
+    {
+        begin = (size_t)C / page * page;
+    }
+    std::vector<void *> pages;
+    for (size_t p = begin; p < end; p += page)
+    {
+        pages.push_back((void *)p);
+    }
+    std::vector<int> nodes(pages.size(), os_node);
+    std::vector<int> status(pages.size());
+    // move_pages(2), called directly so we don't depend on libnuma
+    syscall(SYS_move_pages, 0, pages.size(), pages.data(), nodes.data(), status.data(), MPOL_MF_MOVE);
+}
+
+/*
+ * Runs the FWT of v on the N x N matrix C with threads threads, one per cpu we
+ * may run on if threads <= 0. Same result as v.run(C, C, C, N). Keeps the threads, and the placement of C, for the
+ * next call with the same arguments.
+ */
+template <class E>
+int FWparallel(const variant<E> &v, E *C, int N, int threads)
+{
+    static const topology topo = numa_topology();
+    static team *crew = NULL;
+    static std::vector<int> thread_node;
+    static std::vector<block> blocks;
+    static std::vector<E *> panels; // row panel of the current round, one per node
+    static const E *placed = NULL;
+    static int placedN = -1, placedL1 = -1;
+
+    const int L1 = v.L1;
+    const int M = N / L1;
+    const int ld = reg<E>::ld(N);
+    const int cols = reg<E>::cols(L1);
+    if (threads <= 0)
+    {
+        threads = topo.cpus.size();
+    }
+    if (M < 2 || threads == 1)
+    {
+        return v.run(C, C, C, N);
+    }
+
+    if (crew == NULL || crew->size() != threads)
+    {
+        // spread the threads evenly over all cpus, so every node gets its share,
+        // and keep the threads of a node together if there are more threads than cpus
+        const int P = topo.cpus.size();
+        std::vector<int> order(threads);
+        for (int t = 0; t < threads; t++)
+        {
+            order[t] = threads <= P ? (long)t * P / threads : t % P;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return topo.node[a] < topo.node[b]; });
+        std::vector<int> cpus(threads);
+        thread_node.resize(threads);
+        for (int t = 0; t < threads; t++)
+        {
+            cpus[t] = topo.cpus[order[t]];
+            thread_node[t] = topo.node[order[t]];
+        }
+        delete crew;
+        crew = new team(cpus);
+        placed = NULL;
+    }
+    const bool place = placed != C || placedN != N || placedL1 != L1;
+    if (place)
+    {
+        blocks = distribute(M, thread_node);
+        for (E *p : panels)
+        {
+            free(p);
+        }
+        panels.assign(topo.nodes, NULL);
+    }
+
+    const bool numa = topo.nodes > 1;
+    const size_t panel_size = (size_t)L1 * ld * sizeof(E);
+    crew->run([&](int t) {
+        const block &b = blocks[t];
+        const int l = t - b.first; // index among the threads of the node
+
+        if (numa && place && l == 0)
+        {
+            // the first thread of a node moves the block rows of the node and
+            // allocates its row panel, which first touch puts on the node
+            int R0 = blocks[b.first].r0;
+            int R1 = blocks[b.first + b.count - 1].r1;
+            migrate(C, ld, R0 * L1, R1 * L1, topo.os_nodes[b.node]);
+            panels[b.node] = (E *)aligned_alloc(64, (panel_size + 63) / 64 * 64);
+            memset(panels[b.node], 0, panel_size);
+        }
+        crew->barrier();
+
+        for (int k = 0; k < M; k++)
+        {
+            const bool row = b.r0 <= k && k < b.r1;
+            const bool col = b.c0 <= k && k < b.c1;
+
+            // phase 1: the diagonal tile, by its owner
+            if (row && col)
+            {
+                v.fwi(SUBM<E>(C, k, k, ld, L1), SUBM<E>(C, k, k, ld, L1), SUBM<E>(C, k, k, ld, L1), ld);
+            }
+            crew->barrier();
+
+            // phases 2 and 3: the tiles of row and column k
+            if (row)
+            {
+                for (int j = b.c0; j < b.c1; j++)
+                {
+                    if (j != k)
+                    {
+                        v.fwi(SUBM<E>(C, k, k, ld, L1), SUBM<E>(C, k, j, ld, L1), SUBM<E>(C, k, j, ld, L1), ld);
+                    }
+                }
+            }
+            if (col)
+            {
+                for (int i = b.r0; i < b.r1; i++)
+                {
+                    if (i != k)
+                    {
+                        v.fwi(SUBM<E>(C, i, k, ld, L1), SUBM<E>(C, k, k, ld, L1), SUBM<E>(C, i, k, ld, L1), ld);
+                    }
+                }
+            }
+            crew->barrier();
+
+            // copy the row panel to every node, the tiles (i, k) of phase 4 are local already
+            E *panel = SUBM<E>(C, k, 0, ld, L1);
+            if (numa)
+            {
+                for (int r = L1 * l / b.count; r < L1 * (l + 1) / b.count; r++)
+                {
+                    memcpy(&panels[b.node][(size_t)r * ld], &panel[(size_t)r * ld], ld * sizeof(E));
+                }
+                crew->barrier();
+                panel = panels[b.node];
+            }
+
+            // phase 4: the remaining tiles. The next round only writes tiles
+            // of the same owner before its first barrier, so there is none here.
+            for (int i = b.r0; i < b.r1; i++)
+            {
+                if (i != k)
+                {
+                    for (int j = b.c0; j < b.c1; j++)
+                    {
+                        if (j != k)
+                        {
+                            v.fwiabc(SUBM<E>(C, i, k, ld, L1), panel + j * cols, SUBM<E>(C, i, j, ld, L1), ld);
+                        }
+                    }
+                }
+            }
+        }
+    });
+    placed = C;
+    placedN = N;
+    placedL1 = L1;
+    return 0;
+}
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FW_PROTOCOL_HEADER
+#define FW_PROTOCOL_HEADER
+
+#include <stdint.h>
+
+// Binary protocol of the query server (server.hpp) over a Unix domain socket.
+//
+// A client sends requests, every one a fwq_request followed by bytes of
+// payload, and reads a fwq_response followed by bytes of payload for each of
+// them, in order. All fields are little-endian, vertices are numbered from 0.
+//
+// op           request payload               response payload
+// FWQ_INFO     -                             fwq_info
+// FWQ_DIST     count x (uint32 u, uint32 v)  count x double, the entry (u, v) of the closure
+// FWQ_ROW      count x uint32 u              count x n x double, the rows u of the closure
+// FWQ_PATH     count x (uint32 u, uint32 v)  count x (uint32 length, length x uint32 vertex),
+//                                            a path from u to v of value (u, v), length 0 if there is none
+// FWQ_RELOAD   path of a graph, may be empty  -
+// FWQ_STATS    -                             the latency histograms as text
+//
+// The transitive closure answers 1.0 for reachable and 0.0 for unreachable
+// pairs. FWQ_RELOAD recomputes the closure of the graph the server was started
+// with, or of the given one, and swaps it in atomically once it's done; the
+// generation of every response tells which closure answered it.
+
+#define FWQ_MAGIC 0x31515746u // "FWQ1" in little-endian
+#define FWQ_MAX_REQUEST_BYTES (64 << 20)
+
+enum fwq_op
+{
+    FWQ_INFO = 0,
+    FWQ_DIST = 1,
+    FWQ_ROW = 2,
+    FWQ_PATH = 3,
+    FWQ_RELOAD = 4,
+    FWQ_STATS = 5,
+    FWQ_NUM_OPS
+};
+
+enum fwq_status
+{
+    FWQ_OK = 0,
+    FWQ_BAD_REQUEST = 1,  // unknown op, or payload that doesn't match count
+    FWQ_OUT_OF_RANGE = 2, // a vertex >= n
+    FWQ_TOO_LARGE = 3,    // the response would exceed the limit of the server
+    FWQ_FAILED = 4        // e.g. the graph of FWQ_RELOAD couldn't be read
+};
+
+struct fwq_request
+{
+    uint32_t magic;
+    uint32_t op;
+    uint32_t count; // number of queries
+    uint32_t bytes; // of the payload
+};
+
+struct fwq_response
+{
+    uint32_t magic;
+    uint32_t status;
+    uint32_t count;
+    uint32_t bytes;      // of the payload
+    uint64_t generation; // of the closure, starts at 1 and grows with every reload
+};
+
+struct fwq_info
+{
+    uint32_t n;
+    char algorithm[4]; // "fw", "mm" or "tc", padded with zeros
+};
+
+#endif
@@ -0,0 +1,234 @@
+// Client of the query server, see protocol.h and README.md.
+//
+// query [-s socket] info
+// query [-s socket] dist u v [u v ...]
+// query [-s socket] row u [u ...]
+// query [-s socket] path u v [u v ...]
+// query [-s socket] reload [graph]
+// query [-s socket] stats
+// query [-s socket] bench queries [batch]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+
+// of the closure that answered the last request
+static uint64_t generation;
+
+static const char *status_names[] = {"ok", "bad request", "vertex out of range", "response too large", "failed"};
+
+static bool read_full(int fd, void *buf, size_t bytes)
+{
+    for (size_t done = 0; done < bytes;)
+    {
+        ssize_t got = read(fd, (char *)buf + done, bytes - done);
+        if (got <= 0)
+        {
+            return false;
+        }
+        done += got;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void *buf, size_t bytes)
+{
+    for (size_t done = 0; done < bytes;)
+    {
+        ssize_t put = write(fd, (const char *)buf + done, bytes - done);
+        if (put <= 0)
+        {
+            return false;
+        }
+        done += put;
+    }
+    return true;
+}
+
+/* Sends a request and reads its response into out. Returns the status, -1 if the connection failed. */
+static int request(int fd, uint32_t op, uint32_t count, const void *payload, uint32_t bytes, std::vector<char> &out)
+{
+    fwq_request req = {FWQ_MAGIC, op, count, bytes};
+    fwq_response res;
+    if (!write_full(fd, &req, sizeof(req)) || !write_full(fd, payload, bytes) || !read_full(fd, &res, sizeof(res)) ||
+        res.magic != FWQ_MAGIC)
+    {
+        fprintf(stderr, "connection to the server failed\n");
+        return -1;
+    }
+    generation = res.generation;
+    out.resize(res.bytes);
+    if (!read_full(fd, out.data(), res.bytes))
+    {
+        fprintf(stderr, "connection to the server failed\n");
+        return -1;
+    }
+    if (res.status != FWQ_OK)
+    {
+        fprintf(stderr, "server: %s\n", res.status <= FWQ_FAILED ? status_names[res.status] : "unknown status");
+    }
+    return res.status;
+}
+
+static std::vector<uint32_t> vertices(int argc, char **argv)
+{
+    std::vector<uint32_t> v;
+    for (int i = 0; i < argc; i++)
+    {
+        v.push_back(strtoul(argv[i], NULL, 10));
+    }
+    return v;
+}
+
+static double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// random dist requests of batch pairs each, until queries pairs are answered
+static int bench(int fd, long queries, int batch)
+{
+    std::vector<char> out;
+    if (request(fd, FWQ_INFO, 0, NULL, 0, out) != FWQ_OK)
+    {
+        return 1;
+    }
+    fwq_info info;
+    memcpy(&info, out.data(), sizeof(info));
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> vertex(0, info.n - 1);
+    std::vector<uint32_t> pairs(2 * batch);
+    double checksum = 0;
+    double start = now();
+    for (long done = 0; done < queries; done += batch)
+    {
+        for (uint32_t &p : pairs)
+        {
+            p = vertex(rng);
+        }
+        if (request(fd, FWQ_DIST, batch, pairs.data(), pairs.size() * sizeof(uint32_t), out) != FWQ_OK)
+        {
+            return 1;
+        }
+        checksum += ((double *)out.data())[0];
+    }
+    double seconds = now() - start;
+    long requests = (queries + batch - 1) / batch;
+    printf("%ld queries in %ld requests of %d: %.3fs, %.0f queries/s, %.1fus per request (checksum %g)\n",
+           requests * batch, requests, batch, seconds, requests * batch / seconds, seconds / requests * 1e6, checksum);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *socket_path = "/tmp/fw-server.sock";
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0)
+    {
+        socket_path = argv[2];
+        arg = 3;
+    }
+    struct sockaddr_un addr;
+    if (arg >= argc || strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "call as: %s [-s socket] info | dist u v... | row u... | path u v... | reload [graph] | stats | "
+                        "bench queries [batch]\n",
+                argv[0]);
+        return 1;
+    }
+    const char *cmd = argv[arg];
+    std::vector<uint32_t> v = vertices(argc - arg - 1, argv + arg + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "couldn't connect to %s\n", socket_path);
+        return 1;
+    }
+
+    std::vector<char> out;
+    int status = 0;
+    if (strcmp(cmd, "info") == 0)
+    {
+        status = request(fd, FWQ_INFO, 0, NULL, 0, out);
+        if (status == FWQ_OK)
+        {
+            fwq_info info;
+            memcpy(&info, out.data(), sizeof(info));
+            printf("%.4s n=%u generation=%llu\n", info.algorithm, info.n, (unsigned long long)generation);
+        }
+    }
+    else if ((strcmp(cmd, "dist") == 0 || strcmp(cmd, "path") == 0) && v.size() % 2 == 0 && !v.empty())
+    {
+        bool dist = cmd[0] == 'd';
+        status = request(fd, dist ? FWQ_DIST : FWQ_PATH, v.size() / 2, v.data(), v.size() * sizeof(uint32_t), out);
+        const uint32_t *p = (const uint32_t *)out.data();
+        for (size_t i = 0; status == FWQ_OK && i < v.size() / 2; i++)
+        {
+            printf("%u %u:", v[2 * i], v[2 * i + 1]);
+            if (dist)
+            {
+                printf(" %g", ((const double *)out.data())[i]);
+            }
+            else
+            {
+                uint32_t length = *p++;
+                for (uint32_t j = 0; j < length; j++)
+                {
+                    printf(" %u", *p++);
+                }
+            }
+            printf("\n");
+        }
+    }
+    else if (strcmp(cmd, "row") == 0 && !v.empty())
+    {
+        status = request(fd, FWQ_ROW, v.size(), v.data(), v.size() * sizeof(uint32_t), out);
+        size_t n = status == FWQ_OK ? out.size() / sizeof(double) / v.size() : 0;
+        for (size_t i = 0; i < v.size() && n > 0; i++)
+        {
+            for (size_t j = 0; j < n; j++)
+            {
+                printf(j + 1 < n ? "%g," : "%g\n", ((const double *)out.data())[i * n + j]);
+            }
+        }
+    }
+    else if (strcmp(cmd, "reload") == 0 && argc - arg <= 2)
+    {
+        const char *graph = argc - arg == 2 ? argv[arg + 1] : "";
+        status = request(fd, FWQ_RELOAD, 0, graph, strlen(graph), out);
+    }
+    else if (strcmp(cmd, "stats") == 0)
+    {
+        status = request(fd, FWQ_STATS, 0, NULL, 0, out);
+        fwrite(out.data(), 1, out.size(), stdout);
+    }
+    else if (strcmp(cmd, "bench") == 0 && (v.size() == 1 || v.size() == 2))
+    {
+        status = bench(fd, v[0], v.size() == 2 && v[1] > 0 ? v[1] : 1);
+    }
+    else
+    {
+        fprintf(stderr, "unknown command or wrong number of vertices: %s\n", cmd);
+        status = 1;
+    }
+    close(fd);
+    return status == 0 ? 0 : 1;
+}
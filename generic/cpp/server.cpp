@@ -0,0 +1,8 @@
+// The query server is linked in from one of the impl/template-tiles.cpp files,
+// see fw::serve in server.hpp.
+extern "C" int fw_server(int argc, char **argv);
+
+int main(int argc, char **argv)
+{
+    return fw_server(argc, argv) == 0 ? 0 : 1;
+}
@@ -0,0 +1,915 @@
+#ifndef FW_SERVER_HPP
+#define FW_SERVER_HPP
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../harness/input.h"
+#include "autotune.hpp"
+#include "compressed.hpp"
+#include "fw.hpp"
+#include "protocol.h"
+
+// Query server: computes the closure of a graph once, or maps it from a file,
+// and answers queries about it over a Unix domain socket, see protocol.h.
+//
+// The graph is read through input.h, in any of the formats of the drivers, and
+// kept as CSR for the paths, so only the closure takes N^2 entries.
+//
+// The graph and its closure form a snapshot, which every request reads
+// through a shared_ptr of its own, so a reload builds the next snapshot on
+// the side and swaps it in atomically while the clients are still served from
+// the previous one. Every connection is served by a thread of its own. With
+// -z, the transitive closure is kept compressed, see compressed.hpp, and built
+// without the matrix: per strongly connected component from the graph, or
+// row by row from a closure file.
+
+// entry point for the server binary, defined by impl/template-tiles.cpp
+extern "C" int fw_server(int argc, char **argv);
+
+namespace fw
+{
+
+// magic number of the binary matrix format of the native comparator, "FWM1" in a little-endian file
+#define SERVER_MATRIX_MAGIC 0x314d5746u
+// most matrix entries in a response
+#define SERVER_MAX_ENTRIES (1 << 27)
+// bucket b of a latency histogram counts the requests of [2^b, 2^(b + 1)) ns
+#define SERVER_BUCKETS 40
+
+// ---------------------------------------------------------------------------
+// entries as doubles, the transitive closure is bit-packed
+// ---------------------------------------------------------------------------
+static inline double get_entry(const double *A, int ld, int i, int j)
+{
+    return A[(size_t)i * ld + j];
+}
+
+static inline double get_entry(const char *A, int ld, int i, int j)
+{
+    return (A[(size_t)i * ld + j / 8] >> (j % 8)) & 1 ? 1.0 : 0.0;
+}
+
+static inline void set_entry(double *A, int ld, int i, int j, double x)
+{
+    A[(size_t)i * ld + j] = x;
+}
+
+static inline void set_entry(char *A, int ld, int i, int j, double x)
+{
+    char bit = 1 << (j % 8);
+    A[(size_t)i * ld + j / 8] = x != 0.0 ? A[(size_t)i * ld + j / 8] | bit : A[(size_t)i * ld + j / 8] & ~bit;
+}
+
+// ---------------------------------------------------------------------------
+// paths
+//
+// A path from u to v of value (u, v) is found by a BFS from u over the edges
+// that may lie on such a path, where du, db and dv are the entries (u, a),
+// (u, b) and (u, v) of the closure and w the weight of the edge (a, b):
+// - shortest path: the edges with du + w = db, every path over them is a
+//   shortest path, as their weights add up to dv
+// - max-min: the edges with w >= dv, every path over them is at least as wide
+// - transitive closure: all edges
+// For u = v it's a cycle through u, there is none if (u, u) is the zero.
+// ---------------------------------------------------------------------------
+static inline double one(MinPlus) { return 0.0; }
+static inline double one(MaxMin) { return INFINITY; }
+static inline double one(OrAnd) { return 1.0; }
+
+static inline bool tight(MinPlus, double da, double w, double db, double) { return da + w <= db + 1e-9 * fabs(db); }
+static inline bool tight(MaxMin, double, double w, double, double dv) { return w >= dv; }
+static inline bool tight(OrAnd, double, double, double, double) { return true; }
+
+// the better of parallel edges, as in the drivers
+static inline double better(MinPlus, double x, double y) { return std::min(x, y); }
+static inline double better(MaxMin, double x, double y) { return std::max(x, y); }
+static inline double better(OrAnd, double x, double y) { return std::max(x, y); }
+
+// the graph and its closure, ld elems per row
+template <class E>
+struct snapshot
+{
+    int N = 0, ld = 0;
+    uint64_t generation = 0;
+    // the graph as CSR, for paths: the edges of a are targets and weights [offsets[a], offsets[a + 1])
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> targets;
+    std::vector<double> weights;
+    E *C = NULL; // the closure
+    void *map = NULL; // of C if it's mapped from a file
+    size_t map_bytes = 0;
+    std::unique_ptr<compressed_closure> Z; // the closure instead of C, with -z
+
+    ~snapshot()
+    {
+        if (map != NULL)
+        {
+            munmap(map, map_bytes);
+        }
+        else
+        {
+            free(C);
+        }
+    }
+};
+
+// entry (i, j) of the closure of s
+template <class E>
+static inline double closure_entry(const snapshot<E> &s, int i, int j)
+{
+    return s.Z != NULL ? (s.Z->reach(i, j) ? 1.0 : 0.0) : get_entry(s.C, s.ld, i, j);
+}
+
+/* Appends a path from u to v of value (u, v) to out, as its length and its vertices. */
+template <class S, class E>
+void find_path(const snapshot<E> &s, int u, int v, std::vector<uint32_t> &out)
+{
+    const double zero = S::zero();
+    const double dv = closure_entry(s, u, v);
+    if (dv == zero)
+    {
+        out.push_back(0);
+        return;
+    }
+    std::vector<int> parent(s.N, -1);
+    std::vector<int> queue(1, u);
+    // a path from u to u is a cycle, which ends when u is reached again
+    if (u != v)
+    {
+        parent[u] = u;
+    }
+    for (size_t q = 0; q < queue.size() && parent[v] < 0; q++)
+    {
+        int a = queue[q];
+        double da = a == u ? one(S()) : closure_entry(s, u, a);
+        for (uint64_t x = s.offsets[a]; x < s.offsets[a + 1]; x++)
+        {
+            int b = s.targets[x];
+            if (parent[b] < 0 && tight(S(), da, s.weights[x], closure_entry(s, u, b), dv))
+            {
+                parent[b] = a;
+                queue.push_back(b);
+            }
+        }
+    }
+    if (parent[v] < 0)
+    {
+        // only if the closure doesn't belong to the graph
+        out.push_back(0);
+        return;
+    }
+    size_t start = out.size();
+    out.push_back(0);
+    int b = v;
+    do
+    {
+        out.push_back(b);
+        b = parent[b];
+    } while (b != u);
+    out.push_back(u);
+    std::reverse(out.begin() + start + 1, out.end());
+    out[start] = out.size() - start - 1;
+}
+
+// ---------------------------------------------------------------------------
+// input and output
+// ---------------------------------------------------------------------------
+
+/*
+ * Parses the rows of the dense text matrix that follow the first line: a line
+ * of N comma separated weights per row, where a missing edge is empty.
+ * Returns false if there are fewer rows or columns.
+ */
+template <class S, class E>
+bool read_dense(FILE *f, int N, std::vector<input_edge> &edges)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    bool ok = true;
+    for (int i = 0; i < N && ok; i++)
+    {
+        ok = getline(&line, &capacity, f) > 0;
+        char *p = line;
+        for (int j = 0; j < N && ok; j++)
+        {
+            // like the drivers, tc takes any entry as an edge
+            char *end = p;
+            double x = *p == ',' || *p == '\n' || *p == '\r' || *p == '\0' ? S::zero() : strtod(p, &end);
+            x = std::is_same<E, char>::value && end != p ? 1.0 : x;
+            if (x != S::zero())
+            {
+                edges.push_back({(uint32_t)i, (uint32_t)j, x});
+            }
+            p = strpbrk(end, ",\n");
+            ok = p != NULL || j == N - 1;
+            p = p != NULL ? p + 1 : end;
+        }
+    }
+    free(line);
+    return ok;
+}
+
+/*
+ * Reads a graph in any input format of the drivers, see input.h, into the CSR
+ * of s. Returns false if the file can't be read.
+ */
+template <class S, class E>
+bool read_graph(const char *path, snapshot<E> &s)
+{
+    struct input in;
+    if (input_open(path, &in) != 0)
+    {
+        return false;
+    }
+    // only the edges count for tc
+    in.no_weights = std::is_same<E, char>::value;
+    s.N = in.N;
+    s.ld = reg<E>::ld(in.N);
+
+    std::vector<input_edge> edges;
+    bool ok;
+    if (in.format == INPUT_DENSE)
+    {
+        ok = read_dense<S, E>(in.f, in.N, edges);
+        if (!ok)
+        {
+            fprintf(stderr, "malformed input %s: fewer than %d rows or columns\n", path, in.N);
+        }
+    }
+    else
+    {
+        edges.resize(in.m);
+        for (size_t n = 0; n < in.m && !in.error;)
+        {
+            n += input_edges(&in, &edges[n], in.m - n);
+        }
+        ok = !in.error;
+        for (input_edge &e : edges)
+        {
+            e.w = std::is_same<E, char>::value ? 1.0 : e.w;
+        }
+    }
+    input_close(&in);
+    if (!ok)
+    {
+        return false;
+    }
+
+    // counting sort by source, which keeps the order of the edges of a vertex
+    s.offsets.assign(s.N + 1, 0);
+    for (const input_edge &e : edges)
+    {
+        s.offsets[e.u + 1]++;
+    }
+    for (int a = 0; a < s.N; a++)
+    {
+        s.offsets[a + 1] += s.offsets[a];
+    }
+    std::vector<uint64_t> next(s.offsets.begin(), s.offsets.end() - 1);
+    s.targets.resize(edges.size());
+    s.weights.resize(edges.size());
+    for (const input_edge &e : edges)
+    {
+        s.targets[next[e.u]] = e.v;
+        s.weights[next[e.u]++] = e.w;
+    }
+    return true;
+}
+
+/* The adjacency matrix of the CSR of s into C, of N rows of s.ld elems. */
+template <class S, class E>
+void fill_matrix(const snapshot<E> &s, E *C)
+{
+    memset(C, 0, (size_t)s.N * s.ld * sizeof(E));
+    if (std::is_same<E, double>::value && S::zero() != 0.0)
+    {
+        for (int a = 0; a < s.N; a++)
+        {
+            input_fill((double *)&C[(size_t)a * s.ld], s.N, S::zero());
+        }
+    }
+    for (int a = 0; a < s.N; a++)
+    {
+        for (uint64_t x = s.offsets[a]; x < s.offsets[a + 1]; x++)
+        {
+            const int b = s.targets[x];
+            set_entry(C, s.ld, a, b, better(S(), get_entry(C, s.ld, a, b), s.weights[x]));
+        }
+    }
+}
+
+/*
+ * Maps, or reads for the transitive closure, the closure s.C of the graph of s
+ * from a file of the binary matrix format, or into s.Z if compress.
+ */
+template <class E>
+bool read_closure(const char *path, snapshot<E> &s, bool compress)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    uint32_t header[2];
+    const size_t bytes = sizeof(header) + (size_t)s.N * s.N * sizeof(double);
+    if (fd < 0 || fstat(fd, &st) != 0 || pread(fd, header, sizeof(header), 0) != sizeof(header) ||
+        header[0] != SERVER_MATRIX_MAGIC || header[1] != (uint32_t)s.N || (size_t)st.st_size < bytes)
+    {
+        fprintf(stderr, "%s isn't the closure of an %d x %d matrix in the binary format\n", path, s.N, s.N);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    void *map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "couldn't map %s\n", path);
+        return false;
+    }
+    const double *D = (const double *)((const char *)map + sizeof(header));
+    if (std::is_same<E, double>::value)
+    {
+        s.map = map;
+        s.map_bytes = bytes;
+        s.C = (E *)D;
+        return true;
+    }
+    if (compress)
+    {
+        const int N = s.N;
+        s.Z.reset(new compressed_closure(N, [D, N](int i, uint64_t *bits) {
+            for (int j = 0; j < N; j++)
+            {
+                bits[j / 64] |= (uint64_t)(D[(size_t)i * N + j] != 0.0) << (j % 64);
+            }
+        }));
+        munmap(map, bytes);
+        return true;
+    }
+    s.C = alloc_matrix<E>((size_t)s.N * s.ld);
+    for (int i = 0; i < s.N; i++)
+    {
+        for (int j = 0; j < s.N; j++)
+        {
+            set_entry(s.C, s.ld, i, j, D[(size_t)i * s.N + j]);
+        }
+    }
+    munmap(map, bytes);
+    return true;
+}
+
+/* Writes the closure of s in the binary matrix format, replacing path atomically. */
+template <class E>
+bool write_closure(const char *path, const snapshot<E> &s)
+{
+    std::string tmp = std::string(path) + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "couldn't write %s\n", tmp.c_str());
+        return false;
+    }
+    uint32_t header[2] = {SERVER_MATRIX_MAGIC, (uint32_t)s.N};
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+    std::vector<double> row(s.N);
+    for (int i = 0; i < s.N && ok; i++)
+    {
+        if (s.Z != NULL)
+        {
+            std::fill(row.begin(), row.end(), 0.0);
+            s.Z->for_each(i, [&row](int j) { row[j] = 1.0; });
+        }
+        for (int j = 0; j < s.N && s.Z == NULL; j++)
+        {
+            row[j] = get_entry(s.C, s.ld, i, j);
+        }
+        ok = fwrite(row.data(), sizeof(double), s.N, f) == (size_t)s.N;
+    }
+    ok = fclose(f) == 0 && ok && rename(tmp.c_str(), path) == 0;
+    if (!ok)
+    {
+        fprintf(stderr, "couldn't write %s\n", path);
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// latency histograms
+// ---------------------------------------------------------------------------
+static const char *op_names[FWQ_NUM_OPS] = {"info", "dist", "row", "path", "reload", "stats"};
+
+struct histogram
+{
+    std::atomic<uint64_t> buckets[SERVER_BUCKETS];
+    std::atomic<uint64_t> requests, queries, ns;
+
+    histogram() : requests(0), queries(0), ns(0)
+    {
+        for (std::atomic<uint64_t> &b : buckets)
+        {
+            b = 0;
+        }
+    }
+
+    void record(uint64_t latency, uint32_t count)
+    {
+        int b = 0;
+        while (b < SERVER_BUCKETS - 1 && latency >= (2ull << b))
+        {
+            b++;
+        }
+        buckets[b]++;
+        requests++;
+        queries += count;
+        ns += latency;
+    }
+
+    // upper bound of the bucket that holds the fraction q of the requests
+    uint64_t quantile(double q) const
+    {
+        uint64_t seen = 0;
+        for (int b = 0; b < SERVER_BUCKETS; b++)
+        {
+            seen += buckets[b];
+            if (seen >= q * requests && seen > 0)
+            {
+                return 2ull << b;
+            }
+        }
+        return 0;
+    }
+};
+
+static std::string format_ns(uint64_t ns)
+{
+    char s[32];
+    if (ns < 1000)
+    {
+        snprintf(s, sizeof(s), "%lluns", (unsigned long long)ns);
+    }
+    else if (ns < 1000000)
+    {
+        snprintf(s, sizeof(s), "%.1fus", ns / 1e3);
+    }
+    else
+    {
+        snprintf(s, sizeof(s), "%.1fms", ns / 1e6);
+    }
+    return s;
+}
+
+/* The histograms of all ops that were requested, as text. */
+static std::string format_stats(const histogram *h)
+{
+    std::string out;
+    char line[256];
+    snprintf(line, sizeof(line), "%-6s %10s %12s %12s %10s %10s %10s\n", "op", "requests", "queries", "ns/query", "p50", "p99",
+             "p99.9");
+    out += line;
+    for (int op = 0; op < FWQ_NUM_OPS; op++)
+    {
+        if (h[op].requests == 0)
+        {
+            continue;
+        }
+        snprintf(line, sizeof(line), "%-6s %10llu %12llu %12.0f %10s %10s %10s\n", op_names[op],
+                 (unsigned long long)h[op].requests, (unsigned long long)h[op].queries,
+                 (double)h[op].ns / std::max<uint64_t>(h[op].queries, 1), format_ns(h[op].quantile(0.5)).c_str(),
+                 format_ns(h[op].quantile(0.99)).c_str(), format_ns(h[op].quantile(0.999)).c_str());
+        out += line;
+    }
+    for (int op = 0; op < FWQ_NUM_OPS; op++)
+    {
+        if (h[op].requests == 0)
+        {
+            continue;
+        }
+        out += std::string("\n") + op_names[op] + " latency per request:\n";
+        for (int b = 0; b < SERVER_BUCKETS; b++)
+        {
+            if (h[op].buckets[b] > 0)
+            {
+                snprintf(line, sizeof(line), "  [%8s, %8s) %12llu\n", format_ns(b == 0 ? 0 : 1ull << b).c_str(),
+                         format_ns(2ull << b).c_str(), (unsigned long long)h[op].buckets[b]);
+                out += line;
+            }
+        }
+    }
+    return out;
+}
+
+static uint64_t now_ns()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------
+// the server
+// ---------------------------------------------------------------------------
+static bool read_full(int fd, void *buf, size_t bytes)
+{
+    for (size_t done = 0; done < bytes;)
+    {
+        ssize_t got = read(fd, (char *)buf + done, bytes - done);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return false;
+        }
+        done += got;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void *buf, size_t bytes)
+{
+    for (size_t done = 0; done < bytes;)
+    {
+        ssize_t put = send(fd, (const char *)buf + done, bytes - done, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (put <= 0)
+        {
+            return false;
+        }
+        done += put;
+    }
+    return true;
+}
+
+template <class S, class T>
+class server
+{
+    typedef typename reg<T>::elem E;
+
+public:
+    server(const char *algo, int (*run)(E *C, int N), std::string graph, std::string closure_in, std::string closure_out,
+           bool compress)
+        : algo(algo), run(run), graph(graph), closure_in(closure_in), closure_out(closure_out), compress(compress)
+    {
+    }
+
+    /*
+     * Builds the next snapshot from the graph at path, the one of the last
+     * load if it's empty, and swaps it in. Returns false and keeps the
+     * current snapshot if it fails.
+     */
+    bool load(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(loading);
+        const std::string file = path.empty() ? graph : path;
+        std::shared_ptr<snapshot<E>> next(new snapshot<E>());
+        if (!read_graph<S>(file.c_str(), *next))
+        {
+            return false;
+        }
+        if (!closure_in.empty())
+        {
+            // only the first load, later ones recompute the closure
+            bool ok = read_closure(closure_in.c_str(), *next, compress);
+            closure_in.clear();
+            if (!ok)
+            {
+                return false;
+            }
+            fprintf(stderr, "mapped the closure of %s\n", file.c_str());
+        }
+        else if (compress)
+        {
+            uint64_t start = now_ns();
+            next->Z.reset(new compressed_closure(next->N, next->offsets.data(), next->targets.data()));
+            fprintf(stderr, "computed the closure of %s (n=%d) by components in %.3fs\n", file.c_str(), next->N,
+                    (now_ns() - start) / 1e9);
+            if (!closure_out.empty())
+            {
+                write_closure(closure_out.c_str(), *next);
+            }
+        }
+        else
+        {
+            uint64_t start = now_ns();
+            size_t size = (size_t)next->N * next->ld;
+            next->C = alloc_matrix<E>(size);
+            fill_matrix<S>(*next, next->C);
+            if (run(next->C, next->N) != 0)
+            {
+                fprintf(stderr, "implementation reported an error\n");
+                return false;
+            }
+            fprintf(stderr, "computed the closure of %s (n=%d) in %.3fs\n", file.c_str(), next->N, (now_ns() - start) / 1e9);
+            if (!closure_out.empty())
+            {
+                write_closure(closure_out.c_str(), *next);
+            }
+        }
+        if (next->Z != NULL)
+        {
+            fprintf(stderr, "compressed the closure into %d distinct rows, %.1f MB instead of %.1f MB\n",
+                    next->Z->distinct_rows(), next->Z->bytes() / 1e6, (double)next->N * next->ld / 1e6);
+        }
+        std::shared_ptr<snapshot<E>> previous = std::atomic_load(&current);
+        next->generation = previous != NULL ? previous->generation + 1 : 1;
+        std::atomic_store(&current, next);
+        graph = file;
+        return true;
+    }
+
+    // serves the requests of a connection until it's closed
+    void session(int fd)
+    {
+        fwq_request req;
+        std::vector<char> payload, out;
+        while (read_full(fd, &req, sizeof(req)))
+        {
+            if (req.magic != FWQ_MAGIC || req.bytes > FWQ_MAX_REQUEST_BYTES)
+            {
+                respond(fd, FWQ_BAD_REQUEST, 0, out, std::atomic_load(&current));
+                break;
+            }
+            payload.resize(req.bytes);
+            if (!read_full(fd, payload.data(), req.bytes))
+            {
+                break;
+            }
+            uint64_t start = now_ns();
+            std::shared_ptr<snapshot<E>> s = std::atomic_load(&current);
+            out.clear();
+            uint32_t status = handle(req, payload, *s, out);
+            if (req.op == FWQ_RELOAD)
+            {
+                s = std::atomic_load(&current);
+            }
+            if (!respond(fd, status, status == FWQ_OK ? req.count : 0, out, s))
+            {
+                break;
+            }
+            if (req.op < FWQ_NUM_OPS)
+            {
+                stats[req.op].record(now_ns() - start, req.count);
+            }
+        }
+        close(fd);
+    }
+
+    std::string report() const { return format_stats(stats); }
+
+private:
+    uint32_t handle(const fwq_request &req, const std::vector<char> &payload, const snapshot<E> &s, std::vector<char> &out)
+    {
+        const uint32_t *q = (const uint32_t *)payload.data();
+        const size_t count = req.count;
+        switch (req.op)
+        {
+        case FWQ_INFO:
+        {
+            fwq_info info;
+            memset(&info, 0, sizeof(info));
+            info.n = s.N;
+            memcpy(info.algorithm, algo, std::min(strlen(algo), sizeof(info.algorithm)));
+            append(out, &info, sizeof(info));
+            return FWQ_OK;
+        }
+        case FWQ_DIST:
+        {
+            if (payload.size() != count * 2 * sizeof(uint32_t))
+            {
+                return FWQ_BAD_REQUEST;
+            }
+            out.resize(count * sizeof(double));
+            double *d = (double *)out.data();
+            for (size_t i = 0; i < count; i++)
+            {
+                if (q[2 * i] >= (uint32_t)s.N || q[2 * i + 1] >= (uint32_t)s.N)
+                {
+                    return FWQ_OUT_OF_RANGE;
+                }
+                d[i] = closure_entry(s, q[2 * i], q[2 * i + 1]);
+            }
+            return FWQ_OK;
+        }
+        case FWQ_ROW:
+        {
+            if (payload.size() != count * sizeof(uint32_t))
+            {
+                return FWQ_BAD_REQUEST;
+            }
+            if (count * s.N > SERVER_MAX_ENTRIES)
+            {
+                return FWQ_TOO_LARGE;
+            }
+            out.resize(count * s.N * sizeof(double));
+            double *d = (double *)out.data();
+            for (size_t i = 0; i < count; i++)
+            {
+                if (q[i] >= (uint32_t)s.N)
+                {
+                    return FWQ_OUT_OF_RANGE;
+                }
+                if (s.Z != NULL)
+                {
+                    double *row = &d[i * s.N];
+                    memset(row, 0, s.N * sizeof(double));
+                    s.Z->for_each(q[i], [row](int j) { row[j] = 1.0; });
+                    continue;
+                }
+                for (int j = 0; j < s.N; j++)
+                {
+                    d[i * s.N + j] = get_entry(s.C, s.ld, q[i], j);
+                }
+            }
+            return FWQ_OK;
+        }
+        case FWQ_PATH:
+        {
+            if (payload.size() != count * 2 * sizeof(uint32_t))
+            {
+                return FWQ_BAD_REQUEST;
+            }
+            std::vector<uint32_t> paths;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (q[2 * i] >= (uint32_t)s.N || q[2 * i + 1] >= (uint32_t)s.N)
+                {
+                    return FWQ_OUT_OF_RANGE;
+                }
+                find_path<S>(s, q[2 * i], q[2 * i + 1], paths);
+                if (paths.size() > SERVER_MAX_ENTRIES)
+                {
+                    return FWQ_TOO_LARGE;
+                }
+            }
+            append(out, paths.data(), paths.size() * sizeof(uint32_t));
+            return FWQ_OK;
+        }
+        case FWQ_RELOAD:
+            return load(std::string(payload.begin(), payload.end())) ? FWQ_OK : FWQ_FAILED;
+        case FWQ_STATS:
+        {
+            std::string text = report();
+            append(out, text.data(), text.size());
+            return FWQ_OK;
+        }
+        default:
+            return FWQ_BAD_REQUEST;
+        }
+    }
+
+    static void append(std::vector<char> &out, const void *p, size_t bytes)
+    {
+        out.insert(out.end(), (const char *)p, (const char *)p + bytes);
+    }
+
+    static bool respond(int fd, uint32_t status, uint32_t count, std::vector<char> &out, const std::shared_ptr<snapshot<E>> &s)
+    {
+        if (status != FWQ_OK)
+        {
+            out.clear();
+        }
+        fwq_response res = {FWQ_MAGIC, status, count, (uint32_t)out.size(), s != NULL ? s->generation : 0};
+        return write_full(fd, &res, sizeof(res)) && write_full(fd, out.data(), out.size());
+    }
+
+    const char *algo;
+    int (*run)(E *C, int N);
+    std::string graph, closure_in, closure_out;
+    bool compress;
+    std::mutex loading;
+    std::shared_ptr<snapshot<E>> current;
+    histogram stats[FWQ_NUM_OPS];
+};
+
+/*
+ * Main of the server binary of algo, with run computing the closure of an
+ * N x N matrix in place. Usage: [-s socket] [-c closure] [-w closure] [-z] graph
+ */
+template <class S, class T>
+int serve(const char *algo, int (*run)(typename reg<T>::elem *C, int N), int argc, char **argv)
+{
+    std::string socket_path = std::string("/tmp/") + algo + "-server.sock";
+    std::string closure_in, closure_out, graph;
+    bool compress = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            socket_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            closure_in = argv[++i];
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            closure_out = argv[++i];
+        }
+        else if (strcmp(argv[i], "-z") == 0 && std::is_same<typename reg<T>::elem, char>::value)
+        {
+            compress = true;
+        }
+        else if (graph.empty() && argv[i][0] != '-')
+        {
+            graph = argv[i];
+        }
+        else
+        {
+            graph.clear();
+            break;
+        }
+    }
+    struct sockaddr_un addr;
+    if (graph.empty() || socket_path.size() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "call as: %s [-s socket] [-c closure] [-w closure]%s graph\n", argv[0],
+                std::is_same<typename reg<T>::elem, char>::value ? " [-z]" : "");
+        return -1;
+    }
+
+    // SIGHUP reloads the graph, SIGINT and SIGTERM print the statistics and stop the server
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    static server<S, T> *srv = new server<S, T>(algo, run, graph, closure_in, closure_out, compress);
+    if (!srv->load(""))
+    {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path.c_str());
+    unlink(socket_path.c_str());
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "couldn't listen on %s: %s\n", socket_path.c_str(), strerror(errno));
+        return -1;
+    }
+    fprintf(stderr, "%s: listening on %s\n", algo, socket_path.c_str());
+
+    std::thread([signals, socket_path]() {
+        while (true)
+        {
+            int sig;
+            sigwait(&signals, &sig);
+            if (sig == SIGHUP)
+            {
+                srv->load("");
+                continue;
+            }
+            fprintf(stderr, "\n%s", srv->report().c_str());
+            unlink(socket_path.c_str());
+            exit(0);
+        }
+    }).detach();
+
+    while (true)
+    {
+        int client = accept(fd, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            fprintf(stderr, "couldn't accept: %s\n", strerror(errno));
+            return -1;
+        }
+        std::thread([client]() { srv->session(client); }).detach();
+    }
+}
+
+} // namespace fw
+
+#endif
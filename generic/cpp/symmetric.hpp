@@ -0,0 +1,130 @@
+#ifndef FW_SYMMETRIC_HPP
+#define FW_SYMMETRIC_HPP
+
+#include <stdlib.h>
+#include <vector>
+
+#include "variants.hpp"
+
+// FWT for undirected graphs, storing the upper triangular tiles only.
+//
+// The matrix of an undirected graph is symmetric, and so is its closure, as
+// both semirings of fw and mm are commutative: C_ji is the transpose of C_ij.
+// The tiles C_ij with i <= j are stored one after the other, row by row, each
+// as a contiguous L1 x L1 matrix, so the kernels of the table run on them with
+// ld = L1. Phases 2 and 3 then update the stored half of row and column k,
+// and phase 4 the tiles with i <= j, using transposed copies for the tiles of
+// row and column k that are only stored the other way around. Half the memory
+// and roughly half the work of FWT.
+
+namespace fw
+{
+
+// layout of the upper triangular tiles of an N x N matrix
+struct sym_layout
+{
+    int N, L1, M;
+
+    sym_layout(int N, int L1) : N(N), L1(L1), M(N / L1) {}
+
+    // number of entries
+    size_t size() const { return (size_t)M * (M + 1) / 2 * L1 * L1; }
+
+    // offset of the tile C_ij, i <= j
+    size_t tile(int i, int j) const { return ((size_t)i * M - (size_t)i * (i - 1) / 2 + (j - i)) * L1 * L1; }
+
+    // offset of the entry (i, j), or of (j, i) if it lies below the diagonal tiles
+    size_t index(int i, int j) const
+    {
+        if (i / L1 > j / L1)
+        {
+            int t = i;
+            i = j;
+            j = t;
+        }
+        return tile(i / L1, j / L1) + (size_t)(i % L1) * L1 + j % L1;
+    }
+};
+
+template <class E>
+static void transpose_tile(E *dst, const E *src, int L1)
+{
+    for (int i = 0; i < L1; i++)
+    {
+        for (int j = 0; j < L1; j++)
+        {
+            dst[j * L1 + i] = src[i * L1 + j];
+        }
+    }
+}
+
+/*
+ * Runs the FWT of v on the upper triangular tiles S of an undirected N x N
+ * graph in the layout sym_layout(N, v.L1). The tiles hold the same entries as
+ * after v.run on the whole matrix.
+ */
+template <class E>
+int FWsym(const variant<E> &v, E *S, int N)
+{
+    const int L1 = v.L1;
+    const sym_layout l(N, L1);
+    const int M = l.M;
+    const size_t L2 = (size_t)L1 * L1;
+
+    // the tiles of row k below the diagonal and of column k above it, transposed
+    static std::vector<E> scratch;
+    scratch.resize(2 * M * L2 + 32 / sizeof(E));
+    E *row = (E *)(((size_t)scratch.data() + 31) / 32 * 32);
+    E *col = row + M * L2;
+
+    for (int k = 0; k < M; k++)
+    {
+        E *Ckk = &S[l.tile(k, k)];
+
+        // phase 1: update the diagonal tile
+        v.fwi(Ckk, Ckk, Ckk, L1);
+
+        // phases 2 and 3: C_kj for j > k is part of row k, C_ik for i < k of column k
+        for (int j = k + 1; j < M; j++)
+        {
+            v.fwi(Ckk, &S[l.tile(k, j)], &S[l.tile(k, j)], L1);
+        }
+        for (int i = 0; i < k; i++)
+        {
+            v.fwi(&S[l.tile(i, k)], Ckk, &S[l.tile(i, k)], L1);
+        }
+
+        // A_ik = C_ki^T for i > k and B_kj = C_jk^T for j < k
+        for (int i = k + 1; i < M; i++)
+        {
+            transpose_tile(&col[i * L2], &S[l.tile(k, i)], L1);
+        }
+        for (int j = 0; j < k; j++)
+        {
+            transpose_tile(&row[j * L2], &S[l.tile(j, k)], L1);
+        }
+
+        // phase 4: update the remaining tiles with i <= j
+        for (int i = 0; i < M; i++)
+        {
+            if (i == k)
+            {
+                continue;
+            }
+            E *A = i < k ? &S[l.tile(i, k)] : &col[i * L2];
+            for (int j = i; j < M; j++)
+            {
+                if (j != k)
+                {
+                    E *B = j > k ? &S[l.tile(k, j)] : &row[j * L2];
+                    v.fwiabc(A, B, &S[l.tile(i, j)], L1);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+} // namespace fw
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef FW_TEMPLATE_TILES_HPP
+#define FW_TEMPLATE_TILES_HPP
+
+#include "autotune.hpp"
+#include "batch.hpp"
+#include "distributed.hpp"
+#include "fixed.hpp"
+#include "parallel.hpp"
+#include "server.hpp"
+#ifdef TILES_SYMMETRIC
+#include "symmetric.hpp"
+#endif
+
+// The entry points of impl/template-tiles.cpp, which are the same for every
+// algorithm up to the semiring and the table. The impl file includes the
+// header of its algorithm, which declares them, and defines before this one:
+//  SEMIRING         the semiring, e.g. fw::MinPlus
+//  ALGO             the name of the algorithm in the tuning database, e.g. "fw"
+//  REG              the register type of the build
+//  grid             the parameters the prebuilt table is instantiated for
+//  defaults         the parameters used if the tuning database has no entry for N
+//  TILES_SYMMETRIC  to also define the symmetric mode, for fw and mm
+
+// attributes of __m256d and __m256i ignored as template arguments, see reg in fw.hpp
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+typedef fw::reg<REG>::elem elem;
+#pragma GCC diagnostic pop
+
+static const std::vector<fw::variant<elem>> &variants()
+{
+    static const std::vector<fw::variant<elem>> table = fw::build_table<SEMIRING, REG, grid>();
+    return table;
+}
+
+// the kernel for N: a fixed-size one, else the variant of the table, else FWnaive if both are NULL
+struct kernel_choice
+{
+    int N;
+    int (*fixed)(elem *C, int N);
+    const fw::variant<elem> *v;
+};
+
+// looked up once per N by every thread, as the batch calls the kernels from many threads
+static const kernel_choice &choose(int N)
+{
+    static thread_local kernel_choice c = {-1, NULL, NULL};
+    if (N != c.N)
+    {
+        c.fixed = fw::fixed<SEMIRING, REG>(N);
+        c.v = fw::select(variants(), N, fw::tuned(variants(), ALGO, N, defaults));
+        c.N = N;
+    }
+    return c;
+}
+
+int floydWarshallParallel(elem *C, int N, int threads)
+{
+    const kernel_choice &c = choose(N);
+    if (c.fixed != NULL)
+    {
+        return c.fixed(C, N);
+    }
+    if (c.v == NULL)
+    {
+        return fw::FWnaive<SEMIRING, REG>(C, N);
+    }
+    return fw::FWparallel(*c.v, C, N, threads);
+}
+
+int floydWarshall(elem *C, int N)
+{
+    static const int threads = fw::env_threads();
+    return floydWarshallParallel(C, N, threads);
+}
+
+// the batch runs the graphs in parallel already
+static int floydWarshallSingle(elem *C, int N)
+{
+    return floydWarshallParallel(C, N, 1);
+}
+
+#ifdef TILES_SYMMETRIC
+// without a variant the matrix is a single tile
+static fw::sym_layout symmetric_layout(int N)
+{
+    const fw::variant<elem> *v = choose(N).v;
+    return fw::sym_layout(N, v != NULL ? v->L1 : N);
+}
+
+size_t symmetricSize(int N)
+{
+    return symmetric_layout(N).size();
+}
+
+size_t symmetricIndex(int N, int i, int j)
+{
+    return symmetric_layout(N).index(i, j);
+}
+
+int floydWarshallSymmetric(elem *S, int N)
+{
+    const fw::variant<elem> *v = choose(N).v;
+    if (v == NULL)
+    {
+        return fw::FWnaive<SEMIRING, REG>(S, N);
+    }
+    return fw::FWsym(*v, S, N);
+}
+#endif
+
+int fw_autotune(int argc, char **argv)
+{
+    return fw::autotune<SEMIRING, REG>(variants(), ALGO, argc, argv);
+}
+
+int floydWarshallBatch(elem *const *C, int N, int count, int threads)
+{
+    return fw::batch<SEMIRING, REG>(C, N, count, threads, floydWarshallSingle);
+}
+
+int fw_batch_bench(int argc, char **argv)
+{
+    return fw::batch_bench<SEMIRING, REG>(ALGO, floydWarshallSingle, argc, argv);
+}
+
+int fw_server(int argc, char **argv)
+{
+    return fw::serve<SEMIRING, REG>(ALGO, floydWarshall, argc, argv);
+}
+
+int fw_distributed(int argc, char **argv)
+{
+    return fw::distributed<SEMIRING, REG>(variants(), defaults, ALGO, argc, argv);
+}
+
+#endif
@@ -0,0 +1,455 @@
+#ifndef FW_TRANSPORT_HPP
+#define FW_TRANSPORT_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+// Message passing between the processes of a distributed run, see distributed.hpp.
+//
+// A transport connects the ranks 0 to size - 1 of a run with reliable, ordered
+// point-to-point channels. Sends block at most until the receiver has made
+// room, so a program in which every process performs its sends and receives
+// in the same global order can't deadlock. Broadcasts and barriers are built
+// on top of the channels, so an implementation only has to move bytes:
+// - shm: a ring buffer per ordered pair of ranks in a POSIX shared memory
+//   object, for the processes of one machine
+// - tcp: a TCP connection per pair of ranks, to localhost or across machines
+
+namespace fw
+{
+
+// default capacity of a ring buffer of the shm transport
+#define TRANSPORT_SHM_BYTES (256 << 10)
+// number of spins while waiting on a ring buffer before yielding the cpu
+#define TRANSPORT_SPINS (1 << 10)
+// time the ranks have to find each other
+#define TRANSPORT_CONNECT_SECONDS 30
+
+class transport
+{
+public:
+    transport(int rank, int size) : me(rank), P(size) {}
+    virtual ~transport() {}
+
+    int rank() const { return me; }
+    int size() const { return P; }
+
+    void send(int dst, const void *buf, size_t bytes)
+    {
+        put(dst, buf, bytes);
+        sent += bytes;
+    }
+
+    void recv(int src, void *buf, size_t bytes)
+    {
+        get(src, buf, bytes);
+        received += bytes;
+    }
+
+    /*
+     * Sends bytes of buf from the rank group[root] to all other ranks of
+     * group along a binomial tree, so the root sends log2 |group| copies
+     * instead of |group| - 1. Every rank of group calls it with the same
+     * arguments, except buf.
+     */
+    void broadcast(const std::vector<int> &group, int root, void *buf, size_t bytes)
+    {
+        const int g = group.size();
+        const int pos = std::find(group.begin(), group.end(), me) - group.begin();
+        const int rel = (pos - root + g) % g;
+        int mask = 1;
+        for (; mask < g; mask <<= 1)
+        {
+            if (rel & mask)
+            {
+                recv(group[(rel - mask + root) % g], buf, bytes);
+                break;
+            }
+        }
+        for (mask >>= 1; mask > 0; mask >>= 1)
+        {
+            if (rel + mask < g)
+            {
+                send(group[(rel + mask + root) % g], buf, bytes);
+            }
+        }
+    }
+
+    // waits for all ranks, not counted in sent and received
+    void barrier()
+    {
+        char token = 0;
+        for (int r = 1; r < P && me == 0; r++)
+        {
+            get(r, &token, 1);
+        }
+        for (int r = 1; r < P && me == 0; r++)
+        {
+            put(r, &token, 1);
+        }
+        if (me != 0)
+        {
+            put(0, &token, 1);
+            get(0, &token, 1);
+        }
+    }
+
+    // payload bytes moved by send and recv, including forwarded broadcasts
+    uint64_t sent = 0, received = 0;
+
+protected:
+    virtual void put(int dst, const void *buf, size_t bytes) = 0;
+    virtual void get(int src, void *buf, size_t bytes) = 0;
+
+    const int me, P;
+};
+
+static double transport_seconds()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------------
+// shared memory
+// ---------------------------------------------------------------------------
+class shm_transport : public transport
+{
+    // single producer, single consumer ring buffer, followed by capacity bytes
+    struct ring
+    {
+        alignas(64) std::atomic<uint64_t> head; // bytes written so far
+        alignas(64) std::atomic<uint64_t> tail; // bytes read so far
+
+        char *data() { return (char *)(this + 1); }
+    };
+
+public:
+    /*
+     * Maps the shared memory object name, which rank 0 creates and the others
+     * wait for. Returns NULL if it fails. Rank 0 removes the name once all
+     * ranks are connected, the mapping stays.
+     */
+    static shm_transport *create(const std::string &name, int rank, int size, size_t capacity = TRANSPORT_SHM_BYTES)
+    {
+        capacity = (capacity + 63) / 64 * 64;
+        const size_t stride = sizeof(ring) + capacity;
+        const size_t bytes = 64 + (size_t)size * size * stride;
+        const uint32_t magic = 0x4d485357; // "WSHM"
+
+        int fd = -1;
+        if (rank == 0)
+        {
+            shm_unlink(name.c_str());
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0 || ftruncate(fd, bytes) != 0)
+            {
+                fprintf(stderr, "couldn't create the shared memory %s: %s\n", name.c_str(), strerror(errno));
+                return NULL;
+            }
+        }
+        void *map = MAP_FAILED;
+        const double deadline = transport_seconds() + TRANSPORT_CONNECT_SECONDS;
+        while (map == MAP_FAILED && transport_seconds() < deadline)
+        {
+            struct stat st;
+            if (fd < 0)
+            {
+                fd = shm_open(name.c_str(), O_RDWR, 0600);
+            }
+            if (fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size == bytes)
+            {
+                map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            // rank 0 fills in the magic number last
+            if (map != MAP_FAILED && rank != 0 && ((std::atomic<uint32_t> *)map)->load() != magic)
+            {
+                munmap(map, bytes);
+                map = MAP_FAILED;
+            }
+            if (map == MAP_FAILED)
+            {
+                usleep(1000);
+            }
+        }
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (map == MAP_FAILED)
+        {
+            fprintf(stderr, "couldn't map the shared memory %s\n", name.c_str());
+            return NULL;
+        }
+        if (rank == 0)
+        {
+            ((std::atomic<uint32_t> *)map)->store(magic);
+        }
+
+        shm_transport *t = new shm_transport(rank, size, map, bytes, stride, capacity);
+        t->barrier();
+        if (rank == 0)
+        {
+            shm_unlink(name.c_str());
+        }
+        return t;
+    }
+
+    ~shm_transport() { munmap(map, map_bytes); }
+
+protected:
+    void put(int dst, const void *buf, size_t bytes) override
+    {
+        ring *r = channel(me, dst);
+        const char *p = (const char *)buf;
+        uint64_t head = r->head.load(std::memory_order_relaxed);
+        while (bytes > 0)
+        {
+            uint64_t tail = wait(r->tail, [&](uint64_t tail) { return head - tail < capacity; });
+            size_t chunk = std::min({bytes, (size_t)(capacity - (head - tail)), (size_t)(capacity - head % capacity)});
+            memcpy(&r->data()[head % capacity], p, chunk);
+            head += chunk;
+            p += chunk;
+            bytes -= chunk;
+            r->head.store(head, std::memory_order_release);
+        }
+    }
+
+    void get(int src, void *buf, size_t bytes) override
+    {
+        ring *r = channel(src, me);
+        char *p = (char *)buf;
+        uint64_t tail = r->tail.load(std::memory_order_relaxed);
+        while (bytes > 0)
+        {
+            uint64_t head = wait(r->head, [&](uint64_t head) { return head > tail; });
+            size_t chunk = std::min({bytes, (size_t)(head - tail), (size_t)(capacity - tail % capacity)});
+            memcpy(p, &r->data()[tail % capacity], chunk);
+            tail += chunk;
+            p += chunk;
+            bytes -= chunk;
+            r->tail.store(tail, std::memory_order_release);
+        }
+    }
+
+private:
+    shm_transport(int rank, int size, void *map, size_t map_bytes, size_t stride, size_t capacity)
+        : transport(rank, size), map(map), map_bytes(map_bytes), stride(stride), capacity(capacity)
+    {
+    }
+
+    ring *channel(int src, int dst) { return (ring *)((char *)map + 64 + ((size_t)src * P + dst) * stride); }
+
+    // spins, then yields, until ready(x) holds, returns x
+    template <class F>
+    static uint64_t wait(const std::atomic<uint64_t> &x, F ready)
+    {
+        for (int spins = 0;; spins++)
+        {
+            uint64_t v = x.load(std::memory_order_acquire);
+            if (ready(v))
+            {
+                return v;
+            }
+            if (spins < TRANSPORT_SPINS)
+            {
+                _mm_pause();
+            }
+            else
+            {
+                sched_yield();
+            }
+        }
+    }
+
+    void *map;
+    size_t map_bytes, stride, capacity;
+};
+
+// ---------------------------------------------------------------------------
+// TCP
+// ---------------------------------------------------------------------------
+class tcp_transport : public transport
+{
+public:
+    /*
+     * Connects rank to all others, where rank r listens on hosts[r] at port
+     * + r. Every rank connects to the lower ranks and accepts the higher
+     * ones. Returns NULL if it fails.
+     */
+    static tcp_transport *create(const std::vector<std::string> &hosts, int port, int rank)
+    {
+        const int P = hosts.size();
+        std::vector<int> fds(P, -1);
+
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port + rank);
+        if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, P) != 0)
+        {
+            fprintf(stderr, "rank %d couldn't listen on port %d: %s\n", rank, port + rank, strerror(errno));
+            return NULL;
+        }
+
+        const double deadline = transport_seconds() + TRANSPORT_CONNECT_SECONDS;
+        for (int r = 0; r < rank; r++)
+        {
+            while (fds[r] < 0 && transport_seconds() < deadline)
+            {
+                fds[r] = connect_to(hosts[r], port + r);
+                if (fds[r] < 0)
+                {
+                    usleep(10000);
+                }
+            }
+            int32_t id = rank;
+            if (fds[r] < 0 || !write_all(fds[r], &id, sizeof(id)))
+            {
+                fprintf(stderr, "rank %d couldn't connect to rank %d at %s:%d\n", rank, r, hosts[r].c_str(), port + r);
+                return NULL;
+            }
+        }
+        for (int accepted = rank + 1; accepted < P; accepted++)
+        {
+            int fd = accept(listener, NULL, NULL);
+            int32_t id;
+            if (fd < 0 || !read_all(fd, &id, sizeof(id)) || id <= rank || id >= P || fds[id] >= 0)
+            {
+                fprintf(stderr, "rank %d couldn't accept the higher ranks\n", rank);
+                return NULL;
+            }
+            fds[id] = fd;
+        }
+        close(listener);
+
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+        tcp_transport *t = new tcp_transport(rank, P, fds);
+        t->barrier();
+        return t;
+    }
+
+    ~tcp_transport()
+    {
+        for (int fd : fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+protected:
+    void put(int dst, const void *buf, size_t bytes) override
+    {
+        if (!write_all(fds[dst], buf, bytes))
+        {
+            fprintf(stderr, "rank %d lost the connection to rank %d\n", me, dst);
+            exit(1);
+        }
+    }
+
+    void get(int src, void *buf, size_t bytes) override
+    {
+        if (!read_all(fds[src], buf, bytes))
+        {
+            fprintf(stderr, "rank %d lost the connection to rank %d\n", me, src);
+            exit(1);
+        }
+    }
+
+private:
+    tcp_transport(int rank, int size, const std::vector<int> &fds) : transport(rank, size), fds(fds) {}
+
+    static int connect_to(const std::string &host, int port)
+    {
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+        {
+            return -1;
+        }
+        int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        return fd;
+    }
+
+    static bool write_all(int fd, const void *buf, size_t bytes)
+    {
+        for (size_t done = 0; done < bytes;)
+        {
+            ssize_t put = ::send(fd, (const char *)buf + done, bytes - done, MSG_NOSIGNAL);
+            if (put < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (put <= 0)
+            {
+                return false;
+            }
+            done += put;
+        }
+        return true;
+    }
+
+    static bool read_all(int fd, void *buf, size_t bytes)
+    {
+        for (size_t done = 0; done < bytes;)
+        {
+            ssize_t got = read(fd, (char *)buf + done, bytes - done);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                return false;
+            }
+            done += got;
+        }
+        return true;
+    }
+
+    std::vector<int> fds;
+};
+
+} // namespace fw
+
+#endif
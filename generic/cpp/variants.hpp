@@ -0,0 +1,164 @@
+#ifndef FW_VARIANTS_HPP
+#define FW_VARIANTS_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iterator>
+#include <vector>
+
+#include "../tunedb/tunedb.h"
+#include "fw.hpp"
+
+// Prebuilt tables of FWT instantiations. A parameter grid lists the values to
+// try for every parameter; build_table instantiates FWT for all combinations
+// of the grid that satisfy the divisibility constraints, so the parameters can
+// be chosen at runtime without generating or recompiling any code.
+
+namespace fw
+{
+
+// one instantiation of FWT<S, T, L1, Ui, Uj, Uii, Ujj, Ukk>, together with
+// the FWI and FWIabc instantiations it is made of
+template <class E>
+struct variant
+{
+    int L1, ui, uj, uii, ujj, ukk;
+    int (*run)(E *A, E *B, E *C, int N);
+    void (*fwi)(E *A, E *B, E *C, int ld);
+    void (*fwiabc)(E *A, E *B, E *C, int ld);
+};
+
+// same checks as the static_asserts in FWI and FWIabc
+template <class T, int L1, int Ui, int Uj, int Uii, int Ujj, int Ukk>
+constexpr bool valid()
+{
+    constexpr int W = reg<T>::width;
+    constexpr int cols = reg<T>::cols(L1);
+    return Uj % W == 0 && Ujj % W == 0 &&
+           L1 % Ui == 0 && cols % Uj == 0 &&
+           L1 % Uii == 0 && L1 % Ukk == 0 && cols % Ujj == 0;
+}
+
+/*
+ * Grid is a struct with the static constexpr int arrays L1, Ui, Uj, Uii, Ujj
+ * and Ukk. Note that Uj and Uj' count matrix entries along j, i.e. bytes for
+ * the bit-packed transitive closure, as in the jinja templates.
+ */
+template <class S, class T, class Grid>
+std::vector<variant<typename reg<T>::elem>> build_table()
+{
+    std::vector<variant<typename reg<T>::elem>> table;
+    unroll<std::size(Grid::L1)>([&](auto a) {
+        constexpr int L1 = Grid::L1[a];
+        unroll<std::size(Grid::Ui)>([&](auto b) {
+            constexpr int Ui = Grid::Ui[b];
+            unroll<std::size(Grid::Uj)>([&](auto c) {
+                constexpr int Uj = Grid::Uj[c];
+                unroll<std::size(Grid::Uii)>([&](auto d) {
+                    constexpr int Uii = Grid::Uii[d];
+                    unroll<std::size(Grid::Ujj)>([&](auto e) {
+                        constexpr int Ujj = Grid::Ujj[e];
+                        unroll<std::size(Grid::Ukk)>([&](auto f) {
+                            constexpr int Ukk = Grid::Ukk[f];
+                            if constexpr (valid<T, L1, Ui, Uj, Uii, Ujj, Ukk>())
+                            {
+                                table.push_back({L1, Ui, Uj, Uii, Ujj, Ukk,
+                                                 &FWT<S, T, L1, Ui, Uj, Uii, Ujj, Ukk>,
+                                                 &FWI<S, T, L1, Ui, Uj>,
+                                                 &FWIabc<S, T, L1, Uii, Ujj, Ukk>});
+                            }
+                        });
+                    });
+                });
+            });
+        });
+    });
+    return table;
+}
+
+// parameter tuple (L1, Ui, Uj, Ui', Uj', Uk'), same order as in optimal-parameters.log
+struct params
+{
+    int L1, ui, uj, uii, ujj, ukk;
+};
+
+template <class E>
+const variant<E> *find(const std::vector<variant<E>> &table, params p)
+{
+    for (const variant<E> &v : table)
+    {
+        if (v.L1 == p.L1 && v.ui == p.ui && v.uj == p.uj && v.uii == p.uii && v.ujj == p.ujj && v.ukk == p.ukk)
+        {
+            return &v;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns the parameters of the tuning database for algo and N if the table
+ * contains them, and p otherwise.
+ */
+template <class E>
+params tuned(const std::vector<variant<E>> &table, const char *algo, int N, params p)
+{
+    struct tunedb_entry e;
+    if (tunedb_lookup(algo, N, &e) == 0)
+    {
+        params q = {e.L1, e.ui, e.uj, e.uii, e.ujj, e.ukk};
+        if (find(table, q) != NULL)
+        {
+            return q;
+        }
+    }
+    return p;
+}
+
+/*
+ * Picks the variant to run for an N x N matrix.
+ *
+ * The parameters are taken from the FW_PARAMS environment variable
+ * ("L1,Ui,Uj,Ui',Uj',Uk'") if set, and from p otherwise. If L1 doesn't divide
+ * N, the largest tile size with the same unrolling factors that does is used.
+ * Returns NULL if no variant fits, in which case the caller falls back to
+ * FWnaive.
+ */
+template <class E>
+const variant<E> *select(const std::vector<variant<E>> &table, int N, params p)
+{
+    const char *env = getenv("FW_PARAMS");
+    if (env != NULL)
+    {
+        params q;
+        if (sscanf(env, "%d,%d,%d,%d,%d,%d", &q.L1, &q.ui, &q.uj, &q.uii, &q.ujj, &q.ukk) == 6 && find(table, q) != NULL)
+        {
+            p = q;
+        }
+        else
+        {
+            fprintf(stderr, "FW_PARAMS=%s is not in the table, using %d,%d,%d,%d,%d,%d\n",
+                    env, p.L1, p.ui, p.uj, p.uii, p.ujj, p.ukk);
+        }
+    }
+
+    const variant<E> *best = NULL;
+    for (const variant<E> &v : table)
+    {
+        if (v.ui == p.ui && v.uj == p.uj && v.uii == p.uii && v.ujj == p.ujj && v.ukk == p.ukk && N % v.L1 == 0)
+        {
+            if (v.L1 == p.L1)
+            {
+                return &v;
+            }
+            if (best == NULL || v.L1 > best->L1)
+            {
+                best = &v;
+            }
+        }
+    }
+    return best;
+}
+
+} // namespace fw
+
+#endif
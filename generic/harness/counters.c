@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "counters.h"
+
+#ifndef HARNESS_PERF
+
+// ----------------------------- PAPI ------------------------------
+
+#include <papi.h>
+
+#define ERROR_RETURN(retval)                                                         \
+    {                                                                                \
+        fprintf(stderr, "PAPI error %d %s:line %d: \n", retval, __FILE__, __LINE__); \
+        exit(retval);                                                                \
+    }
+
+// Only add events supported on your machine. Check with the papi_avail tool in the PAPI utils
+// The first four are required, the others are only counted if the machine supports them
+#define NUM_REQUIRED 4
+static int event_codes[COUNTERS_NUM_EVENTS] = {
+    PAPI_TOT_CYC, // Total cycles executed
+    PAPI_L3_TCM,  // L3 cache misses
+    PAPI_L2_TCM,  // L2 data cache misses
+    PAPI_L1_DCM,  // L1 data cache misses
+    PAPI_TOT_INS, // Instructions completed
+    PAPI_TLB_DM,  // Data translation lookaside buffer misses
+    PAPI_BR_MSP,  // Conditional branch instructions mispredicted
+    PAPI_NULL,    // DRAM bytes, not a PAPI preset
+};
+
+static int event_set = PAPI_NULL;
+// position of every event in the event set, -1 if it isn't counted
+static int position[COUNTERS_NUM_EVENTS];
+static int num_counted = 0;
+
+void counters_init(void)
+{
+    int retval;
+    if ((retval = PAPI_library_init(PAPI_VER_CURRENT)) != PAPI_VER_CURRENT)
+    {
+        ERROR_RETURN(retval);
+    }
+    if ((retval = PAPI_create_eventset(&event_set)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+    // count the threads this one starts, such as the team of a parallel kernel,
+    // which needs the component of the events before they are added
+    PAPI_option_t opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.inherit.eventset = event_set;
+    opt.inherit.inherit = PAPI_INHERIT_ALL;
+    if ((retval = PAPI_assign_eventset_component(event_set, 0)) != PAPI_OK ||
+        (retval = PAPI_set_opt(PAPI_INHERIT, &opt)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+    num_counted = 0;
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        position[e] = -1;
+        if (event_codes[e] == PAPI_NULL)
+        {
+            continue;
+        }
+        if ((retval = PAPI_add_event(event_set, event_codes[e])) == PAPI_OK)
+        {
+            position[e] = num_counted++;
+        }
+        else if (e < NUM_REQUIRED)
+        {
+            ERROR_RETURN(retval);
+        }
+    }
+    if ((retval = PAPI_start(event_set)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+}
+
+const char *counters_backend(void)
+{
+    return "papi";
+}
+
+int counters_per_thread(void)
+{
+    return 1;
+}
+
+int counters_supported(int event)
+{
+    return position[event] >= 0;
+}
+
+void counters_read(long long values[COUNTERS_NUM_EVENTS])
+{
+    long long counted[COUNTERS_NUM_EVENTS];
+    int retval;
+    if ((retval = PAPI_read(event_set, counted)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        values[e] = position[e] >= 0 ? counted[position[e]] : 0;
+    }
+}
+
+void counters_shutdown(void)
+{
+    long long values[COUNTERS_NUM_EVENTS];
+    int retval;
+    if ((retval = PAPI_stop(event_set, values)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+    /* Free all memory and data structures, EventSet must be empty. */
+    if ((retval = PAPI_cleanup_eventset(event_set)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+    if ((retval = PAPI_destroy_eventset(&event_set)) != PAPI_OK)
+    {
+        ERROR_RETURN(retval);
+    }
+    /* free the resources used by PAPI */
+    PAPI_shutdown();
+}
+
+#else
+
+// ------------------------ perf_event_open ------------------------
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../cpp/tsc_x86.h"
+
+#define CACHE_EVENT(cache, op, result) \
+    ((cache) | ((op) << 8) | ((result) << 16))
+
+// there is no generic event for L2 misses, the last level cache is the L3 on all our machines
+static const struct
+{
+    unsigned int type;
+    unsigned long long config;
+} events[COUNTERS_NUM_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_MAX, 0}, // not available
+    {PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, CACHE_EVENT(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_MAX, 0}, // uncore, see open_imc
+};
+
+// threads of the process when counting starts, each has its own events
+#define MAX_THREADS 1024
+static int tids[MAX_THREADS];
+static int num_threads = 0;
+// file descriptor of every event and thread, -1 if it isn't counted
+static int fds[COUNTERS_NUM_EVENTS][MAX_THREADS];
+static int supported[COUNTERS_NUM_EVENTS];
+// an event was only counted part of the time, as the pmu has fewer counters than events
+static int multiplexed = 0;
+// cycles are read from the time stamp counter if the kernel doesn't let us count them
+static int use_tsc = 0;
+
+// memory controller events of the uncore, in bytes per count
+#define MAX_IMC_EVENTS 32
+static int imc_fds[MAX_IMC_EVENTS];
+static double imc_scale[MAX_IMC_EVENTS];
+static int num_imc = 0;
+
+static int perf_event_open(struct perf_event_attr *attr, int pid, int cpu)
+{
+    return (int)syscall(SYS_perf_event_open, attr, pid, cpu, -1, 0);
+}
+
+static int read_sysfs(const char *pmu, const char *file, char *buf, int size)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/bus/event_source/devices/%s/%s", pmu, file);
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    int ok = fgets(buf, size, f) != NULL;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+/*
+ * Opens event (e.g. "data_reads") of the uncore pmu system-wide. The event
+ * string of sysfs, e.g. "event=0x04,umask=0x03", is translated to the config
+ * with the bit ranges given in format/. Returns the file descriptor or -1.
+ */
+static int open_uncore(const char *pmu, const char *event, double *scale)
+{
+    char buf[256], file[128];
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+
+    if (read_sysfs(pmu, "type", buf, sizeof(buf)) != 0)
+    {
+        return -1;
+    }
+    attr.type = (unsigned int)atoi(buf);
+
+    snprintf(file, sizeof(file), "events/%s", event);
+    if (read_sysfs(pmu, file, buf, sizeof(buf)) != 0)
+    {
+        return -1;
+    }
+    for (char *term = strtok(buf, ",\n"); term != NULL; term = strtok(NULL, ",\n"))
+    {
+        char *eq = strchr(term, '=');
+        if (eq == NULL)
+        {
+            return -1;
+        }
+        *eq = '\0';
+        char format[64];
+        int lo;
+        snprintf(file, sizeof(file), "format/%s", term);
+        if (read_sysfs(pmu, file, format, sizeof(format)) != 0 || sscanf(format, "config:%d", &lo) != 1)
+        {
+            return -1;
+        }
+        attr.config |= strtoull(eq + 1, NULL, 0) << lo;
+    }
+
+    // counts are cache lines unless sysfs says otherwise
+    *scale = 64;
+    snprintf(file, sizeof(file), "events/%s.scale", event);
+    if (read_sysfs(pmu, file, buf, sizeof(buf)) == 0)
+    {
+        *scale = atof(buf);
+        snprintf(file, sizeof(file), "events/%s.unit", event);
+        if (read_sysfs(pmu, file, buf, sizeof(buf)) == 0 && strncmp(buf, "MiB", 3) == 0)
+        {
+            *scale *= 1024 * 1024;
+        }
+    }
+
+    // uncore events are counted system-wide on one cpu of the socket
+    int cpu = 0;
+    if (read_sysfs(pmu, "cpumask", buf, sizeof(buf)) == 0)
+    {
+        cpu = atoi(buf);
+    }
+    return perf_event_open(&attr, -1, cpu);
+}
+
+// opens the reads and writes of all memory controllers, returns their number
+static int open_imc(void)
+{
+    const char *imc_events[] = {"data_reads", "data_writes", "cas_count_read", "cas_count_write"};
+    char pmu[64];
+    num_imc = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        // uncore_imc on desktop parts, uncore_imc_0 ... on servers
+        if (i == 0)
+        {
+            snprintf(pmu, sizeof(pmu), "uncore_imc");
+        }
+        else
+        {
+            snprintf(pmu, sizeof(pmu), "uncore_imc_%d", i - 1);
+        }
+        for (int e = 0; e < 4 && num_imc < MAX_IMC_EVENTS; e++)
+        {
+            int fd = open_uncore(pmu, imc_events[e], &imc_scale[num_imc]);
+            if (fd >= 0)
+            {
+                imc_fds[num_imc++] = fd;
+            }
+        }
+    }
+    return num_imc;
+}
+
+// the threads of this process, the calling one first, returns their number
+static int list_threads(void)
+{
+    num_threads = 0;
+    tids[num_threads++] = (int)syscall(SYS_gettid);
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == NULL)
+    {
+        return num_threads;
+    }
+    for (struct dirent *d; (d = readdir(dir)) != NULL && num_threads < MAX_THREADS;)
+    {
+        int tid = atoi(d->d_name);
+        if (tid > 0 && tid != tids[0])
+        {
+            tids[num_threads++] = tid;
+        }
+    }
+    closedir(dir);
+    return num_threads;
+}
+
+void counters_init(void)
+{
+    list_threads();
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        supported[e] = 0;
+        for (int t = 0; t < MAX_THREADS; t++)
+        {
+            fds[e][t] = -1;
+        }
+        if (events[e].type == PERF_TYPE_MAX)
+        {
+            continue;
+        }
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[e].type;
+        attr.config = events[e].config;
+        // user space only, which is all that's permitted with perf_event_paranoid = 2
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // the events are opened apart, so the kernel may multiplex them, see read_scaled
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // every thread on any cpu: the kernel may run on the threads of a
+        // team that already exist, and inherit counts the threads they start
+        // later, such as a team created by the first run
+        attr.inherit = 1;
+        for (int t = 0; t < num_threads; t++)
+        {
+            fds[e][t] = perf_event_open(&attr, tids[t], -1);
+        }
+        supported[e] = fds[e][0] >= 0;
+    }
+    supported[COUNTERS_DRAM_BYTES] = open_imc() > 0;
+
+    use_tsc = fds[COUNTERS_CYCLES][0] < 0;
+    if (use_tsc)
+    {
+        fprintf(stderr, "perf_event_open not permitted, measuring cycles with rdtsc only\n");
+        init_tsc();
+    }
+}
+
+const char *counters_backend(void)
+{
+    return use_tsc ? "rdtsc" : "perf";
+}
+
+int counters_per_thread(void)
+{
+    return !use_tsc;
+}
+
+int counters_supported(int event)
+{
+    // fds are closed by counters_shutdown, cycles are always counted (or read with rdtsc)
+    return event == 0 || supported[event];
+}
+
+/*
+ * Reads the event of fd, scaled up to the time it was enabled if the kernel
+ * only let it count part of that time. 0 if it can't be read or never counted.
+ */
+static long long read_scaled(int fd)
+{
+    // value, time enabled and time running, see read_format
+    unsigned long long count[3];
+    if (read(fd, count, sizeof(count)) != sizeof(count) || count[2] == 0)
+    {
+        return 0;
+    }
+    if (count[2] < count[1])
+    {
+        multiplexed = 1;
+        return (long long)((double)count[0] * count[1] / count[2]);
+    }
+    return (long long)count[0];
+}
+
+void counters_read(long long values[COUNTERS_NUM_EVENTS])
+{
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        // the sum over the threads
+        values[e] = 0;
+        for (int t = 0; t < num_threads; t++)
+        {
+            values[e] += fds[e][t] >= 0 ? read_scaled(fds[e][t]) : 0;
+        }
+    }
+    if (use_tsc)
+    {
+        values[0] = (long long)start_tsc();
+    }
+    for (int i = 0; i < num_imc; i++)
+    {
+        long long count;
+        if (read(imc_fds[i], &count, sizeof(long long)) == sizeof(long long))
+        {
+            values[COUNTERS_DRAM_BYTES] += (long long)(count * imc_scale[i]);
+        }
+    }
+}
+
+void counters_shutdown(void)
+{
+    if (multiplexed)
+    {
+        fprintf(stderr, "the pmu multiplexed the events, their counts are scaled up to the time they were enabled\n");
+        multiplexed = 0;
+    }
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        for (int t = 0; t < num_threads; t++)
+        {
+            if (fds[e][t] >= 0)
+            {
+                close(fds[e][t]);
+                fds[e][t] = -1;
+            }
+        }
+    }
+    for (int i = 0; i < num_imc; i++)
+    {
+        close(imc_fds[i]);
+    }
+    num_imc = 0;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef COUNTERS_HEADER
+#define COUNTERS_HEADER
+
+// Hardware counters read by the benchmark harness.
+//
+// Two backends implement this interface, selected at compile time:
+//  - PAPI (default), requires libpapi
+//  - perf_event_open (-DHARNESS_PERF), requires nothing but Linux. If the
+//    kernel doesn't permit counting (see /proc/sys/kernel/perf_event_paranoid)
+//    cycles are read from the time stamp counter of tsc_x86.h instead.
+//
+// The events count all threads of the process, so the counts of a parallel
+// kernel are those of the whole team: the perf backend opens the events of
+// every thread that exists when counting starts, and both backends inherit the
+// counters into the threads started later. PAPI misses the threads that
+// already exist, which the kernels of this repository don't have, as their
+// team is started by the first measured run.
+//
+// An event the backend can't count on this machine reads as 0. The perf backend
+// opens every event on its own, and if the pmu has fewer counters than events,
+// the kernel multiplexes them and the counts are scaled by the time enabled
+// over the time running, as perf stat does.
+//
+// dram_bytes are the bytes read from and written to memory by the whole
+// system, counted by the memory controllers of the uncore. Only the perf
+// backend reads them, which requires perf_event_paranoid <= 0 or root.
+
+// The events we count
+// IMPORTANT: DO NOT CHANGE ORDER! Otherwise the data readout in the measurement script breaks
+#define COUNTERS_NUM_EVENTS 8
+#define COUNTERS_EVENT_NAMES {"cycles", "l3_misses", "l2_misses", "l1d_misses", \
+                              "instructions", "dtlb_misses", "branch_misses", "dram_bytes"}
+
+#define COUNTERS_CYCLES 0
+#define COUNTERS_L3_MISSES 1
+#define COUNTERS_DTLB_MISSES 5
+#define COUNTERS_DRAM_BYTES 7
+
+/* Sets up and starts counting all supported events. */
+void counters_init(void);
+
+/* Name of the backend, e.g. "papi". */
+const char *counters_backend(void);
+
+/* Returns 1 if event is counted on this machine and 0 otherwise. */
+int counters_supported(int event);
+
+/*
+ * Returns 1 if the cycles are the sum over the threads, so a job of T busy
+ * threads takes T times its wall clock, and 0 if they are the time stamp
+ * counter of the calling thread.
+ */
+int counters_per_thread(void);
+
+/* Reads the current values of all events, which keep counting. */
+void counters_read(long long values[COUNTERS_NUM_EVENTS]);
+
+/* Stops counting and releases all resources. */
+void counters_shutdown(void);
+
+#endif
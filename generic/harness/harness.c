@@ -0,0 +1,589 @@
+#define _GNU_SOURCE // CPU_COUNT
+#include <immintrin.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "harness.h"
+#include "pages.h"
+#include "phases.h"
+
+static const char *event_names[COUNTERS_NUM_EVENTS] = COUNTERS_EVENT_NAMES;
+
+// fine, I'll do it myself
+static void flush_cache(void *addr, size_t nbytes)
+{
+    // assume cache line of 64 bytes, cause why wouldn't it be
+    for (char *p = (char *)addr; p < (char *)addr + nbytes; p += 64)
+    {
+        // Invalidate and flush the cache line that contains p from all levels of the cache hierarchy
+        _mm_clflush(p);
+    }
+    // Ensure cache flushes have completed
+    _mm_mfence();
+}
+
+static double env_double(const char *name, double value)
+{
+    const char *env = getenv(name);
+    return env != NULL ? atof(env) : value;
+}
+
+/* Threads of the kernel: FW_THREADS as the parallel kernels read it, 1 if it isn't set, all cpus we may run on if <= 0. */
+static int harness_threads(void)
+{
+    const char *env = getenv("FW_THREADS");
+    int threads = env == NULL ? 1 : atoi(env);
+    cpu_set_t set;
+    if (threads <= 0 && sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        threads = CPU_COUNT(&set);
+    }
+    return threads < 1 ? 1 : threads;
+}
+
+// cycles of the counters of a job that ran on threads threads, per thread
+static double wall_cycles(long long cycles, int threads)
+{
+    return counters_per_thread() ? (double)cycles / threads : (double)cycles;
+}
+
+// ---------------------------------------------------------------------------
+// calibration of the roofline
+//
+// The peak is the rate of the operation pairs of the kernels, min and add on
+// doubles, and and or on bit-packed entries, in registers of the width the
+// kernels use, with 12 independent chains to hide the latencies. The scalar
+// instructions run on the same ports, so the scalar peak is the SIMD peak
+// over the lanes of a register. beta is the bandwidth of reading a buffer
+// larger than the L3 with all threads.
+// ---------------------------------------------------------------------------
+
+// iterations of the peak loops, of 12 operation pairs each
+#define CALIBRATION_ITERATIONS (1 << 21)
+// smallest and largest buffer read for beta
+#define CALIBRATION_MIN_BYTES (64 << 20)
+#define CALIBRATION_MAX_BYTES (512 << 20)
+
+#define CHAINS(op) op(0) op(1) op(2) op(3) op(4) op(5) op(6) op(7) op(8) op(9) op(10) op(11)
+
+static volatile double calibration_sink;
+
+__attribute__((target("avx2"))) static void pairs_avx2(int bits)
+{
+    if (bits < 64)
+    {
+        __m256i d = _mm256_set1_epi64x(0x5555555555555555ll), e = _mm256_set1_epi64x(0x0101010101010101ll);
+#define DECLARE_I(c) __m256i a##c = _mm256_set1_epi64x(c);
+#define PAIR_I(c) a##c = _mm256_or_si256(_mm256_and_si256(a##c, d), e);
+#define SUM_I(c) sum ^= _mm256_extract_epi64(a##c, 0);
+        CHAINS(DECLARE_I)
+        for (long i = 0; i < CALIBRATION_ITERATIONS; i++)
+        {
+            CHAINS(PAIR_I)
+        }
+        long long sum = 0;
+        CHAINS(SUM_I)
+        calibration_sink = (double)sum;
+        return;
+    }
+    __m256d d = _mm256_set1_pd(1e-9);
+#define DECLARE_D(c) __m256d a##c = _mm256_set1_pd(c);
+#define PAIR_D(c) a##c = _mm256_min_pd(a##c, _mm256_add_pd(a##c, d));
+#define SUM_D(c) sum += _mm256_cvtsd_f64(a##c);
+    CHAINS(DECLARE_D)
+    for (long i = 0; i < CALIBRATION_ITERATIONS; i++)
+    {
+        CHAINS(PAIR_D)
+    }
+    double sum = 0;
+    CHAINS(SUM_D)
+    calibration_sink = sum;
+}
+
+static void pairs_sse2(int bits)
+{
+    if (bits < 64)
+    {
+        __m128i d = _mm_set1_epi64x(0x5555555555555555ll), e = _mm_set1_epi64x(0x0101010101010101ll);
+#define DECLARE_I128(c) __m128i a##c = _mm_set1_epi64x(c);
+#define PAIR_I128(c) a##c = _mm_or_si128(_mm_and_si128(a##c, d), e);
+#define SUM_I128(c) sum ^= _mm_cvtsi128_si64(a##c);
+        CHAINS(DECLARE_I128)
+        for (long i = 0; i < CALIBRATION_ITERATIONS; i++)
+        {
+            CHAINS(PAIR_I128)
+        }
+        long long sum = 0;
+        CHAINS(SUM_I128)
+        calibration_sink = (double)sum;
+        return;
+    }
+    __m128d d = _mm_set1_pd(1e-9);
+#define DECLARE_D128(c) __m128d a##c = _mm_set1_pd(c);
+#define PAIR_D128(c) a##c = _mm_min_pd(a##c, _mm_add_pd(a##c, d));
+#define SUM_D128(c) sum += _mm_cvtsd_f64(a##c);
+    CHAINS(DECLARE_D128)
+    for (long i = 0; i < CALIBRATION_ITERATIONS; i++)
+    {
+        CHAINS(PAIR_D128)
+    }
+    double sum = 0;
+    CHAINS(SUM_D128)
+    calibration_sink = sum;
+}
+
+// width of the vector registers of the kernels in bits, AVX2 or SSE2
+static int vector_bits(void)
+{
+    return __builtin_cpu_supports("avx2") ? 256 : 128;
+}
+
+/* Operations per cycle of one thread on vector registers, for entries of the given bits. */
+static double calibrate_peak(int bits)
+{
+    long long before[COUNTERS_NUM_EVENTS], after[COUNTERS_NUM_EVENTS];
+    counters_read(before);
+    if (vector_bits() == 256)
+    {
+        pairs_avx2(bits);
+    }
+    else
+    {
+        pairs_sse2(bits);
+    }
+    counters_read(after);
+    double ops = 2.0 * 12 * CALIBRATION_ITERATIONS * (vector_bits() / bits);
+    return ops / (double)(after[COUNTERS_CYCLES] - before[COUNTERS_CYCLES]);
+}
+
+struct stream
+{
+    const long long *buf;
+    size_t count;
+    long long sum;
+};
+
+static void *read_stream(void *arg)
+{
+    struct stream *s = (struct stream *)arg;
+    long long sum = 0;
+    for (size_t i = 0; i < s->count; i++)
+    {
+        sum += s->buf[i];
+    }
+    s->sum = sum;
+    return NULL;
+}
+
+/* Bytes per cycle that threads threads read from memory together, 0 if the buffer can't be allocated. */
+static double calibrate_beta(int threads)
+{
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    size_t bytes = l3 > 0 ? 4 * (size_t)l3 : CALIBRATION_MIN_BYTES;
+    bytes = bytes < CALIBRATION_MIN_BYTES ? CALIBRATION_MIN_BYTES : bytes > CALIBRATION_MAX_BYTES ? CALIBRATION_MAX_BYTES : bytes;
+    long long *buf = (long long *)malloc(bytes);
+    struct stream *streams = (struct stream *)calloc(threads, sizeof(struct stream));
+    pthread_t *workers = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    int *started = (int *)calloc(threads, sizeof(int));
+    if (buf == NULL || streams == NULL || workers == NULL || started == NULL)
+    {
+        free(buf);
+        free(streams);
+        free(workers);
+        free(started);
+        return 0;
+    }
+    // fault the pages in, and out of the caches
+    memset(buf, 1, bytes);
+    flush_cache(buf, bytes);
+
+    const size_t count = bytes / sizeof(long long);
+    long long before[COUNTERS_NUM_EVENTS], after[COUNTERS_NUM_EVENTS];
+    counters_read(before);
+    for (int t = 0; t < threads; t++)
+    {
+        streams[t].buf = &buf[count * t / threads];
+        streams[t].count = count * (t + 1) / threads - count * t / threads;
+        started[t] = t > 0 && pthread_create(&workers[t], NULL, read_stream, &streams[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        // the slices of the threads that couldn't be started are read by this one
+        if (!started[t])
+        {
+            read_stream(&streams[t]);
+        }
+    }
+    for (int t = 1; t < threads; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(workers[t], NULL);
+        }
+    }
+    counters_read(after);
+
+    long long sum = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        sum += streams[t].sum;
+    }
+    calibration_sink = (double)sum;
+    free(buf);
+    free(streams);
+    free(workers);
+    free(started);
+    return bytes / wall_cycles(after[COUNTERS_CYCLES] - before[COUNTERS_CYCLES], threads);
+}
+
+/*
+ * The roofline of the mean run of r, with the peaks and beta calibrated
+ * unless they are given. Reads the counters, so they have to be running.
+ */
+static void compute_roofline(const struct harness_kernel *kernel, const struct harness_result *r,
+                             struct harness_roofline *roof)
+{
+    double n = r->N;
+    roof->threads = harness_threads();
+    double cycles = wall_cycles((long long)r->events[COUNTERS_CYCLES].mean, roof->threads);
+
+    // the peaks scale with the number of entries per register, and the threads
+    int bits = kernel->entry_bits > 0 ? kernel->entry_bits : 64;
+    double lanes = bits < 64 ? 64.0 / bits : 1.0;
+    const char *simd_peak = getenv("FW_SIMD_PEAK");
+    roof->simd_peak = simd_peak != NULL ? atof(simd_peak) : calibrate_peak(bits) * roof->threads;
+    roof->peak = env_double("FW_PEAK", roof->simd_peak * lanes * bits / vector_bits());
+
+    roof->work = 2 * n * n * n;
+    roof->perf = roof->work / cycles;
+    roof->traffic = 0;
+    roof->source = "none";
+    if (r->supported[COUNTERS_DRAM_BYTES])
+    {
+        roof->traffic = r->events[COUNTERS_DRAM_BYTES].mean;
+        roof->source = "dram";
+    }
+    else if (r->supported[COUNTERS_L3_MISSES])
+    {
+        roof->traffic = 64 * r->events[COUNTERS_L3_MISSES].mean;
+        roof->source = "l3_misses";
+    }
+    // beta only matters with a traffic to compare to
+    const char *beta = getenv("FW_BETA");
+    roof->beta = beta != NULL ? atof(beta) : roof->traffic > 0 ? calibrate_beta(roof->threads) : 0;
+    roof->bandwidth = roof->traffic / cycles;
+    roof->intensity = roof->traffic > 0 ? roof->work / roof->traffic : 0;
+    roof->bound = roof->simd_peak;
+    if (roof->traffic > 0 && roof->beta > 0 && roof->beta * roof->intensity < roof->bound)
+    {
+        roof->bound = roof->beta * roof->intensity;
+    }
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void compute_stats(double *samples, int n, struct harness_stats *s)
+{
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        sum += samples[i];
+    }
+    s->mean = sum / n;
+
+    double var = 0;
+    for (int i = 0; i < n; i++)
+    {
+        var += (samples[i] - s->mean) * (samples[i] - s->mean);
+    }
+    s->stddev = n > 1 ? sqrt(var / (n - 1)) : 0;
+
+    qsort(samples, n, sizeof(double), compare);
+    s->min = samples[0];
+    s->median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    s->p95 = samples[(int)ceil(0.95 * n) - 1]; // nearest rank
+}
+
+const struct harness_kernel *harness_select(const struct harness_kernel *kernels, int num_kernels)
+{
+    const char *name = getenv("FW_KERNEL");
+    if (name == NULL)
+    {
+        return &kernels[0];
+    }
+    for (int i = 0; i < num_kernels; i++)
+    {
+        if (strcmp(kernels[i].name, name) == 0)
+        {
+            return &kernels[i];
+        }
+    }
+    fprintf(stderr, "unknown kernel FW_KERNEL=%s, available:", name);
+    for (int i = 0; i < num_kernels; i++)
+    {
+        fprintf(stderr, " %s", kernels[i].name);
+    }
+    fprintf(stderr, "\n");
+    return NULL;
+}
+
+int harness_measure(const struct harness_kernel *kernel, void *C, size_t bytes, int N, struct harness_result *result)
+{
+    const char *cache = getenv("FW_CACHE");
+    int cold = cache != NULL && strcmp(cache, "cold") == 0;
+    long long before[COUNTERS_NUM_EVENTS], after[COUNTERS_NUM_EVENTS];
+
+    counters_init();
+    result->backend = counters_backend();
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        result->supported[e] = counters_supported(e);
+    }
+
+    // Compute how many runs we need to do and warm up cache, every run has to succeed
+    int ok = 1;
+    int num_runs = HARNESS_MIN_RUNS;
+    while (ok && num_runs < HARNESS_MAX_RUNS)
+    {
+        long long cycles = 0;
+        for (int i = 0; i < num_runs && ok; i++)
+        {
+            if (cold)
+            {
+                flush_cache(C, bytes);
+            }
+            counters_read(before);
+            ok = kernel->run(C, N) == 0;
+            counters_read(after);
+            cycles += after[0] - before[0];
+        }
+        if (cycles >= HARNESS_CYCLES_REQUIRED)
+        {
+            break;
+        }
+        num_runs *= 2;
+    }
+    if (ok)
+    {
+        fprintf(stderr, "#runs: %d (%s cache, %s counters)\n", num_runs, cold ? "cold" : "warm", result->backend);
+    }
+
+    // measure every run separately
+    double *samples = (double *)malloc((size_t)COUNTERS_NUM_EVENTS * num_runs * sizeof(double));
+#ifdef FW_PHASES
+    phases_reset();
+#endif
+    for (int i = 0; i < num_runs && ok; i++)
+    {
+        if (cold)
+        {
+            flush_cache(C, bytes);
+        }
+#ifdef FW_PHASES
+        // only the first run is traced
+        phases_record(1, i == 0);
+#endif
+        counters_read(before);
+        ok = kernel->run(C, N) == 0;
+        counters_read(after);
+#ifdef FW_PHASES
+        phases_record(0, 0);
+#endif
+        for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+        {
+            samples[e * num_runs + i] = (double)(after[e] - before[e]);
+        }
+    }
+
+    if (!ok)
+    {
+        counters_shutdown();
+        fprintf(stderr, "kernel %s reported an error\n", kernel->name);
+        free(samples);
+        return -1;
+    }
+
+    result->kernel = kernel->name;
+    result->N = N;
+    result->cold = cold;
+    result->num_runs = num_runs;
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        // sorts the samples of e
+        compute_stats(&samples[e * num_runs], num_runs, &result->events[e]);
+    }
+    result->samples = samples;
+    // calibrates with the counters of the runs
+    compute_roofline(kernel, result, &result->roofline);
+    counters_shutdown();
+    // after the runs, as the kernel allocates transparent huge pages on first touch
+    result->pages = pages_kind(C);
+    result->huge_bytes = pages_huge_bytes(C);
+    return 0;
+}
+
+static void write_json(const char *path, const struct harness_result *r)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        fprintf(stderr, "couldn't write statistics to %s\n", path);
+        return;
+    }
+    fprintf(f, "{\n  \"kernel\": \"%s\",\n  \"n\": %d,\n  \"cache\": \"%s\",\n  \"counters\": \"%s\",\n  \"runs\": %d,\n"
+               "  \"pages\": \"%s\",\n  \"huge_bytes\": %zu,\n  \"events\": {",
+            r->kernel, r->N, r->cold ? "cold" : "warm", r->backend, r->num_runs, r->pages, r->huge_bytes);
+    const char *sep = "\n";
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        if (!r->supported[e])
+        {
+            continue;
+        }
+        const struct harness_stats *s = &r->events[e];
+        fprintf(f, "%s    \"%s\": {\"mean\": %.1f, \"median\": %.1f, \"p95\": %.1f, \"stddev\": %.1f, \"min\": %.1f",
+                sep, event_names[e], s->mean, s->median, s->p95, s->stddev, s->min);
+        if (e == COUNTERS_CYCLES)
+        {
+            // every run, in ascending order
+            fprintf(f, ", \"samples\": [");
+            for (int i = 0; i < r->num_runs; i++)
+            {
+                fprintf(f, i > 0 ? ", %.0f" : "%.0f", r->samples[e * r->num_runs + i]);
+            }
+            fprintf(f, "]");
+        }
+        fprintf(f, "}");
+        sep = ",\n";
+    }
+    const struct harness_roofline *roof = &r->roofline;
+    fprintf(f, "\n  },\n  \"roofline\": {\"work\": %.0f, \"traffic\": %.0f, \"traffic_source\": \"%s\", "
+               "\"intensity\": %.4f, \"perf\": %.4f, \"bandwidth\": %.4f, \"peak\": %.1f, \"simd_peak\": %.1f, "
+               "\"beta\": %.2f, \"bound\": %.4f, \"threads\": %d}\n}\n",
+            roof->work, roof->traffic, roof->source, roof->intensity, roof->perf, roof->bandwidth,
+            roof->peak, roof->simd_peak, roof->beta, roof->bound, roof->threads);
+    fclose(f);
+}
+
+static void append_csv(const char *path, const struct harness_result *r)
+{
+    FILE *f = fopen(path, "a");
+    if (f == NULL)
+    {
+        fprintf(stderr, "couldn't write statistics to %s\n", path);
+        return;
+    }
+    if (ftell(f) == 0)
+    {
+        fprintf(f, "kernel,n,cache,counters,runs,event,mean,median,p95,stddev,min\n");
+    }
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        if (!r->supported[e])
+        {
+            continue;
+        }
+        const struct harness_stats *s = &r->events[e];
+        fprintf(f, "%s,%d,%s,%s,%d,%s,%.1f,%.1f,%.1f,%.1f,%.1f\n", r->kernel, r->N, r->cold ? "cold" : "warm",
+                r->backend, r->num_runs, event_names[e], s->mean, s->median, s->p95, s->stddev, s->min);
+    }
+    fclose(f);
+}
+
+static void print_roofline(const struct harness_result *r)
+{
+    const struct harness_roofline *roof = &r->roofline;
+    fprintf(stderr, "\nroofline of %s for n=%d on %d thread%s (mean run):\n", r->kernel, r->N, roof->threads,
+            roof->threads > 1 ? "s" : "");
+    fprintf(stderr, "  performance  P = %.3f flops/cycle (%.1f%% of scalar peak %.1f, %.1f%% of SIMD peak %.1f)\n",
+            roof->perf, 100 * roof->perf / roof->peak, roof->peak, 100 * roof->perf / roof->simd_peak, roof->simd_peak);
+    if (strcmp(roof->source, "none") == 0)
+    {
+        fprintf(stderr, "  traffic      unknown, the counters backend measures neither DRAM bytes nor L3 misses\n");
+    }
+    else if (roof->beta > 0)
+    {
+        fprintf(stderr, "  traffic      Q = %.0f bytes (%s), %.3f bytes/cycle (%.1f%% of beta %.2f)\n",
+                roof->traffic, roof->source, roof->bandwidth, 100 * roof->bandwidth / roof->beta, roof->beta);
+    }
+    else
+    {
+        fprintf(stderr, "  traffic      Q = %.0f bytes (%s), %.3f bytes/cycle\n", roof->traffic, roof->source,
+                roof->bandwidth);
+    }
+    if (roof->traffic > 0)
+    {
+        fprintf(stderr, "  intensity    I = %.3f flops/byte, %s-bound\n",
+                roof->intensity, roof->beta * roof->intensity < roof->simd_peak ? "memory" : "compute");
+    }
+    fprintf(stderr, "  roofline     P <= %.3f flops/cycle, reached %.1f%%\n", roof->bound, 100 * roof->perf / roof->bound);
+}
+
+static void print_pages(const struct harness_result *r)
+{
+    fprintf(stderr, "\npages of the matrix: %s", r->pages);
+    if (r->huge_bytes > 0)
+    {
+        fprintf(stderr, ", %.1f MiB on huge pages", r->huge_bytes / (1024.0 * 1024.0));
+    }
+    if (r->supported[COUNTERS_DTLB_MISSES])
+    {
+        fprintf(stderr, ", %.0f dTLB misses per run", r->events[COUNTERS_DTLB_MISSES].mean);
+    }
+    fprintf(stderr, "\n");
+}
+
+void harness_report(const struct harness_result *result)
+{
+    // output measurements
+    printf("%d", result->num_runs);
+    for (int e = 0; e < HARNESS_STDOUT_EVENTS; e++)
+    {
+        printf("\n%lld", (long long)result->events[e].mean);
+    }
+
+    print_roofline(result);
+    print_pages(result);
+#ifdef FW_PHASES
+    phases_report(result->kernel, result->N, result->num_runs);
+#endif
+
+    const char *json = getenv("FW_STATS_JSON");
+    if (json != NULL)
+    {
+        write_json(json, result);
+    }
+    const char *csv = getenv("FW_STATS_CSV");
+    if (csv != NULL)
+    {
+        append_csv(csv, result);
+    }
+}
+
+int harness_run(const struct harness_kernel *kernels, int num_kernels, void *C, size_t bytes, int N)
+{
+    const struct harness_kernel *kernel = harness_select(kernels, num_kernels);
+    if (kernel == NULL)
+    {
+        return -1;
+    }
+
+    struct harness_result result;
+    if (harness_measure(kernel, C, bytes, N, &result) != 0)
+    {
+        return -1;
+    }
+    harness_report(&result);
+    free(result.samples);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#ifndef HARNESS_HEADER
+#define HARNESS_HEADER
+
+#include <stddef.h>
+
+#include "counters.h"
+
+// Benchmark harness shared by the drivers (main.c) of all algorithms.
+//
+// A driver parses its input into a matrix, registers the kernels it was linked
+// with and hands both to harness_run, which measures every run separately and
+// reports the distribution of each counter. The measured matrix is modified in
+// place by every run, as we don't particularly care about the input.
+//
+// Environment variables:
+//  FW_KERNEL      name of the kernel to measure, defaults to the first one
+//  FW_CACHE       "warm" (default) or "cold" to flush the matrix before every run
+//  FW_STATS_JSON  path of a json file to write the statistics to
+//  FW_STATS_CSV   path of a csv file to append the statistics to
+//  FW_PEAK        scalar peak performance in flops/cycle, see harness_roofline
+//  FW_SIMD_PEAK   SIMD peak performance in flops/cycle, calibrated if not set
+//  FW_BETA        memory bandwidth in bytes/cycle, calibrated if not set
+//  FW_THREADS     threads of the kernel as in generic/cpp/parallel.hpp, the peaks and beta are of all of them
+//  FW_PAGES       pages of the matrix: auto (default), 1g, 2m, thp or 4k, see pages.h
+
+// number of events printed to stdout: cycles, l3, l2 and l1d misses, see counters.h
+#define HARNESS_STDOUT_EVENTS 4
+
+#define HARNESS_MIN_RUNS 16
+#define HARNESS_MAX_RUNS (1 << 14)
+#define HARNESS_CYCLES_REQUIRED 1e8
+
+struct harness_kernel
+{
+    const char *name;
+    // returns 0 on success, C is the matrix of an N x N graph
+    int (*run)(void *C, int N);
+    // bits per matrix entry, i.e. 64 for doubles and 1 for the bit-packed transitive closure
+    int entry_bits;
+};
+
+struct harness_stats
+{
+    double mean, median, p95, stddev, min;
+};
+
+/*
+ * Roofline of the mean run. The work W = 2 n^3 is the number of semiring
+ * operations, the same estimate as in measurements/perf-plots.py. The memory
+ * traffic Q is measured by the memory controllers if the counters backend
+ * supports it, and estimated as 64 bytes per L3 miss otherwise. The cycles
+ * are the wall clock of the run, and the peaks and beta are calibrated on
+ * this cpu for the threads of the kernel.
+ */
+struct harness_roofline
+{
+    double work;        // W in flops
+    double traffic;     // Q in bytes, 0 if unknown
+    const char *source; // of Q: "dram" or "l3_misses"
+    double intensity;   // I = W / Q in flops/byte
+    double perf;        // P = W / cycles in flops/cycle
+    double bandwidth;   // Q / cycles in bytes/cycle
+    double peak;        // scalar peak in flops/cycle
+    double simd_peak;   // SIMD peak in flops/cycle
+    double beta;        // memory bandwidth in bytes/cycle, 0 if Q is unknown
+    int threads;        // of the kernel, see FW_THREADS
+    double bound;       // min(simd_peak, beta * I), simd_peak if Q is unknown
+};
+
+struct harness_result
+{
+    const char *kernel;
+    int N;
+    int cold;
+    int num_runs;
+    const char *backend;
+    int supported[COUNTERS_NUM_EVENTS];
+    struct harness_stats events[COUNTERS_NUM_EVENTS];
+    struct harness_roofline roofline;
+    const char *pages; // backing the matrix, see pages_kind
+    size_t huge_bytes; // of the matrix on huge pages after the runs, 0 if unknown
+    // num_runs values per event, event after event, allocated by harness_measure
+    double *samples;
+};
+
+/* Returns the kernel named by FW_KERNEL, or the first one if it isn't set. */
+const struct harness_kernel *harness_select(const struct harness_kernel *kernels, int num_kernels);
+
+/*
+ * Measures kernel on the N x N matrix C of the given size in bytes.
+ * Returns 0 on success, the caller frees result->samples.
+ */
+int harness_measure(const struct harness_kernel *kernel, void *C, size_t bytes, int N, struct harness_result *result);
+
+/*
+ * Prints the number of runs and the mean of the first HARNESS_STDOUT_EVENTS
+ * events to stdout, one per line, as read by measurements/measure.py, and the
+ * roofline to stderr. Writes the statistics of all supported events to the
+ * files given by FW_STATS_JSON and FW_STATS_CSV. The json file also lists the
+ * cycles of every run, see measurements/regress.py.
+ */
+void harness_report(const struct harness_result *result);
+
+/* harness_select, harness_measure and harness_report. Returns 0 on success. */
+int harness_run(const struct harness_kernel *kernels, int num_kernels, void *C, size_t bytes, int N);
+
+#endif
@@ -0,0 +1,221 @@
+#include <immintrin.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "input.h"
+
+// longest line of a text file besides the rows of the dense matrix
+#define INPUT_LINE 256
+
+int input_open(const char *filename, struct input *in)
+{
+    memset(in, 0, sizeof(*in));
+    in->f = fopen(filename, "rb");
+    if (in->f == NULL)
+    {
+        fprintf(stderr, "couldn't open %s\n", filename);
+        return -1;
+    }
+
+    uint32_t header[2];
+    if (fread(header, sizeof(header), 1, in->f) == 1 && (header[0] == INPUT_EDGES_MAGIC || header[0] == INPUT_CSR_MAGIC))
+    {
+        in->format = header[0] == INPUT_EDGES_MAGIC ? INPUT_BINARY_EDGES : INPUT_CSR;
+        in->N = header[1];
+        if (fread(&in->m, sizeof(in->m), 1, in->f) != 1 || header[1] < 1 || header[1] > INT32_MAX)
+        {
+            fprintf(stderr, "malformed input: truncated header of %s\n", filename);
+            input_close(in);
+            return -1;
+        }
+        if (in->format == INPUT_CSR)
+        {
+            in->offsets = (uint64_t *)malloc((in->N + 1) * sizeof(uint64_t));
+            if (fread(in->offsets, sizeof(uint64_t), in->N + 1, in->f) != (size_t)in->N + 1 || in->offsets[0] != 0 ||
+                in->offsets[in->N] != in->m)
+            {
+                fprintf(stderr, "malformed input: row offsets of %s don't match m=%llu\n", filename,
+                        (unsigned long long)in->m);
+                input_close(in);
+                return -1;
+            }
+            for (int r = 0; r < in->N; r++)
+            {
+                if (in->offsets[r] > in->offsets[r + 1])
+                {
+                    fprintf(stderr, "malformed input: row offsets of %s decrease at row %d\n", filename, r);
+                    input_close(in);
+                    return -1;
+                }
+            }
+            in->targets = ftell(in->f);
+        }
+        return 0;
+    }
+
+    // text: N for the dense matrix, N and m for the edge list
+    char line[INPUT_LINE];
+    long long m;
+    rewind(in->f);
+    if (fgets(line, sizeof(line), in->f) == NULL || sscanf(line, "%d", &in->N) != 1 || in->N < 1)
+    {
+        fprintf(stderr, "malformed input: couldn't match number N of vertices\n");
+        input_close(in);
+        return -1;
+    }
+    if (sscanf(line, "%*d %lld", &m) == 1)
+    {
+        in->format = INPUT_EDGES;
+        in->m = m;
+    }
+    return 0;
+}
+
+// the next edges of the CSR, whose targets and weights are stored apart
+static size_t read_csr(struct input *in, struct input_edge *edges, size_t count)
+{
+    uint32_t targets[INPUT_CHUNK_EDGES];
+    double weights[INPUT_CHUNK_EDGES];
+    count = count < INPUT_CHUNK_EDGES ? count : INPUT_CHUNK_EDGES;
+    count = count < in->m - in->read ? count : in->m - in->read;
+    long weights_start = in->targets + in->m * sizeof(uint32_t);
+    if (fseek(in->f, in->targets + in->read * sizeof(uint32_t), SEEK_SET) != 0 ||
+        fread(targets, sizeof(uint32_t), count, in->f) != count ||
+        fseek(in->f, weights_start + in->read * sizeof(double), SEEK_SET) != 0 ||
+        fread(weights, sizeof(double), count, in->f) != count)
+    {
+        return 0;
+    }
+    for (size_t x = 0; x < count; x++)
+    {
+        while (in->offsets[in->row + 1] <= in->read + x)
+        {
+            in->row++;
+        }
+        edges[x].u = in->row;
+        edges[x].v = targets[x];
+        edges[x].w = weights[x];
+    }
+    return count;
+}
+
+// the next edges of the text edge list
+static size_t read_text(struct input *in, struct input_edge *edges, size_t count)
+{
+    char line[INPUT_LINE];
+    size_t n = 0;
+    while (n < count && in->read + n < in->m && fgets(line, sizeof(line), in->f) != NULL)
+    {
+        if (line[strspn(line, " \t\r\n")] == '\0')
+        {
+            continue;
+        }
+        char *end, *start;
+        unsigned long u = strtoul(line, &start, 10);
+        unsigned long v = strtoul(start, &end, 10);
+        if (start == line || end == start)
+        {
+            fprintf(stderr, "malformed input: edge %llu isn't \"u v w\": %s", (unsigned long long)(in->read + n), line);
+            in->error = 1;
+            return 0;
+        }
+        char *weight = end;
+        double w = strtod(weight, &end);
+        if (end == weight && !in->no_weights)
+        {
+            fprintf(stderr, "malformed input: edge %llu has no weight: %s", (unsigned long long)(in->read + n), line);
+            in->error = 1;
+            return 0;
+        }
+        if (end[strspn(end, " \t\r\n")] != '\0')
+        {
+            fprintf(stderr, "malformed input: edge %llu has more than \"u v w\": %s", (unsigned long long)(in->read + n),
+                    line);
+            in->error = 1;
+            return 0;
+        }
+        // out of range as uint32 as well
+        edges[n].u = u < UINT32_MAX ? u : UINT32_MAX;
+        edges[n].v = v < UINT32_MAX ? v : UINT32_MAX;
+        edges[n].w = w;
+        n++;
+    }
+    return n;
+}
+
+size_t input_edges(struct input *in, struct input_edge *edges, size_t count)
+{
+    if (in->error || in->read >= in->m)
+    {
+        return 0;
+    }
+    size_t n;
+    switch (in->format)
+    {
+    case INPUT_CSR:
+        n = read_csr(in, edges, count);
+        break;
+    case INPUT_BINARY_EDGES:
+        // the records of 16 bytes have the layout of struct input_edge
+        count = count < in->m - in->read ? count : in->m - in->read;
+        n = fread(edges, sizeof(struct input_edge), count, in->f);
+        break;
+    case INPUT_EDGES:
+        n = read_text(in, edges, count);
+        break;
+    default:
+        n = 0;
+    }
+
+    for (size_t x = 0; x < n; x++)
+    {
+        if (edges[x].u >= (uint32_t)in->N || edges[x].v >= (uint32_t)in->N)
+        {
+            fprintf(stderr, "malformed input: edge %llu (%u, %u) is out of range for N=%d\n",
+                    (unsigned long long)(in->read + x), edges[x].u, edges[x].v, in->N);
+            in->error = 1;
+            return 0;
+        }
+    }
+    in->read += n;
+    if (n == 0 && !in->error)
+    {
+        fprintf(stderr, "malformed input: only %llu of m=%llu edges\n", (unsigned long long)in->read,
+                (unsigned long long)in->m);
+        in->error = 1;
+    }
+    return n;
+}
+
+void input_close(struct input *in)
+{
+    if (in->f != NULL)
+    {
+        fclose(in->f);
+    }
+    free(in->offsets);
+    in->f = NULL;
+    in->offsets = NULL;
+}
+
+void input_fill(double *C, size_t count, double value)
+{
+    size_t x = 0;
+#ifdef __AVX__
+    if ((size_t)C % 32 == 0)
+    {
+        __m256d v = _mm256_set1_pd(value);
+        for (; x + 16 <= count; x += 16)
+        {
+            _mm256_store_pd(&C[x], v);
+            _mm256_store_pd(&C[x + 4], v);
+            _mm256_store_pd(&C[x + 8], v);
+            _mm256_store_pd(&C[x + 12], v);
+        }
+    }
+#endif
+    for (; x < count; x++)
+    {
+        C[x] = value;
+    }
+}
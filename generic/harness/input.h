@@ -0,0 +1,87 @@
+#ifndef INPUT_HEADER
+#define INPUT_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Input formats of the drivers.
+//
+// The dense text matrix (N, then N lines of N comma separated entries, empty
+// for a missing edge) takes N^2 fields even for a graph with a few edges per
+// vertex. The drivers therefore also read the edges of a graph, which they
+// store into a matrix filled with the entry of "no path", so loading takes
+// N^2 / 4 vector stores and m edges instead of parsing N^2 fields:
+//  edges  text: N and m on the first line, then one edge "u v w" per line,
+//         the weight may be left out for the transitive closure, which
+//         sets no_weights, anything else on the line is an error
+//  FWG1   binary edge list of generator/graph_generator.cpp (--binary)
+//  FWC1   binary CSR (--csr): the magic number, N as uint32, m as uint64,
+//         the N + 1 row offsets as uint64, the m targets as uint32 and the m
+//         weights as double, all little-endian
+// The format is recognized by the magic number or the number of fields of the
+// first line. Vertices are counted from 0.
+
+// magic numbers, "FWG1" and "FWC1" in a little-endian file
+#define INPUT_EDGES_MAGIC 0x31475746u
+#define INPUT_CSR_MAGIC 0x31435746u
+
+// edges read at a time from a binary file
+#define INPUT_CHUNK_EDGES 4096
+
+enum input_format
+{
+    INPUT_DENSE,
+    INPUT_EDGES,
+    INPUT_BINARY_EDGES,
+    INPUT_CSR
+};
+
+struct input_edge
+{
+    uint32_t u, v;
+    double w;
+};
+
+struct input
+{
+    enum input_format format;
+    FILE *f; // the rows of the dense matrix follow the first line
+    int N;
+    uint64_t m, read; // edges, and those read so far
+    int error;        // a malformed edge or a short file
+    int no_weights;   // set by the caller if the weight of a text edge may be left out, it's 0 then
+    // CSR: the row offsets, the row of the next edge and the start of the targets
+    uint64_t *offsets;
+    uint32_t row;
+    long targets;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Opens filename and reads the header, N is in in->N. Returns 0 on success, -1
+ * with a message otherwise.
+ */
+int input_open(const char *filename, struct input *in);
+
+/*
+ * Reads up to count edges of a graph that isn't given as a dense matrix.
+ * Returns the number of edges read, 0 at the end of the file or on an error,
+ * see in->error.
+ */
+size_t input_edges(struct input *in, struct input_edge *edges, size_t count);
+
+void input_close(struct input *in);
+
+/* Sets the count entries of C to value, with vector stores if C is 32 bytes aligned. */
+void input_fill(double *C, size_t count, double value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
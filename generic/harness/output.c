@@ -0,0 +1,278 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "output.h"
+
+// a selected entry of a row
+struct entry
+{
+    int j;
+    double value;
+};
+
+// text of the rows of one thread, grown as needed
+struct text
+{
+    char *data;
+    size_t length, capacity;
+};
+
+struct worker
+{
+    pthread_t thread;
+    int running; // the thread formats the block
+    int r0, r1;  // rows of the current block
+    const void *C;
+    int N;
+    void (*row)(const void *C, int N, int i, double *out);
+    const struct output_order *order;
+    const struct output_options *options;
+    double *values;        // one row
+    struct entry *entries; // selected entries of one row
+    struct text text;
+};
+
+int output_parse(int argc, char **argv, struct output_options *options)
+{
+    options->mode = OUTPUT_DENSE;
+    options->k = 0;
+    options->threshold = 0;
+    int kept = 1;
+    for (int a = 1; a < argc; a++)
+    {
+        char *end = NULL;
+        if (strcmp(argv[a], "--sparse") == 0)
+        {
+            options->mode = OUTPUT_SPARSE;
+        }
+        else if (strcmp(argv[a], "--topk") == 0 && a + 1 < argc)
+        {
+            options->mode = OUTPUT_TOPK;
+            options->k = strtol(argv[++a], &end, 10);
+            if (*end != '\0' || options->k <= 0)
+            {
+                fprintf(stderr, "--topk takes a positive number of entries, not %s\n", argv[a]);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[a], "--threshold") == 0 && a + 1 < argc)
+        {
+            options->mode = OUTPUT_THRESHOLD;
+            options->threshold = strtod(argv[++a], &end);
+            if (*end != '\0' || end == argv[a])
+            {
+                fprintf(stderr, "--threshold takes a number, not %s\n", argv[a]);
+                return -1;
+            }
+        }
+        else if (strncmp(argv[a], "--", 2) == 0)
+        {
+            fprintf(stderr, "unknown or incomplete option %s\n", argv[a]);
+            return -1;
+        }
+        else
+        {
+            argv[kept++] = argv[a];
+        }
+    }
+    argv[kept] = NULL;
+    return kept;
+}
+
+// a is better than b, ties go to the smaller column
+static int better(const struct output_order *order, struct entry a, struct entry b)
+{
+    if (a.value != b.value)
+    {
+        return order->larger_is_better ? a.value > b.value : a.value < b.value;
+    }
+    return a.j < b.j;
+}
+
+// restores the heap of n entries below x, whose root is the worst entry
+static void sift_down(const struct output_order *order, struct entry *heap, int n, int x)
+{
+    for (;;)
+    {
+        int worst = x;
+        for (int child = 2 * x + 1; child <= 2 * x + 2 && child < n; child++)
+        {
+            if (better(order, heap[worst], heap[child]))
+            {
+                worst = child;
+            }
+        }
+        if (worst == x)
+        {
+            return;
+        }
+        struct entry tmp = heap[x];
+        heap[x] = heap[worst];
+        heap[worst] = tmp;
+        x = worst;
+    }
+}
+
+/*
+ * Selects the entries of values to write into entries, in the order they are
+ * written. The top k are kept in a heap with the worst of them at the root, so
+ * a row takes N log k.
+ */
+static int select_row(const struct output_order *order, const struct output_options *options, const double *values,
+                      int N, struct entry *entries)
+{
+    int n = 0;
+    for (int j = 0; j < N; j++)
+    {
+        struct entry e = {j, values[j]};
+        if (e.value == order->none)
+        {
+            continue;
+        }
+        if (options->mode == OUTPUT_THRESHOLD &&
+            (order->larger_is_better ? e.value < options->threshold : e.value > options->threshold))
+        {
+            continue;
+        }
+        if (options->mode != OUTPUT_TOPK)
+        {
+            entries[n++] = e;
+        }
+        else if (n < options->k)
+        {
+            // sift up
+            int x = n++;
+            entries[x] = e;
+            while (x > 0 && better(order, entries[(x - 1) / 2], entries[x]))
+            {
+                struct entry tmp = entries[x];
+                entries[x] = entries[(x - 1) / 2];
+                entries[(x - 1) / 2] = tmp;
+                x = (x - 1) / 2;
+            }
+        }
+        else if (better(order, e, entries[0]))
+        {
+            entries[0] = e;
+            sift_down(order, entries, n, 0);
+        }
+    }
+    if (options->mode == OUTPUT_TOPK)
+    {
+        // heap sort, the worst entry goes last
+        for (int m = n - 1; m > 0; m--)
+        {
+            struct entry tmp = entries[0];
+            entries[0] = entries[m];
+            entries[m] = tmp;
+            sift_down(order, entries, m, 0);
+        }
+    }
+    return n;
+}
+
+static void append(struct text *t, const char *s, size_t length)
+{
+    if (t->length + length > t->capacity)
+    {
+        t->capacity = 2 * (t->length + length);
+        t->data = (char *)realloc(t->data, t->capacity);
+    }
+    memcpy(t->data + t->length, s, length);
+    t->length += length;
+}
+
+static void *format_rows(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    char buf[64];
+    w->text.length = 0;
+    for (int i = w->r0; i < w->r1; i++)
+    {
+        w->row(w->C, w->N, i, w->values);
+        int n = select_row(w->order, w->options, w->values, w->N, w->entries);
+        for (int x = 0; x < n; x++)
+        {
+            int length = w->order->values ? snprintf(buf, sizeof(buf), "%d:%.2f", w->entries[x].j, w->entries[x].value)
+                                          : snprintf(buf, sizeof(buf), "%d", w->entries[x].j);
+            append(&w->text, buf, length);
+            if (x < n - 1)
+            {
+                append(&w->text, ",", 1);
+            }
+        }
+        append(&w->text, "\n", 1);
+    }
+    return NULL;
+}
+
+int output_write(const char *filename, const void *C, int N, void (*row)(const void *C, int N, int i, double *out),
+                 const struct output_order *order, const struct output_options *options)
+{
+    static const char *mode_names[] = {"dense", "sparse", "top-k", "thresholded"};
+    fprintf(stderr, "outputting %s matrix to %s...\n", mode_names[options->mode], filename);
+    FILE *output_f = fopen(filename, "w+");
+    if (output_f == NULL)
+    {
+        fprintf(stderr, "couldn't open %s\n", filename);
+        return -1;
+    }
+    fprintf(output_f, "%d\n", N);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : cpus;
+    int k = options->mode == OUTPUT_TOPK && options->k < N ? options->k : N;
+    struct worker *workers = (struct worker *)calloc(threads, sizeof(struct worker));
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t] = (struct worker){.C = C, .N = N, .row = row, .order = order, .options = options};
+        workers[t].values = (double *)malloc(N * sizeof(double));
+        workers[t].entries = (struct entry *)malloc((k + 1) * sizeof(struct entry));
+    }
+
+    // every thread formats OUTPUT_BLOCK_ROWS rows of a block, which are then written in order
+    int err = 0;
+    for (int r = 0; r < N && err == 0; r += threads * OUTPUT_BLOCK_ROWS)
+    {
+        int started = 0;
+        for (int t = 0; t < threads && r + t * OUTPUT_BLOCK_ROWS < N; t++, started++)
+        {
+            workers[t].r0 = r + t * OUTPUT_BLOCK_ROWS;
+            workers[t].r1 = workers[t].r0 + OUTPUT_BLOCK_ROWS < N ? workers[t].r0 + OUTPUT_BLOCK_ROWS : N;
+            workers[t].running = t > 0 && pthread_create(&workers[t].thread, NULL, format_rows, &workers[t]) == 0;
+            if (t > 0 && !workers[t].running)
+            {
+                format_rows(&workers[t]);
+            }
+        }
+        format_rows(&workers[0]);
+        for (int t = 0; t < started; t++)
+        {
+            if (workers[t].running)
+            {
+                pthread_join(workers[t].thread, NULL);
+            }
+            if (fwrite(workers[t].text.data, 1, workers[t].text.length, output_f) != workers[t].text.length)
+            {
+                err = -1;
+            }
+        }
+    }
+    if (fclose(output_f) != 0 || err != 0)
+    {
+        fprintf(stderr, "couldn't write %s\n", filename);
+        err = -1;
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        free(workers[t].values);
+        free(workers[t].entries);
+        free(workers[t].text.data);
+    }
+    free(workers);
+    return err;
+}
@@ -0,0 +1,57 @@
+#ifndef OUTPUT_HEADER
+#define OUTPUT_HEADER
+
+// Output modes of the drivers.
+//
+// By default a driver writes its result as the dense text matrix: N, then N
+// lines of N comma separated entries. For large N most downstream jobs only
+// need a few entries of every row, so the drivers take an option in front of
+// the file names:
+//  --sparse       the entries that aren't "no path"
+//  --topk K       the K best entries of every row, best first
+//  --threshold T  the entries at least as good as T
+// These write N, then one line per row with the selected entries as j:value,
+// separated by ','. An empty line is a row without entries.
+//
+// The rows are selected and formatted by one thread per cpu, a block of rows
+// at a time, and written in order, so the memory doesn't grow with N.
+
+#define OUTPUT_BLOCK_ROWS 64
+
+enum output_mode
+{
+    OUTPUT_DENSE,
+    OUTPUT_SPARSE,
+    OUTPUT_TOPK,
+    OUTPUT_THRESHOLD
+};
+
+struct output_options
+{
+    enum output_mode mode;
+    int k;            // of --topk
+    double threshold; // of --threshold
+};
+
+// the order of the entries of an algorithm
+struct output_order
+{
+    double none;          // entry of "no path", left out of the sparse modes
+    int larger_is_better; // 0: the smallest entries are the best, e.g. distances
+    int values;           // 0: only the columns are written, e.g. of the transitive closure
+};
+
+/*
+ * Parses the output options of argv, which are removed from it. Returns the
+ * remaining argc, -1 if an option is malformed.
+ */
+int output_parse(int argc, char **argv, struct output_options *options);
+
+/*
+ * Writes the N x N result C to filename as asked for by options. row stores the
+ * entries of row i of C in out. Returns 0 on success.
+ */
+int output_write(const char *filename, const void *C, int N, void (*row)(const void *C, int N, int i, double *out),
+                 const struct output_order *order, const struct output_options *options);
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "pages.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#define PAGES_2M (2UL << 20)
+#define PAGES_1G (1UL << 30)
+
+// ordered from the largest to the smallest pages, the fallback is the next one
+enum
+{
+    KIND_1G,
+    KIND_2M,
+    KIND_THP,
+    KIND_4K,
+    KIND_NUM
+};
+static const char *kind_names[KIND_NUM] = {"1g", "2m", "thp", "4k"};
+
+// every live allocation of pages_alloc, p is NULL for a free slot
+static struct
+{
+    void *p;
+    size_t length; // of the mapping
+    int kind;
+} allocs[PAGES_MAX_ALLOCS];
+
+static size_t round_up(size_t x, size_t m)
+{
+    return (x + m - 1) / m * m;
+}
+
+// -1 if FW_PAGES is set to something unknown
+static int requested_kind(size_t bytes)
+{
+    const char *env = getenv("FW_PAGES");
+    if (env == NULL || env[0] == '\0' || strcmp(env, "auto") == 0)
+    {
+        return bytes >= PAGES_1G ? KIND_1G : KIND_2M;
+    }
+    for (int k = 0; k < KIND_NUM; k++)
+    {
+        if (strcmp(env, kind_names[k]) == 0)
+        {
+            return k;
+        }
+    }
+    return -1;
+}
+
+static int thp_enabled(void)
+{
+    FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (f == NULL)
+    {
+        return 0;
+    }
+    char line[128];
+    int enabled = fgets(line, sizeof(line), f) != NULL && strstr(line, "[never]") == NULL;
+    fclose(f);
+    return enabled;
+}
+
+static void *map(size_t length, int flags)
+{
+    void *p = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+// maps bytes on pages of the given kind, sets *length to the size of the mapping
+static void *map_kind(int kind, size_t bytes, size_t *length)
+{
+    char *p;
+    switch (kind)
+    {
+    case KIND_1G:
+        *length = round_up(bytes, PAGES_1G);
+        return map(*length, MAP_HUGETLB | (30 << MAP_HUGE_SHIFT));
+    case KIND_2M:
+        *length = round_up(bytes, PAGES_2M);
+        return map(*length, MAP_HUGETLB | (21 << MAP_HUGE_SHIFT));
+    case KIND_THP:
+    {
+        if (!thp_enabled())
+        {
+            return NULL;
+        }
+        // map 2 MiB more to align the start to a huge page, then give back the rest
+        *length = round_up(bytes, PAGES_2M);
+        char *m = map(*length + PAGES_2M, 0);
+        if (m == NULL)
+        {
+            return NULL;
+        }
+        p = (char *)round_up((size_t)m, PAGES_2M);
+        if (p > m)
+        {
+            munmap(m, p - m);
+        }
+        if (m + PAGES_2M > p)
+        {
+            munmap(p + *length, m + PAGES_2M - p);
+        }
+        if (madvise(p, *length, MADV_HUGEPAGE) != 0)
+        {
+            munmap(p, *length);
+            return NULL;
+        }
+        return p;
+    }
+    default:
+        *length = round_up(bytes, sysconf(_SC_PAGESIZE));
+        p = map(*length, 0);
+#ifdef MADV_NOHUGEPAGE
+        // with THP set to always, the kernel would use huge pages anyway
+        if (p != NULL)
+        {
+            madvise(p, *length, MADV_NOHUGEPAGE);
+        }
+#endif
+        return p;
+    }
+}
+
+void *pages_alloc(size_t bytes)
+{
+    int slot = 0;
+    while (slot < PAGES_MAX_ALLOCS && allocs[slot].p != NULL)
+    {
+        slot++;
+    }
+    int requested = requested_kind(bytes);
+    if (slot == PAGES_MAX_ALLOCS)
+    {
+        fprintf(stderr, "more than %d matrices on pages, using malloc\n", PAGES_MAX_ALLOCS);
+    }
+    else if (requested < 0)
+    {
+        fprintf(stderr, "unknown FW_PAGES=%s, using malloc\n", getenv("FW_PAGES"));
+    }
+    if (slot == PAGES_MAX_ALLOCS || requested < 0)
+    {
+        return aligned_alloc(32, round_up(bytes > 0 ? bytes : 1, 32));
+    }
+
+    for (int kind = requested; kind < KIND_NUM; kind++)
+    {
+        size_t length;
+        void *p = map_kind(kind, bytes > 0 ? bytes : 1, &length);
+        if (p != NULL)
+        {
+            if (kind != requested && getenv("FW_PAGES") != NULL && getenv("FW_PAGES")[0] != '\0')
+            {
+                fprintf(stderr, "no %s pages available, using %s\n", kind_names[requested], kind_names[kind]);
+            }
+            allocs[slot].p = p;
+            allocs[slot].length = length;
+            allocs[slot].kind = kind;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// slot of p, -1 if p isn't from pages_alloc
+static int find(const void *p)
+{
+    for (int slot = 0; slot < PAGES_MAX_ALLOCS; slot++)
+    {
+        if (p != NULL && allocs[slot].p == p)
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void pages_free(void *p)
+{
+    int slot = find(p);
+    if (slot < 0)
+    {
+        free(p);
+        return;
+    }
+    munmap(p, allocs[slot].length);
+    allocs[slot].p = NULL;
+}
+
+const char *pages_kind(const void *p)
+{
+    int slot = find(p);
+    return slot < 0 ? "malloc" : kind_names[allocs[slot].kind];
+}
+
+size_t pages_huge_bytes(const void *p)
+{
+    int slot = find(p);
+    if (slot < 0)
+    {
+        return 0;
+    }
+    if (allocs[slot].kind == KIND_1G || allocs[slot].kind == KIND_2M)
+    {
+        return allocs[slot].length;
+    }
+
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (f == NULL)
+    {
+        return 0;
+    }
+    // the AnonHugePages of the mapping that contains p, which the kernel may have merged with its neighbours
+    size_t huge = 0;
+    int inside = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        unsigned long start, end;
+        unsigned long kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+        {
+            inside = start <= (unsigned long)p && (unsigned long)p < end;
+        }
+        else if (inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+        {
+            huge = kb * 1024;
+            break;
+        }
+    }
+    fclose(f);
+    return huge < allocs[slot].length ? huge : allocs[slot].length;
+}
@@ -0,0 +1,42 @@
+#ifndef PAGES_HEADER
+#define PAGES_HEADER
+
+#include <stddef.h>
+
+// Matrix allocation on huge pages.
+//
+// For large n, the column accesses of the kernels, e.g. A[(i + u) * N + k] in
+// FWI, touch a different 4 KiB page in every row and thrash the dTLB. The
+// drivers therefore allocate the measured matrix with pages_alloc, which maps
+// it on the largest pages available, as asked for by FW_PAGES:
+//  auto  (default) 1g if the matrix takes at least 1 GiB, 2m otherwise
+//  1g    hugetlbfs pages of 1 GiB
+//  2m    hugetlbfs pages of 2 MiB
+//  thp   transparent huge pages (madvise), 2 MiB aligned
+//  4k    regular pages, with transparent huge pages turned off
+// hugetlbfs pages have to be reserved by the administrator, e.g. in
+// /proc/sys/vm/nr_hugepages. If the requested pages aren't available, the
+// next smaller kind is used: 1g, 2m, thp, 4k.
+
+#define PAGES_MAX_ALLOCS 16
+
+/*
+ * Allocates bytes, aligned to at least 32 bytes and not initialized, on the
+ * pages given by FW_PAGES. Returns NULL if it fails.
+ */
+void *pages_alloc(size_t bytes);
+
+/* Frees memory of pages_alloc. */
+void pages_free(void *p);
+
+/* Kind of pages backing p, see above, or "malloc" if p isn't from pages_alloc. */
+const char *pages_kind(const void *p);
+
+/*
+ * Number of bytes of p that are backed by huge pages right now, read from
+ * /proc/self/smaps for transparent huge pages, which the kernel may split or
+ * not provide at all. 0 if unknown.
+ */
+size_t pages_huge_bytes(const void *p);
+
+#endif
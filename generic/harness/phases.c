@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "counters.h"
+#include "phases.h"
+
+static const char *event_names[COUNTERS_NUM_EVENTS] = COUNTERS_EVENT_NAMES;
+static const char *phase_names[PHASES_NUM] = {"diagonal", "row", "column", "remainder"};
+
+// one tile task or, if i < 0, a whole phase
+struct trace_event
+{
+    int k, phase, i, j;
+    unsigned long long start, end;
+};
+
+static int recording = 0;
+static int tracing = 0;
+
+// state of the current phase
+static int cur_k = 0;
+static int cur_phase = 0;
+static long long phase_values[COUNTERS_NUM_EVENTS];
+static unsigned long long phase_start;
+
+// counters accumulated per phase, and cycles per k-round and phase
+static double totals[PHASES_NUM][COUNTERS_NUM_EVENTS];
+static double *rounds = NULL;
+static int num_rounds = 0;
+
+static struct trace_event *trace = NULL;
+static int trace_len = 0;
+static int trace_dropped = 0;
+static unsigned long long trace_base = 0;
+
+static void trace_add(int i, int j, unsigned long long start, unsigned long long end)
+{
+    if (trace_len == PHASES_MAX_TRACE)
+    {
+        trace_dropped++;
+        return;
+    }
+    struct trace_event *e = &trace[trace_len++];
+    e->k = cur_k;
+    e->phase = cur_phase;
+    e->i = i;
+    e->j = j;
+    e->start = start;
+    e->end = end;
+}
+
+void phases_begin(int k, int phase)
+{
+    if (!recording)
+    {
+        return;
+    }
+    cur_k = k;
+    cur_phase = phase;
+    counters_read(phase_values);
+    phase_start = __rdtsc();
+}
+
+void phases_end(int k, int phase)
+{
+    if (!recording)
+    {
+        return;
+    }
+    unsigned long long end = __rdtsc();
+    long long values[COUNTERS_NUM_EVENTS];
+    counters_read(values);
+
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        totals[phase - 1][e] += (double)(values[e] - phase_values[e]);
+    }
+    if (k >= num_rounds)
+    {
+        int n = k + 1 > 2 * num_rounds ? k + 1 : 2 * num_rounds;
+        rounds = (double *)realloc(rounds, (size_t)n * PHASES_NUM * sizeof(double));
+        memset(&rounds[num_rounds * PHASES_NUM], 0, (size_t)(n - num_rounds) * PHASES_NUM * sizeof(double));
+        num_rounds = n;
+    }
+    rounds[k * PHASES_NUM + phase - 1] += (double)(values[0] - phase_values[0]);
+
+    if (tracing)
+    {
+        trace_add(-1, -1, phase_start, end);
+    }
+}
+
+void phases_tile(unsigned long long start, int i, int j)
+{
+    if (tracing)
+    {
+        trace_add(i, j, start, __rdtsc());
+    }
+}
+
+void phases_reset(void)
+{
+    memset(totals, 0, sizeof(totals));
+    if (rounds != NULL)
+    {
+        memset(rounds, 0, (size_t)num_rounds * PHASES_NUM * sizeof(double));
+    }
+    trace_len = 0;
+    trace_dropped = 0;
+}
+
+void phases_record(int record, int trace_run)
+{
+    recording = record;
+    tracing = record && trace_run;
+    if (tracing && trace == NULL)
+    {
+        trace = (struct trace_event *)malloc(PHASES_MAX_TRACE * sizeof(struct trace_event));
+    }
+    if (tracing)
+    {
+        trace_base = __rdtsc();
+    }
+}
+
+static void write_trace(const char *path, const char *kernel, int N)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+    {
+        fprintf(stderr, "couldn't write phase trace to %s\n", path);
+        return;
+    }
+    // timestamps are given in microseconds, we use thousands of (TSC) cycles instead
+    fprintf(f, "{\"otherData\": {\"kernel\": \"%s\", \"n\": %d, \"unit\": \"1000 cycles\"},\n", kernel, N);
+    fprintf(f, "\"traceEvents\": [\n");
+    for (int t = 0; t < trace_len; t++)
+    {
+        const struct trace_event *e = &trace[t];
+        double ts = (double)(e->start - trace_base) / 1e3;
+        double dur = (double)(e->end - e->start) / 1e3;
+        if (e->i < 0)
+        {
+            fprintf(f, "{\"name\": \"phase %d (%s)\", \"cat\": \"phase\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                       "\"pid\": 0, \"tid\": 0, \"args\": {\"k\": %d}}",
+                    e->phase, phase_names[e->phase - 1], ts, dur, e->k);
+        }
+        else
+        {
+            fprintf(f, "{\"name\": \"%s (%d,%d)\", \"cat\": \"tile\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                       "\"pid\": 0, \"tid\": 0, \"args\": {\"k\": %d, \"phase\": %d, \"i\": %d, \"j\": %d}}",
+                    e->phase == 4 ? "FWIabc" : "FWI", e->i, e->j, ts, dur, e->k, e->phase, e->i, e->j);
+        }
+        fprintf(f, "%s\n", t < trace_len - 1 ? "," : "");
+    }
+    fprintf(f, "]}\n");
+    fclose(f);
+    fprintf(stderr, "wrote %d trace events to %s\n", trace_len, path);
+    if (trace_dropped > 0)
+    {
+        fprintf(stderr, "dropped %d trace events, increase PHASES_MAX_TRACE\n", trace_dropped);
+    }
+}
+
+void phases_report(const char *kernel, int N, int num_runs)
+{
+    double total[COUNTERS_NUM_EVENTS] = {0};
+    for (int p = 0; p < PHASES_NUM; p++)
+    {
+        for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+        {
+            total[e] += totals[p][e];
+        }
+    }
+
+    // per phase
+    fprintf(stderr, "\nphase breakdown of %s for n=%d (%s counters, average of %d runs):\n",
+            kernel, N, counters_backend(), num_runs);
+    fprintf(stderr, "%-12s", "phase");
+    for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+    {
+        if (counters_supported(e))
+        {
+            fprintf(stderr, "%15s", event_names[e]);
+        }
+        if (e == 0)
+        {
+            fprintf(stderr, "%8s", "%");
+        }
+    }
+    fprintf(stderr, "\n");
+    for (int p = 0; p <= PHASES_NUM; p++)
+    {
+        const double *values = p < PHASES_NUM ? totals[p] : total;
+        if (p < PHASES_NUM)
+        {
+            fprintf(stderr, "%d %-10s", p + 1, phase_names[p]);
+        }
+        else
+        {
+            fprintf(stderr, "%-12s", "total");
+        }
+        for (int e = 0; e < COUNTERS_NUM_EVENTS; e++)
+        {
+            if (counters_supported(e))
+            {
+                fprintf(stderr, "%15.0f", values[e] / num_runs);
+            }
+            if (e == 0)
+            {
+                fprintf(stderr, "%7.1f%%", total[0] > 0 ? 100 * values[0] / total[0] : 0);
+            }
+        }
+        fprintf(stderr, "\n");
+    }
+
+    // per k-round
+    fprintf(stderr, "\ncycles per k-round:\n%-8s", "k");
+    for (int p = 0; p < PHASES_NUM; p++)
+    {
+        fprintf(stderr, "%15s", phase_names[p]);
+    }
+    fprintf(stderr, "\n");
+    for (int k = 0; k < num_rounds; k++)
+    {
+        double sum = 0;
+        for (int p = 0; p < PHASES_NUM; p++)
+        {
+            sum += rounds[k * PHASES_NUM + p];
+        }
+        if (sum == 0)
+        {
+            continue;
+        }
+        fprintf(stderr, "%-8d", k);
+        for (int p = 0; p < PHASES_NUM; p++)
+        {
+            fprintf(stderr, "%15.0f", rounds[k * PHASES_NUM + p] / num_runs);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    const char *path = getenv("FW_PHASES_TRACE");
+    if (path != NULL)
+    {
+        write_trace(path, kernel, N);
+    }
+}
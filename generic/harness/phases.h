@@ -0,0 +1,68 @@
+#ifndef PHASES_HEADER
+#define PHASES_HEADER
+
+// Per-phase instrumentation of the tiled FW algorithm (FWT).
+//
+// Compile with -DFW_PHASES to enable the hooks, otherwise they expand to the
+// bare calls and cost nothing. While the benchmark harness measures, every
+// phase accumulates the counters of counters.h per k-round, and every tile
+// task is timed with rdtsc for the trace. The phases are numbered as in FWT:
+//  1: diagonal tile A_kk
+//  2: tiles in row k
+//  3: tiles in column k
+//  4: remaining tiles (FWIabc)
+//
+// The breakdown is printed to stderr, the trace of the first measured run is
+// written to FW_PHASES_TRACE in the Chrome trace format (chrome://tracing or
+// https://ui.perfetto.dev).
+
+#define PHASES_NUM 4
+#define PHASES_MAX_TRACE (1 << 20)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Hooks called by FWT. */
+void phases_begin(int k, int phase);
+void phases_end(int k, int phase);
+void phases_tile(unsigned long long start, int i, int j);
+
+/* Called by the harness: clears all accumulated counters. */
+void phases_reset(void);
+
+/* Called by the harness before every measured run, record is 0 outside of runs. */
+void phases_record(int record, int trace);
+
+/* Called by the harness: prints the breakdown per run and writes the trace. */
+void phases_report(const char *kernel, int N, int num_runs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef FW_PHASES
+
+#include <x86intrin.h>
+
+#define PHASES_BEGIN(k, phase) phases_begin(k, phase)
+#define PHASES_END(k, phase) phases_end(k, phase)
+// times the tile task (the call), which updates tile (i,j)
+// variadic, so that the commas of template arguments don't split the call
+#define PHASES_TILE(i, j, ...)                         \
+    {                                                  \
+        unsigned long long phases_start_ = __rdtsc(); \
+        __VA_ARGS__;                                   \
+        phases_tile(phases_start_, i, j);              \
+    }
+
+#else
+
+#define PHASES_BEGIN(k, phase)
+#define PHASES_END(k, phase)
+#define PHASES_TILE(i, j, ...) __VA_ARGS__
+
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+#include <cpuid.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tunedb.h"
+
+#define TUNEDB_HEADER_LINE "algo,family,model,l1d,l2,l3,nbucket,n,L1,Ui,Uj,Ui',Uj',Uk',cycles\n"
+#define TUNEDB_MAX_ENTRIES 1024
+
+struct tunedb_row
+{
+    char algo[8];
+    struct tunedb_cpu cpu;
+    int nbucket, n;
+    struct tunedb_entry e;
+};
+
+static struct tunedb_row rows[TUNEDB_MAX_ENTRIES];
+static int num_rows = -1;
+
+static const char *tunedb_path(void)
+{
+    const char *path = getenv("FW_TUNEDB");
+    return path != NULL ? path : TUNEDB_PATH;
+}
+
+// size in KiB of the cache described by the cpuid leaf 4 / 0x8000001d registers
+static int cache_size(unsigned int ebx, unsigned int ecx)
+{
+    unsigned int ways = (ebx >> 22) + 1;
+    unsigned int partitions = ((ebx >> 12) & 0x3ff) + 1;
+    unsigned int line = (ebx & 0xfff) + 1;
+    unsigned int sets = ecx + 1;
+    return (int)((unsigned long)ways * partitions * line * sets / 1024);
+}
+
+void tunedb_cpu(struct tunedb_cpu *cpu)
+{
+    unsigned int eax, ebx, ecx, edx;
+    memset(cpu, 0, sizeof(*cpu));
+
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+    {
+        return;
+    }
+    // display family and model as in /proc/cpuinfo
+    cpu->family = (eax >> 8) & 0xf;
+    cpu->model = (eax >> 4) & 0xf;
+    if (cpu->family == 0xf)
+    {
+        cpu->family += (eax >> 20) & 0xff;
+    }
+    if (cpu->family == 0x6 || cpu->family >= 0xf)
+    {
+        cpu->model += ((eax >> 16) & 0xf) << 4;
+    }
+
+    // deterministic cache parameters: leaf 4 on Intel, 0x8000001d on AMD
+    unsigned int leaf = 4;
+    if (__get_cpuid_count(leaf, 0, &eax, &ebx, &ecx, &edx) == 0 || (eax & 0x1f) == 0)
+    {
+        leaf = 0x8000001d;
+        if (__get_cpuid_count(leaf, 0, &eax, &ebx, &ecx, &edx) == 0)
+        {
+            return;
+        }
+    }
+    for (unsigned int i = 0;; i++)
+    {
+        __cpuid_count(leaf, i, eax, ebx, ecx, edx);
+        unsigned int type = eax & 0x1f; // 1: data, 2: instruction, 3: unified
+        unsigned int level = (eax >> 5) & 0x7;
+        if (type == 0)
+        {
+            break;
+        }
+        if (type == 2)
+        {
+            continue;
+        }
+        int size = cache_size(ebx, ecx);
+        if (level == 1)
+        {
+            cpu->l1d = size;
+        }
+        else if (level == 2)
+        {
+            cpu->l2 = size;
+        }
+        else if (level == 3)
+        {
+            cpu->l3 = size;
+        }
+    }
+}
+
+int tunedb_bucket(int n)
+{
+    int b = 0;
+    while (n > 1)
+    {
+        n >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static int same_cpu(const struct tunedb_cpu *a, const struct tunedb_cpu *b)
+{
+    return a->family == b->family && a->model == b->model && a->l1d == b->l1d && a->l2 == b->l2 && a->l3 == b->l3;
+}
+
+static void load(void)
+{
+    num_rows = 0;
+    FILE *f = fopen(tunedb_path(), "r");
+    if (f == NULL)
+    {
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL && num_rows < TUNEDB_MAX_ENTRIES)
+    {
+        struct tunedb_row *r = &rows[num_rows];
+        int threads;
+        // rows of databases written with a threads column before the cycles, which was always 1
+        if (sscanf(line, "%7[^,],%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%lf",
+                   r->algo, &r->cpu.family, &r->cpu.model, &r->cpu.l1d, &r->cpu.l2, &r->cpu.l3,
+                   &r->nbucket, &r->n, &r->e.L1, &r->e.ui, &r->e.uj, &r->e.uii, &r->e.ujj, &r->e.ukk,
+                   &threads, &r->e.cycles) == 16 ||
+            sscanf(line, "%7[^,],%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%lf",
+                   r->algo, &r->cpu.family, &r->cpu.model, &r->cpu.l1d, &r->cpu.l2, &r->cpu.l3,
+                   &r->nbucket, &r->n, &r->e.L1, &r->e.ui, &r->e.uj, &r->e.uii, &r->e.ujj, &r->e.ukk,
+                   &r->e.cycles) == 15)
+        {
+            num_rows++;
+        }
+    }
+    fclose(f);
+}
+
+// read the database once when the program starts
+__attribute__((constructor)) static void tunedb_init(void)
+{
+    load();
+}
+
+int tunedb_lookup(const char *algo, int n, struct tunedb_entry *e)
+{
+    struct tunedb_cpu cpu;
+    tunedb_cpu(&cpu);
+    int bucket = tunedb_bucket(n);
+
+    // nearest bucket first, then the entry tuned for the closest n
+    const struct tunedb_row *best = NULL;
+    for (int i = 0; i < num_rows; i++)
+    {
+        const struct tunedb_row *r = &rows[i];
+        if (strcmp(r->algo, algo) != 0 || !same_cpu(&r->cpu, &cpu))
+        {
+            continue;
+        }
+        if (best == NULL || abs(r->nbucket - bucket) < abs(best->nbucket - bucket) ||
+            (abs(r->nbucket - bucket) == abs(best->nbucket - bucket) && abs(r->n - n) < abs(best->n - n)))
+        {
+            best = r;
+        }
+    }
+    if (best == NULL)
+    {
+        return -1;
+    }
+    *e = best->e;
+    return 0;
+}
+
+int tunedb_store(const char *algo, int n, const struct tunedb_entry *e)
+{
+    struct tunedb_row row;
+    snprintf(row.algo, sizeof(row.algo), "%s", algo);
+    tunedb_cpu(&row.cpu);
+    row.nbucket = tunedb_bucket(n);
+    row.n = n;
+    row.e = *e;
+
+    // merge with the current content of the file, which may have changed since startup
+    load();
+    int i;
+    for (i = 0; i < num_rows; i++)
+    {
+        if (strcmp(rows[i].algo, algo) == 0 && same_cpu(&rows[i].cpu, &row.cpu) && rows[i].n == n)
+        {
+            break;
+        }
+    }
+    if (i == TUNEDB_MAX_ENTRIES)
+    {
+        fprintf(stderr, "tuning database %s is full\n", tunedb_path());
+        return -1;
+    }
+    rows[i] = row;
+    num_rows = i == num_rows ? num_rows + 1 : num_rows;
+
+    FILE *f = fopen(tunedb_path(), "w");
+    if (f == NULL)
+    {
+        fprintf(stderr, "couldn't write tuning database %s\n", tunedb_path());
+        return -1;
+    }
+    fprintf(f, TUNEDB_HEADER_LINE);
+    for (i = 0; i < num_rows; i++)
+    {
+        const struct tunedb_row *r = &rows[i];
+        fprintf(f, "%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.0f\n",
+                r->algo, r->cpu.family, r->cpu.model, r->cpu.l1d, r->cpu.l2, r->cpu.l3,
+                r->nbucket, r->n, r->e.L1, r->e.ui, r->e.uj, r->e.uii, r->e.ujj, r->e.ukk, r->e.cycles);
+    }
+    fclose(f);
+    return 0;
+}
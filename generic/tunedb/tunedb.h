@@ -0,0 +1,57 @@
+#ifndef TUNEDB_HEADER
+#define TUNEDB_HEADER
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Tuning database: the parameters found by the autotuners, keyed by algorithm,
+// processor (CPUID family/model and cache sizes) and n-bucket.
+//
+// The database is a csv file with the header
+//   algo,family,model,l1d,l2,l3,nbucket,n,L1,Ui,Uj,Ui',Uj',Uk',cycles
+// where the cache sizes are in KiB and nbucket is floor(log2(n)). Its path is
+// taken from the FW_TUNEDB environment variable and defaults to TUNEDB_PATH.
+
+#ifndef TUNEDB_PATH
+#define TUNEDB_PATH "tuned-parameters.csv"
+#endif
+
+struct tunedb_cpu
+{
+    int family, model;
+    int l1d, l2, l3; // KiB
+};
+
+struct tunedb_entry
+{
+    int L1, ui, uj, uii, ujj, ukk;
+    double cycles;
+};
+
+/* Fills in the key of the processor the program runs on. */
+void tunedb_cpu(struct tunedb_cpu *cpu);
+
+/* floor(log2(n)), inputs of similar size share their tuned parameters. */
+int tunedb_bucket(int n);
+
+/*
+ * Looks up the parameters for algo ("fw", "mm" or "tc") and an n x n input on
+ * this processor. Entries of the same bucket are preferred, otherwise the entry
+ * of the nearest bucket is returned. Returns 0 on success and -1 if the
+ * database holds no entry for algo on this processor.
+ */
+int tunedb_lookup(const char *algo, int n, struct tunedb_entry *e);
+
+/*
+ * Stores e for algo and n on this processor, replacing an earlier entry for
+ * the same key. Returns 0 on success.
+ */
+int tunedb_store(const char *algo, int n, const struct tunedb_entry *e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,10 +1,27 @@
 #ifndef FW_HEADER
 #define FW_HEADER
 
+#include <stddef.h>
+
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 
 /* Computes the paths that maximize the minimum edge weight and stores their lengths in C. N is the number of nodes.*/
 int floydWarshall(double *C, int N);
 
+/* Runs floydWarshall with threads threads, one per cpu if threads <= 0, pinned to the NUMA nodes their tiles are placed on.
+   The floydWarshall of impl/template-tiles.cpp uses FW_THREADS threads, 1 if it isn't set. Only impl/template-tiles.cpp provides it.*/
+int floydWarshallParallel(double *C, int N, int threads);
+
+/* Symmetric mode for undirected graphs: S holds only the upper triangular tiles of the N x N matrix, symmetricSize(N)
+   entries or about half of them, with the entry (i, j) at S[symmetricIndex(N, i, j)]. floydWarshallSymmetric computes
+   the same closure as floydWarshall, with about half the work. Only impl/template-tiles.cpp provides them.*/
+size_t symmetricSize(int N);
+size_t symmetricIndex(int N, int i, int j);
+int floydWarshallSymmetric(double *S, int N);
+
+/* Runs floydWarshall on the count N x N matrices C[0], ..., C[count - 1] of a batch of small graphs, interleaving
+   them across the vector lanes. Uses threads threads, all cores if threads <= 0. Only impl/template-tiles.cpp provides it.*/
+int floydWarshallBatch(double *const *C, int N, int count, int threads);
+
 #endif
\ No newline at end of file
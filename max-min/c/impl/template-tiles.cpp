@@ -0,0 +1,32 @@
+#include "../../../generic/cpp/variants.hpp"
+
+extern "C"
+{
+#include "mm.h"
+}
+
+// register type: AVX2 vectors when compiled with -march=native, scalars otherwise
+#ifdef __AVX2__
+typedef __m256d REG;
+#else
+typedef double REG;
+#endif
+
+// parameters the prebuilt table is instantiated for
+struct grid
+{
+    static constexpr int L1[] = {32, 64, 96, 128, 192};
+    static constexpr int Ui[] = {2, 4, 8};
+    static constexpr int Uj[] = {4, 8, 16};
+    static constexpr int Uii[] = {2, 4};
+    static constexpr int Ujj[] = {4, 8, 16};
+    static constexpr int Ukk[] = {1, 2, 4, 8};
+};
+
+// same parameters as vector-tiles.c, used if the tuning database has no entry for N
+static const fw::params defaults = {32, 4, 4, 4, 4, 2};
+
+#define SEMIRING fw::MaxMin
+#define ALGO "mm"
+#define TILES_SYMMETRIC
+#include "../../../generic/cpp/template-tiles.hpp"
@@ -1,5 +1,7 @@
 #include <immintrin.h>
 
+#include "../../../generic/harness/phases.h"
+#include "../../../generic/tunedb/tunedb.h"
 #include "mm.h"
 
 #define SUBM(X, u, v, BL, B) (((X) + (u) * (BL) * (B) * (BL) + (v) * (BL)))
@@ -123,29 +125,36 @@ int FWT(double *A, double *B, double *C, int N, int L1)
     {
         // phase 1: update all diagonal tiles
         // FWI(A_kk, B_kk, C_kk, L1)
-        FWI(SUBM(A, k, k, L1, M), SUBM(B, k, k, L1, M), SUBM(C, k, k, L1, M), N, L1);
+        PHASES_BEGIN(k, 1);
+        PHASES_TILE(k, k, FWI(SUBM(A, k, k, L1, M), SUBM(B, k, k, L1, M), SUBM(C, k, k, L1, M), N, L1));
+        PHASES_END(k, 1);
 
         // phase 2: update all tiles in row k
+        PHASES_BEGIN(k, 2);
         for (int j = 0; j < M; j++)
         {
             if (j != k)
             {
                 // FWI(A_kk,B_kj,C_kj, L1)
-                FWI(SUBM(A, k, k, L1, M), SUBM(B, k, j, L1, M), SUBM(C, k, j, L1, M), N, L1);
+                PHASES_TILE(k, j, FWI(SUBM(A, k, k, L1, M), SUBM(B, k, j, L1, M), SUBM(C, k, j, L1, M), N, L1));
             }
         }
+        PHASES_END(k, 2);
 
         // phase 3: update all tiles in column k
+        PHASES_BEGIN(k, 3);
         for (int i = 0; i < M; i++)
         {
             if (i != k)
             {
                 // FWI(A_ik, B_kk, C_ik, L1)
-                FWI(SUBM(A, i, k, L1, M), SUBM(B, k, k, L1, M), SUBM(C, i, k, L1, M), N, L1);
+                PHASES_TILE(i, k, FWI(SUBM(A, i, k, L1, M), SUBM(B, k, k, L1, M), SUBM(C, i, k, L1, M), N, L1));
             }
         }
+        PHASES_END(k, 3);
 
         // phase 4: update all remaining tiles
+        PHASES_BEGIN(k, 4);
         for (int i = 0; i < M; i++)
         {
             if (i != k)
@@ -155,11 +164,12 @@ int FWT(double *A, double *B, double *C, int N, int L1)
                     if (j != k)
                     {
                         // FWIabc(A_ik,B_kj,C_ij, L1)
-                        FWIabc(SUBM(A, i, k, L1, M), SUBM(B, k, j, L1, M), SUBM(C, i, j, L1, M), N, L1);
+                        PHASES_TILE(i, j, FWIabc(SUBM(A, i, k, L1, M), SUBM(B, k, j, L1, M), SUBM(C, i, j, L1, M), N, L1));
                     }
                 }
             }
         }
+        PHASES_END(k, 4);
     }
     return 0;
 }
@@ -187,6 +197,13 @@ function FWT(A, B, C, N, L1)
 */
 int floydWarshall(double *C, int N)
 {
-    // tile size is set to 8
-    return FWT(C, C, C, N, 32);
+    // tile size is set to 32, unless the tuning database has one for N that
+    // divides N and is a multiple of the unrolling factors
+    int L1 = 32;
+    struct tunedb_entry e;
+    if (tunedb_lookup("mm", N, &e) == 0 && e.L1 % 4 == 0 && N % e.L1 == 0)
+    {
+        L1 = e.L1;
+    }
+    return FWT(C, C, C, N, L1);
 }
\ No newline at end of file
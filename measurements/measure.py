@@ -1,8 +1,10 @@
 import argparse
 import csv
+import json
 import os
 import re
 import subprocess
+import tempfile
 
 parser = argparse.ArgumentParser()
 parser.add_argument("-b", "--binary", help="binary to run", type=str, required=True)
@@ -19,6 +21,12 @@ parser.add_argument(
     type=str,
     required=True,
 )
+parser.add_argument(
+    "--output-dir",
+    help="directory for the output matrices, defaults to the testcase directory",
+    type=str,
+    default=None,
+)
 parser.add_argument(
     "-tb",
     "--allow-turbo-boost",
@@ -39,7 +47,8 @@ def main(
     testcases_raw,
     out_filepath,
     turbo_boost_allowed,
-    incremental
+    incremental,
+    output_dir=None,
 ):
     if not turbo_boost_allowed:
         with open("/sys/devices/system/cpu/intel_pstate/no_turbo", "r") as f:
@@ -57,6 +66,11 @@ def main(
     l3_list = list()
     l2_list = list()
     l1_list = list()
+    # distribution of the cycles per run, as reported by the benchmark harness
+    median_list = list()
+    p95_list = list()
+    stddev_list = list()
+    min_list = list()
 
     if incremental:
         if os.path.exists(f"{out_filepath}.csv"):
@@ -69,6 +83,13 @@ def main(
                 l3_list = list(map(int, next(reader)))
                 l2_list = list(map(int, next(reader)))
                 l1_list = list(map(int, next(reader)))
+                rows = list(reader)
+                if len(rows) == 4:
+                    median_list, p95_list, stddev_list, min_list = (list(map(int, row)) for row in rows)
+                else:
+                    # measured before the harness reported distributions, only the mean is known
+                    median_list, p95_list, stddev_list, min_list = (
+                        list(cycles_list), list(cycles_list), [0] * len(cycles_list), list(cycles_list))
         print(f"\nexisting measurements found for n = {nodes_list}\n")
 
     tcs = os.listdir(testsuite_dir)
@@ -113,14 +134,26 @@ def main(
         args = (
             binary,
             os.path.join(testcase_dir, input_file),
-            os.path.join(testcase_dir, output_file),
+            os.path.join(output_dir or testcase_dir, output_file),
         )
         #print(args)
+        stats_fd, stats_path = tempfile.mkstemp(suffix=".json")
+        os.close(stats_fd)
         popen = subprocess.Popen(
-            args, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL
+            args,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            env=dict(os.environ, FW_STATS_JSON=stats_path),
         )
         popen.wait()
         lines = popen.stdout.read().decode("utf-8").split("\n")
+        try:
+            with open(stats_path, "r") as f:
+                stats = json.load(f)["events"]["cycles"]
+        except (OSError, ValueError, KeyError):
+            # binary doesn't use the harness, fall back to the mean
+            stats = None
+        os.remove(stats_path)
         if len(lines) != 5:
             # numbe of runs/number of cycles/newline
             print("=== OUTPUT ===")
@@ -137,6 +170,8 @@ def main(
         l3_misses = int(lines[2].strip())
         l2_misses = int(lines[3].strip())
         l1_misses = int(lines[4].strip())
+        if stats is None:
+            stats = {"median": cycles, "p95": cycles, "stddev": 0, "min": cycles}
 
         print("\tNumber of nodes: {}".format(nodes))
         print("\tNumber of runs: {}".format(runs))
@@ -144,6 +179,8 @@ def main(
         print("\tNumber of l3 cache misses: {}".format(l3_misses))
         print("\tNumber of l2 cache misses: {}".format(l2_misses))
         print("\tNumber of l1-d cache misses: {}".format(l1_misses))
+        print("\tCycles median/p95/stddev/min: {:.0f}/{:.0f}/{:.0f}/{:.0f}".format(
+            stats["median"], stats["p95"], stats["stddev"], stats["min"]))
 
         nodes_list.append(nodes)
         runs_list.append(runs)
@@ -151,17 +188,23 @@ def main(
         l3_list.append(l3_misses)
         l2_list.append(l2_misses)
         l1_list.append(l1_misses)
+        median_list.append(round(stats["median"]))
+        p95_list.append(round(stats["p95"]))
+        stddev_list.append(round(stats["stddev"]))
+        min_list.append(round(stats["min"]))
 
         # sort by nodes ascending
-        nodes_list_sorted, runs_list_sorted, cycles_list_sorted, l3_list_sorted, l2_list_sorted, l1_list_sorted = zip(
-            *sorted(zip(nodes_list, runs_list, cycles_list, l3_list, l2_list, l1_list))
+        rows_sorted = zip(
+            *sorted(zip(nodes_list, runs_list, cycles_list, l3_list, l2_list, l1_list,
+                        median_list, p95_list, stddev_list, min_list))
         )
 
         binary_name = os.path.basename(binary)
         testsuite_name = os.path.basename(testsuite_dir)
         with open("{}.csv".format(out_filepath), "w") as f:
             writer = csv.writer(f)
-            writer.writerows([nodes_list_sorted, runs_list_sorted, cycles_list_sorted, l3_list_sorted, l2_list_sorted, l1_list_sorted])
+            # rows: n, runs, mean cycles, l3, l2, l1, then median, p95, stddev and min cycles
+            writer.writerows(rows_sorted)
 
 
 if __name__ == "__main__":
@@ -172,5 +215,6 @@ if __name__ == "__main__":
         args.testcases,
         args.output,
         args.allow_turbo_boost,
-        args.incremental
+        args.incremental,
+        args.output_dir,
     )
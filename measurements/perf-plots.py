@@ -101,6 +101,16 @@ parser.add_argument(
     action="store_true",
 )
 parser.add_argument("-o", "--output", help="output file name", type=str, required=True)
+parser.add_argument(
+    "-s",
+    "--stat",
+    help="statistic of the cycles per run to plot, see measurements/measure.py",
+    choices=["mean", "median", "p95", "min"],
+    default="mean",
+)
+
+# row of the cycles statistic in the csv files written by measure.py
+STAT_ROWS = {"mean": 2, "median": 6, "p95": 7, "min": 9}
 
 
 def main(
@@ -112,6 +122,7 @@ def main(
     peak_simd,
     bit_packed,
     output_file,
+    stat="mean",
 ):
     mpl.rcParams["axes.prop_cycle"] = mpl.cycler(
         color=COLOR_LIST
@@ -170,9 +181,14 @@ def main(
         # read cycles
         with open(data_file_path) as f:
             reader = csv.reader(f, delimiter=",", quoting=csv.QUOTE_NONNUMERIC)
-            n_list = reader.__next__()
-            runs_list = reader.__next__()
-            cycles_list = reader.__next__()
+            rows = list(reader)
+            n_list = rows[0]
+            runs_list = rows[1]
+            if len(rows) > STAT_ROWS[stat]:
+                cycles_list = rows[STAT_ROWS[stat]]
+            else:
+                logging.warning(f"{data_file_path} has no {stat} cycles, plotting the mean")
+                cycles_list = rows[STAT_ROWS["mean"]]
 
         # compute performance (flops = 2 * n^3)
         perf_list = list()
@@ -231,4 +247,5 @@ if __name__ == "__main__":
         args.simd_peak,
         args.bit_packed,
         args.output,
+        args.stat,
     )
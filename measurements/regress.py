@@ -0,0 +1,342 @@
+import argparse
+import csv
+import datetime
+import json
+import math
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+ROOT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+parser = argparse.ArgumentParser(
+    description="run the fixed benchmark matrix and compare the cycles per run against stored baselines"
+)
+parser.add_argument(
+    "-m",
+    "--matrix",
+    help="csv file with the entries to measure",
+    type=str,
+    default=os.path.join(ROOT_DIR, "measurements", "regress", "matrix.csv"),
+)
+parser.add_argument(
+    "-d",
+    "--baselines",
+    help="directory of the baselines, one subdirectory per machine",
+    type=str,
+    default=os.path.join(ROOT_DIR, "measurements", "regress", "baselines"),
+)
+parser.add_argument(
+    "--machine",
+    help="name of the baseline subdirectory, defaults to the cpu model",
+    type=str,
+    default=None,
+)
+parser.add_argument(
+    "-u",
+    "--update",
+    help="store the measurements as the new baselines instead of comparing",
+    action="store_true",
+)
+parser.add_argument(
+    "--no-build",
+    help="use the binaries in build/ as they are instead of building them with team7.sh",
+    action="store_true",
+)
+parser.add_argument(
+    "-f",
+    "--filter",
+    help="only run the entries whose name matches this regex",
+    type=str,
+    default="",
+)
+parser.add_argument(
+    "-r",
+    "--repeats",
+    help="number of processes per entry, the tests compare processes",
+    type=int,
+    default=7,
+)
+parser.add_argument(
+    "--test",
+    help="statistical test of a slowdown",
+    choices=["mannwhitney", "bootstrap"],
+    default="mannwhitney",
+)
+parser.add_argument(
+    "--threshold",
+    help="relative slowdown of the median that fails the suite",
+    type=float,
+    default=0.05,
+)
+parser.add_argument(
+    "--alpha",
+    help="significance level of the test",
+    type=float,
+    default=0.01,
+)
+parser.add_argument(
+    "-tb",
+    "--allow-turbo-boost",
+    help="allow to run the measurements with turbo boost",
+    action="store_true",
+)
+
+# runs kept per process, the harness measures up to 2^14
+MAX_SAMPLES = 500
+# resamples of the bootstrap
+BOOTSTRAP_RESAMPLES = 2000
+# largest number of processes per side for which the exact distribution of U is used
+EXACT_MAX = 25
+
+
+def machine_name():
+    try:
+        with open("/proc/cpuinfo", "r") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    model = line.split(":", 1)[1].strip()
+                    return re.sub(r"[^A-Za-z0-9]+", "-", model).strip("-").lower()
+    except OSError:
+        pass
+    return "unknown"
+
+
+def read_matrix(path):
+    with open(path, "r") as f:
+        rows = [line for line in f if line.strip() and not line.startswith("#")]
+    entries = list(csv.DictReader(rows))
+    for e in entries:
+        opts = e["optimizations"].replace(" ", "_")
+        e["binary"] = f"{e['algorithm']}_{e['implementation']}_{e['compiler']}_{opts}"
+        e["name"] = f"{e['binary']}_{e['input_category']}_{e['testcase']}"
+    return entries
+
+
+def build(entry):
+    args = (
+        os.path.join(ROOT_DIR, "team7.sh"),
+        "build",
+        entry["algorithm"],
+        entry["implementation"],
+        entry["compiler"],
+        entry["optimizations"],
+    )
+    return subprocess.run(args, cwd=ROOT_DIR).returncode == 0
+
+
+def thin(samples):
+    """At most MAX_SAMPLES of samples, chosen deterministically."""
+    if len(samples) <= MAX_SAMPLES:
+        return sorted(samples)
+    return sorted(random.Random(0).sample(samples, MAX_SAMPLES))
+
+
+def measure(entry, repeats):
+    """Returns the cycles of the runs of every process, None if the binary failed."""
+    testcase_dir = os.path.join(ROOT_DIR, "testcases", entry["input_category"], entry["testcase"])
+    inputs = [f for f in os.listdir(testcase_dir) if f.endswith(".in.txt")]
+    if len(inputs) != 1:
+        raise Exception(f"expected exactly one input file in {testcase_dir}")
+
+    processes = []
+    with tempfile.TemporaryDirectory() as tmp:
+        stats_path = os.path.join(tmp, "stats.json")
+        for _ in range(repeats):
+            args = (
+                os.path.join(ROOT_DIR, "build", entry["binary"]),
+                os.path.join(testcase_dir, inputs[0]),
+                os.path.join(tmp, "out.txt"),
+            )
+            popen = subprocess.run(
+                args,
+                stdout=subprocess.DEVNULL,
+                stderr=subprocess.DEVNULL,
+                env=dict(os.environ, FW_STATS_JSON=stats_path),
+            )
+            if popen.returncode != 0:
+                return None
+            with open(stats_path, "r") as f:
+                processes.append(thin(json.load(f)["events"]["cycles"]["samples"]))
+    return processes
+
+
+def median(xs):
+    xs = sorted(xs)
+    n = len(xs)
+    return xs[n // 2] if n % 2 else (xs[n // 2 - 1] + xs[n // 2]) / 2
+
+
+def u_statistic(xs, ys):
+    """Mann-Whitney U of xs, counting ties as one half, and the tie correction term."""
+    pooled = sorted([(x, 0) for x in xs] + [(y, 1) for y in ys])
+    n = len(pooled)
+    rank_sum = 0.0
+    ties = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j < n and pooled[j][0] == pooled[i][0]:
+            j += 1
+        # average of the ranks i + 1 to j
+        rank_sum += (i + 1 + j) / 2 * sum(1 for _, g in pooled[i:j] if g == 0)
+        ties += (j - i) ** 3 - (j - i)
+        i = j
+    return rank_sum - len(xs) * (len(xs) + 1) / 2, ties
+
+
+def u_counts(m, n):
+    """Number of orderings of m and n distinct values that give each U from 0 to m n."""
+    # counts[j][u] for m' values and j values, built up for m' = 0 .. m
+    counts = [[1] + [0] * (m * n) for _ in range(n + 1)]
+    for _ in range(m):
+        # the largest of the m' values is beaten by all j values or the largest of them is
+        # larger, U(m', j) = U(m' - 1, j) + j or U(m', j - 1)
+        nxt = [[0] * (m * n + 1) for _ in range(n + 1)]
+        for j in range(n + 1):
+            for u in range(m * n + 1):
+                c = counts[j][u - j] if u >= j else 0
+                if j > 0:
+                    c += nxt[j - 1][u]
+                nxt[j][u] = c
+        counts = nxt
+    return counts[n]
+
+
+def mann_whitney(new, base):
+    """One-sided p-value of the Mann-Whitney U test that new is stochastically larger than base."""
+    m, n = len(new), len(base)
+    u, ties = u_statistic(new, base)
+    if ties == 0 and m <= EXACT_MAX and n <= EXACT_MAX:
+        counts = u_counts(m, n)
+        return sum(counts[math.ceil(u):]) / sum(counts)
+    var = m * n / 12 * ((m + n + 1) - ties / ((m + n) * (m + n - 1)))
+    if var <= 0:
+        return 1.0
+    # normal approximation with continuity correction
+    z = (u - m * n / 2 - 0.5) / math.sqrt(var)
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def resample(rng, processes):
+    """Median of a two-level bootstrap sample: processes, then runs within them."""
+    runs = []
+    for p in rng.choices(processes, k=len(processes)):
+        runs += rng.choices(p, k=len(p))
+    return median(runs)
+
+
+def bootstrap(new, base, alpha):
+    """One-sided p-value that the median of new is not larger than that of base, and the
+    lower bound of the 1 - alpha confidence interval of the ratio of the medians."""
+    rng = random.Random(0)
+    ratios = sorted(resample(rng, new) / resample(rng, base) for _ in range(BOOTSTRAP_RESAMPLES))
+    p = sum(1 for r in ratios if r <= 1) / len(ratios)
+    return p, ratios[int(alpha * len(ratios))]
+
+
+def compare(new, base, args):
+    """Returns the ratio of the medians, the p-value and the verdict. new and base hold the runs of every process."""
+    new_medians = [median(p) for p in new]
+    base_medians = [median(p) for p in base]
+    ratio = median(new_medians) / median(base_medians)
+    if args.test == "mannwhitney":
+        p = mann_whitney(new_medians, base_medians)
+        slower = p < args.alpha and ratio > 1 + args.threshold
+        faster = mann_whitney(base_medians, new_medians) < args.alpha and ratio < 1 - args.threshold
+    else:
+        p, lower = bootstrap(new, base, args.alpha)
+        slower = lower > 1 + args.threshold
+        # the confidence interval of base / new bounds new / base from above
+        _, lower = bootstrap(base, new, args.alpha)
+        faster = 1 / lower < 1 - args.threshold
+    return ratio, p, "SLOWER" if slower else "faster" if faster else "ok"
+
+
+def git_commit():
+    try:
+        return subprocess.run(
+            ("git", "rev-parse", "--short", "HEAD"), cwd=ROOT_DIR, capture_output=True, text=True
+        ).stdout.strip()
+    except OSError:
+        return ""
+
+
+def main(args):
+    if not args.allow_turbo_boost:
+        with open("/sys/devices/system/cpu/intel_pstate/no_turbo", "r") as f:
+            if f.readline().strip() == "0":
+                raise Exception("disable the turbo boost")
+
+    entries = [e for e in read_matrix(args.matrix) if re.search(args.filter, e["name"])]
+    baseline_dir = os.path.join(args.baselines, args.machine or machine_name())
+    os.makedirs(baseline_dir, exist_ok=True)
+
+    failed = []
+    results = []
+    built = set()
+    for e in entries:
+        print(f"==== {e['name']}")
+        if not args.no_build and e["binary"] not in built:
+            if not build(e):
+                print("build failed")
+                failed.append(e["name"])
+                continue
+            built.add(e["binary"])
+
+        processes = measure(e, args.repeats)
+        if processes is None:
+            print("binary failed")
+            failed.append(e["name"])
+            continue
+        medians = [median(p) for p in processes]
+        print(f"{len(processes)} processes, median cycles per run {' '.join(f'{m:.0f}' for m in medians)}")
+
+        path = os.path.join(baseline_dir, f"{e['name']}.json")
+        if args.update:
+            with open(path, "w") as f:
+                json.dump(
+                    {
+                        "entry": e["name"],
+                        "commit": git_commit(),
+                        "date": datetime.date.today().isoformat(),
+                        "processes": processes,
+                    },
+                    f,
+                )
+            print(f"stored baseline {path}")
+            continue
+
+        if not os.path.exists(path):
+            print(f"no baseline {path}, store one with --update")
+            results.append((e["name"], None, None, "no baseline"))
+            continue
+        with open(path, "r") as f:
+            baseline = json.load(f)
+        ratio, p, verdict = compare(processes, baseline["processes"], args)
+        print(f"median {100 * (ratio - 1):+.1f}% against {baseline['commit']} ({baseline['date']}), p = {p:.2g}")
+        results.append((e["name"], ratio, p, verdict))
+        if verdict == "SLOWER":
+            failed.append(e["name"])
+
+    if not args.update:
+        print(f"\n{'entry':<80} {'median':>8} {'p':>8}  verdict ({args.test}, alpha {args.alpha}, threshold {100 * args.threshold:.0f}%)")
+        for name, ratio, p, verdict in results:
+            if ratio is None:
+                print(f"{name:<80} {'':>8} {'':>8}  {verdict}")
+            else:
+                print(f"{name:<80} {100 * (ratio - 1):>+7.1f}% {p:>8.2g}  {verdict}")
+
+    if failed:
+        print(f"\n{len(failed)} of {len(entries)} entries failed:")
+        for name in failed:
+            print(f"  {name}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(parser.parse_args()))
@@ -1,64 +1,26 @@
-#include <malloc.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <papi.h>
-#include <immintrin.h>
 
+#include "../../generic/harness/harness.h"
+#include "../../generic/harness/input.h"
+#include "../../generic/harness/output.h"
+#include "../../generic/harness/pages.h"
 #include "impl/sp.h"
 
-#define NUM_RUNS 16
-#define CYCLES_REQUIRED 1e8
-#define FREQUENCY 2.3e9
-#define CALIBRATE
-
-#define ERROR_RETURN(retval)                                                         \
-    {                                                                                \
-        fprintf(stderr, "PAPI error %d %s:line %d: \n", retval, __FILE__, __LINE__); \
-        exit(retval);                                                                \
-    }
-
-// The number of PAPI events we measure
-#define NUM_EVENT 4
-
-// The PAPI events we subscribe to for the measurement
-// Only add events supported on your machine. Check with the papi_avail tool in the PAPI utils
-// IMPORTANT: DO NOT CHANGE ORDER! Otherwise the data readout in the measurement script breaks
-static int event_codes[NUM_EVENT] = {
-    PAPI_TOT_CYC, // Total cycles executed
-    PAPI_L3_TCM,  // L3 cache misses
-    PAPI_L2_TCM,  // L2 data cache misses
-    PAPI_L1_DCM,  // L1 data cache misses
-};
-
-void printMatrix(float *C, int N)
-{
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            fprintf(stderr, "%.2f, ", C[i * N + j]);
-        }
-        fprintf(stderr, "\n");
-    }
-}
-
-/*
-Copies data from one matrix to another.
-Assumes matrices 'from' and 'to' point to separate memory locations.
-*/
-void copyMatrix(float *from, float *to, int N)
-{
-#pragma ivdep
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            to[i * N + j] = from[i * N + j];
-        }
-    }
-}
+#ifdef FW_SYMMETRIC
+// undirected graphs, the input has to be symmetric: only the upper triangular tiles are stored, see floydWarshallSymmetric
+#define ENTRY(C, N, i, j) ((C)[symmetricIndex(N, i, j)])
+#define ENTRIES(N) symmetricSize(N)
+#define FLOYD_WARSHALL floydWarshallSymmetric
+#define FLOYD_WARSHALL_NAME "floydWarshallSymmetric"
+#else
+#define ENTRY(C, N, i, j) ((C)[(i) * (N) + (j)])
+#define ENTRIES(N) ((size_t)(N) * (N))
+#define FLOYD_WARSHALL floydWarshall
+#define FLOYD_WARSHALL_NAME "floydWarshall"
+#endif
 
 /*
  * Runs the FW implementation once for testing purposes
@@ -66,7 +28,7 @@ void copyMatrix(float *from, float *to, int N)
  */
 void ref_output(double *C, int N)
 {
-    int err = floydWarshall(C, N);
+    int err = FLOYD_WARSHALL(C, N);
     if (err != EXIT_SUCCESS)
     {
         printf("implementation reported an error\n");
@@ -74,98 +36,6 @@ void ref_output(double *C, int N)
     }
 }
 
-// fine, I'll do it myself
-void flush_cache(void *addr, int nbytes)
-{
-    // assume cache line of 64 bytes, cause why wouldn't it be
-    void *p = addr;
-    while (p < addr + nbytes)
-    {
-        // Invalidate and flush the cache line that contains p from all levels of the cache hierarchy
-        _mm_clflush(p);
-        p += 64;
-    }
-    // Ensure cache flushes have completed
-    _mm_mfence();
-}
-
-/*
- * Timing function based on the TimeStep Counter of the CPU.
- *
- * We don't particularly care about the input, so we just
- * run FW on the same matrix C for each run even though it
- * modifies it in-place.
- *
- * The function returns the average number of cycles per run.
- */
-int measure(double *C, int N, int WarmupEventSet, int MeasurementEventSet, long long *measured_values)
-{
-    int i, retval;
-    int num_runs = NUM_RUNS;
-
-    // Compute how many runs we need to do and warm up cache
-    long long warmup_cycles[1];
-    /* Start counting */
-    long long cycles = 0;
-    while (num_runs < (1 << 14))
-    {
-        if ((retval = PAPI_start(WarmupEventSet)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-
-        for (i = 0; i < num_runs; ++i)
-        {
-            floydWarshall(C, N);
-        }
-
-        /* Stop counting, this reads from the counter as well as stop it. */
-        if ((retval = PAPI_stop(WarmupEventSet, warmup_cycles)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-
-        cycles += warmup_cycles[0];
-
-        if (cycles >= CYCLES_REQUIRED)
-        {
-            break;
-        }
-
-        num_runs *= 2;
-        if ((retval = PAPI_reset(WarmupEventSet)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-    }
-
-    fprintf(stderr, "#runs: %d\n", num_runs);
-    /*
-     * Alternatives to the current approach:
-     * - Measure #cycles for each run separately
-     *  --> Suffers from timing bias and requires cache warmup
-     *  --> Allows for more fine-grained statistics, e.g. median, variance, etc.
-     */
-    /* Start counting */
-    if ((retval = PAPI_start(MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    for (i = 0; i < num_runs; ++i)
-    {
-        floydWarshall(C, N);
-    }
-
-    /* Stop counting, this reads from the counter as well as stop it. */
-    if ((retval = PAPI_stop(MeasurementEventSet, measured_values)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    return num_runs;
-}
-
 void output_matrix(char *filename, double *C, int N)
 {
     fprintf(stderr, "outputting shortest-path matrix to %s...\n", filename);
@@ -176,7 +46,7 @@ void output_matrix(char *filename, double *C, int N)
     {
         for (int j = 0; j < N; j++)
         {
-            fprintf(output_f, "%.2f", C[i * N + j]);
+            fprintf(output_f, "%.2f", ENTRY(C, N, i, j));
             if (j < N - 1)
             {
                 fputc(',', output_f);
@@ -189,128 +59,125 @@ void output_matrix(char *filename, double *C, int N)
     }
 }
 
-int main(int argc, char **argv)
+// stores the edges of an edge list or CSR input into C, keeping the shortest of parallel edges
+static int read_edges(struct input *input, double *C, int N)
 {
-    if (argc != 3)
+    fprintf(stderr, "reading %llu edges...\n", (unsigned long long)input->m);
+    input_fill(C, ENTRIES(N), INFINITY);
+    struct input_edge edges[INPUT_CHUNK_EDGES];
+    for (size_t n; (n = input_edges(input, edges, INPUT_CHUNK_EDGES)) > 0;)
     {
-        fprintf(stderr, "incorrect number of arguments\n");
-        fprintf(stderr, "call as: ./main input_filename output_filename\n");
-        return -1;
+        for (size_t x = 0; x < n; x++)
+        {
+            ENTRY(C, N, edges[x].u, edges[x].v) = MIN(ENTRY(C, N, edges[x].u, edges[x].v), edges[x].w);
+#ifdef FW_SYMMETRIC
+            // the diagonal tiles store (v, u) apart
+            ENTRY(C, N, edges[x].v, edges[x].u) = MIN(ENTRY(C, N, edges[x].v, edges[x].u), edges[x].w);
+#endif
+        }
     }
+    return input->error ? -1 : 0;
+}
 
-    // setup PAPI
-    int retval;
-    int WarmupEventSet = PAPI_NULL;
-    int MeasurementEventSet = PAPI_NULL;
-    char errstring[PAPI_MAX_STR_LEN];
-    long long measured_values[NUM_EVENT];
-
-    if ((retval = PAPI_library_init(PAPI_VER_CURRENT)) != PAPI_VER_CURRENT)
+// row i of the result for the output modes of output.h
+static void result_row(const void *C, int N, int i, double *out)
+{
+    for (int j = 0; j < N; j++)
     {
-        fprintf(stderr, "Error: %s\n", errstring);
-        return 1;
+        out[j] = ENTRY((const double *)C, N, i, j);
     }
+}
 
-    /* Creating event set   */
-    if ((retval = PAPI_create_eventset(&MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_create_eventset(&WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
+// distances: infinite without a path, the smallest are the best
+static const struct output_order order = {INFINITY, 0, 1};
 
-    // add events to event sets
-    if ((retval = PAPI_add_event(WarmupEventSet, PAPI_TOT_CYC)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
+static int run_floydWarshall(void *C, int N)
+{
+    return FLOYD_WARSHALL((double *)C, N);
+}
 
-    if ((retval = PAPI_add_events(MeasurementEventSet, event_codes, NUM_EVENT)) != PAPI_OK)
+// the kernels the harness can measure, selected with FW_KERNEL
+static const struct harness_kernel kernels[] = {
+    {FLOYD_WARSHALL_NAME, run_floydWarshall, 64},
+};
+
+int main(int argc, char **argv)
+{
+    struct output_options output;
+    argc = output_parse(argc, argv, &output);
+    if (argc != 3)
     {
-        ERROR_RETURN(retval);
+        fprintf(stderr, "incorrect number of arguments\n");
+        fprintf(stderr, "call as: ./main [--sparse | --topk K | --threshold T] input_filename output_filename\n");
+        return -1;
     }
 
     // read input
     char *input_fname = argv[1];
     char *output_fname = argv[2];
 
-    FILE *input_f = fopen(input_fname, "r");
-    int N; // num nodes
-    if (fscanf(input_f, "%d ", &N) < 1)
+    struct input input;
+    if (input_open(input_fname, &input) != 0)
     {
-        fprintf(stderr, "malformed input: couldn't match number N of vertices\n");
         return -1;
     }
+    FILE *input_f = input.f;
+    int N = input.N; // num nodes
 
     fprintf(stderr, "allocating memory...\n");
-    double *C = (double *)aligned_alloc(32, N * N * sizeof(double));
-    fprintf(stderr, "parsing input matrix...\n");
-    for (int i = 0; i < N; i++)
+    double *C = (double *)pages_alloc(ENTRIES(N) * sizeof(double));
+    if (input.format == INPUT_DENSE)
     {
-        char inputValue[100];
-        for (int j = 0; j < N; j++)
+        fprintf(stderr, "parsing input matrix...\n");
+        for (int i = 0; i < N; i++)
         {
-            int numValues = fscanf(input_f, "%[^,\n]s", inputValue);
-            if (numValues == 1)
+            char inputValue[100];
+            for (int j = 0; j < N; j++)
             {
-                C[i * N + j] = strtof(inputValue, NULL);
+                int numValues = fscanf(input_f, "%[^,\n]s", inputValue);
+                double x = numValues == 1 ? strtof(inputValue, NULL) : INFINITY;
+#ifdef FW_SYMMETRIC
+                // (j, i) was read already, an asymmetric input keeps the shorter of both edges in both
+                if (j < i)
+                {
+                    x = MIN(ENTRY(C, N, j, i), x);
+                    ENTRY(C, N, j, i) = x;
+                }
+#endif
+                ENTRY(C, N, i, j) = x;
+                fgetc(input_f); // skip ',' or '\n'
             }
-            else
-            {
-                C[i * N + j] = INFINITY;
-            }
-            fgetc(input_f); // skip ',' or '\n'
         }
     }
-    fclose(input_f);
+    else if (read_edges(&input, C, N) != 0)
+    {
+        return -1;
+    }
+    input_close(&input);
 
     remove(output_fname);
-    double *D = (double *)aligned_alloc(32, N * N * sizeof(double));
-    memcpy(D, C, N * N * sizeof(double));
+    double *D = (double *)aligned_alloc(32, ENTRIES(N) * sizeof(double));
+    memcpy(D, C, ENTRIES(N) * sizeof(double));
     fprintf(stderr, "generating test output...\n");
     ref_output(D, N);
     char ref_output[256];
     sprintf(ref_output, "%s", output_fname);
-    output_matrix(ref_output, D, N);
-    free(D);
-
-    // run measurements
-    fprintf(stderr, "measuring shortest paths for n=%d\n", N);
-    int num_runs = measure(C, N, WarmupEventSet, MeasurementEventSet, measured_values);
-
-    // output measurements
-    printf("%d", num_runs);
-    for (int i = 0; i < NUM_EVENT; i++)
-    {
-        printf("\n%lld", measured_values[i] / num_runs);
-    }
-
-    // clean up
-    free(C);
-
-    /* Free all memory and data structures, EventSet must be empty. */
-    if ((retval = PAPI_cleanup_eventset(WarmupEventSet)) != PAPI_OK)
+    if (output.mode == OUTPUT_DENSE)
     {
-        ERROR_RETURN(retval);
+        output_matrix(ref_output, D, N);
     }
-    if ((retval = PAPI_cleanup_eventset(MeasurementEventSet)) != PAPI_OK)
+    else if (output_write(ref_output, D, N, result_row, &order, &output) != 0)
     {
-        ERROR_RETURN(retval);
+        return -1;
     }
+    free(D);
 
-    if ((retval = PAPI_destroy_eventset(&WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_destroy_eventset(&MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
+    // run measurements
+    fprintf(stderr, "measuring shortest paths for n=%d\n", N);
+    int err = harness_run(kernels, sizeof(kernels) / sizeof(kernels[0]), C, ENTRIES(N) * sizeof(double), N);
 
-    /* free the resources used by PAPI */
-    PAPI_shutdown();
+    // clean up
+    pages_free(C);
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return err == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -14,6 +14,8 @@ BENCHMARK_DIR="${INPUT_CATEGORY_DIR}/bench-inputs"
 MEASUREMENTS_DIR="${ROOT_DIR}/measurements/data"
 PLOTS_DIR="${ROOT_DIR}/measurements/plots"
 GENERIC_DIR="${ROOT_DIR}/generic"
+# comparator used by validate, e.g. the native one built with `build gg c-comparator gcc -O3`
+COMPARATOR="${COMPARATOR:-python3 ${ROOT_DIR}/comparator/compare.py}"
 
 function printUsage() {
     echo "Usage: $0"
@@ -116,7 +118,7 @@ function validate() {
         -a "${ALGORITHM}" \
         -o "out"
 
-    python3 "${ROOT_DIR}/comparator/compare.py" \
+    $COMPARATOR \
         --recursive \
         --silent \
         "${TESTCASES}"
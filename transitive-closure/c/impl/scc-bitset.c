@@ -0,0 +1,417 @@
+#include <immintrin.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tc.h"
+
+/* Transitive closure by reachability instead of Floyd-Warshall, for sparse graphs
+ *
+ * Floyd-Warshall takes N^3 / w operations however few edges there are. Here the
+ * graph is condensed into its strongly connected components (Tarjan), which
+ * come out in reverse topological order: every edge leaving a component points
+ * to one that came out before it. The row of a component is then the OR of the
+ * rows of its successors and their vertices, and the members of a component
+ * with a cycle reach each other. A vertex only reaches itself on a cycle, as in
+ * Floyd-Warshall.
+ *
+ * The successors are ORed in from the last one out, i.e. the topologically
+ * closest, and a successor that is set in the row already is skipped, as
+ * everything it reaches is set as well. Rows are ORed 32 bytes at a time.
+ *
+ * The components of a level (sinks are level 0, every other component is one
+ * above its highest successor) are independent and processed by FW_THREADS
+ * threads, one per cpu if FW_THREADS <= 0 and 1 if it isn't set.
+ *
+ * The adjacency is read from C itself: the row of a component is only
+ * overwritten after its successors have been collected from it.
+ */
+
+// a level is only split between threads if it has that many components per thread
+#define SCC_PARALLEL_MIN 16
+
+// the graph as the closure computation needs it
+struct condensation
+{
+    int N, bpl;
+    char *C;
+    int K;            // components, in reverse topological order
+    int *comp;        // of every vertex
+    int *start;       // members of component c are members[start[c]..start[c + 1])
+    int *members;
+    char *cyclic;     // component c reaches itself
+    int *order;       // components sorted by level
+    int *level_start; // components of level l are order[level_start[l]..level_start[l + 1])
+    int levels;
+};
+
+// the components order[next..last) of a level that are left to close
+struct level
+{
+    const struct condensation *g;
+    int next, last;
+};
+
+struct worker
+{
+    pthread_t thread;
+    struct level *level;
+    char *row; // 32 bytes aligned
+    int *bits; // set in a row
+    int *succ; // successors of a component
+    int *seen; // component that last saw a successor
+};
+
+// next set bit of row at or after j, N if there is none
+static int next_bit(const char *row, int N, int j)
+{
+    int bpl = (N + 7) / 8;
+    for (int b = j / 8; b < bpl; b += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, &row[b], bpl - b < 8 ? bpl - b : 8);
+        if (b == j / 8)
+        {
+            word &= ~(uint64_t)0 << (j % 8);
+        }
+        if (word != 0)
+        {
+            int bit = b * 8 + __builtin_ctzll(word);
+            return bit < N ? bit : N;
+        }
+    }
+    return N;
+}
+
+// stores the set bits of row in bits, returns their number
+static int row_bits(const char *row, int N, int *bits)
+{
+    int bpl = (N + 7) / 8, n = 0;
+    for (int b = 0; b < bpl; b += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, &row[b], bpl - b < 8 ? bpl - b : 8);
+        for (; word != 0; word &= word - 1)
+        {
+            int bit = b * 8 + __builtin_ctzll(word);
+            if (bit < N)
+            {
+                bits[n++] = bit;
+            }
+        }
+    }
+    return n;
+}
+
+static int get_bit(const char *row, int j)
+{
+    return (row[j / 8] >> (j % 8)) & 1;
+}
+
+static void set_bit(char *row, int j)
+{
+    row[j / 8] |= 1 << (j % 8);
+}
+
+// dst |= src over bytes bytes
+static void or_row(char *dst, const char *src, int bytes)
+{
+    int j = 0;
+#ifdef __AVX2__
+    for (; j + 32 <= bytes; j += 32)
+    {
+        __m256i d = _mm256_load_si256((__m256i *)&dst[j]);
+        __m256i s = _mm256_loadu_si256((const __m256i *)&src[j]);
+        _mm256_store_si256((__m256i *)&dst[j], _mm256_or_si256(d, s));
+    }
+#endif
+    for (; j < bytes; j++)
+    {
+        dst[j] |= src[j];
+    }
+}
+
+/*
+ * Finds the strongly connected components of C with an iterative version of
+ * Tarjan's algorithm. Returns their number, comp of every vertex and whether
+ * the components have a cycle.
+ */
+static int tarjan(const char *C, int N, int *comp, char *cyclic)
+{
+    int bpl = (N + 7) / 8;
+    int *index = (int *)malloc(N * sizeof(int));
+    int *low = (int *)malloc(N * sizeof(int));
+    int *next = (int *)malloc(N * sizeof(int)); // bit to continue the row with
+    int *stack = (int *)malloc(N * sizeof(int));
+    int *calls = (int *)malloc(N * sizeof(int));
+    char *on_stack = (char *)calloc(N, 1);
+    int counter = 0, K = 0, top = 0;
+
+    for (int v = 0; v < N; v++)
+    {
+        index[v] = -1;
+    }
+    for (int root = 0; root < N; root++)
+    {
+        if (index[root] != -1)
+        {
+            continue;
+        }
+        int depth = 0;
+        calls[depth++] = root;
+        index[root] = low[root] = counter++;
+        next[root] = 0;
+        stack[top++] = root;
+        on_stack[root] = 1;
+        while (depth > 0)
+        {
+            int v = calls[depth - 1];
+            int w = next_bit(&C[(size_t)v * bpl], N, next[v]);
+            if (w < N)
+            {
+                next[v] = w + 1;
+                if (index[w] == -1)
+                {
+                    calls[depth++] = w;
+                    index[w] = low[w] = counter++;
+                    next[w] = 0;
+                    stack[top++] = w;
+                    on_stack[w] = 1;
+                }
+                else if (on_stack[w] && index[w] < low[v])
+                {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+            depth--;
+            if (depth > 0 && low[v] < low[calls[depth - 1]])
+            {
+                low[calls[depth - 1]] = low[v];
+            }
+            if (low[v] == index[v])
+            {
+                int size = 0, u;
+                do
+                {
+                    u = stack[--top];
+                    on_stack[u] = 0;
+                    comp[u] = K;
+                    size++;
+                } while (u != v);
+                cyclic[K] = size > 1 || get_bit(&C[(size_t)v * bpl], v);
+                K++;
+            }
+        }
+    }
+
+    free(index);
+    free(low);
+    free(next);
+    free(stack);
+    free(calls);
+    free(on_stack);
+    return K;
+}
+
+static void condense(struct condensation *g)
+{
+    int N = g->N;
+    g->comp = (int *)malloc(N * sizeof(int));
+    g->cyclic = (char *)malloc(N);
+    g->K = tarjan(g->C, N, g->comp, g->cyclic);
+    int K = g->K;
+
+    // members by component
+    g->start = (int *)calloc(K + 1, sizeof(int));
+    g->members = (int *)malloc(N * sizeof(int));
+    for (int v = 0; v < N; v++)
+    {
+        g->start[g->comp[v] + 1]++;
+    }
+    for (int c = 0; c < K; c++)
+    {
+        g->start[c + 1] += g->start[c];
+    }
+    int *fill = (int *)malloc(K * sizeof(int));
+    memcpy(fill, g->start, K * sizeof(int));
+    for (int v = 0; v < N; v++)
+    {
+        g->members[fill[g->comp[v]]++] = v;
+    }
+
+    // levels, the successors of a component came out of tarjan before it
+    int *level = (int *)calloc(K, sizeof(int));
+    int *bits = (int *)malloc(N * sizeof(int));
+    g->levels = 0;
+    for (int c = 0; c < K; c++)
+    {
+        for (int x = g->start[c]; x < g->start[c + 1]; x++)
+        {
+            int n = row_bits(&g->C[(size_t)g->members[x] * g->bpl], N, bits);
+            for (int y = 0; y < n; y++)
+            {
+                int s = g->comp[bits[y]];
+                if (s != c && level[s] + 1 > level[c])
+                {
+                    level[c] = level[s] + 1;
+                }
+            }
+        }
+        if (level[c] + 1 > g->levels)
+        {
+            g->levels = level[c] + 1;
+        }
+    }
+    g->level_start = (int *)calloc(g->levels + 1, sizeof(int));
+    g->order = (int *)malloc(K * sizeof(int));
+    for (int c = 0; c < K; c++)
+    {
+        g->level_start[level[c] + 1]++;
+    }
+    for (int l = 0; l < g->levels; l++)
+    {
+        g->level_start[l + 1] += g->level_start[l];
+    }
+    memcpy(fill, g->level_start, g->levels * sizeof(int));
+    for (int c = 0; c < K; c++)
+    {
+        g->order[fill[level[c]]++] = c;
+    }
+    free(fill);
+    free(level);
+    free(bits);
+}
+
+static int descending(const void *a, const void *b)
+{
+    return *(const int *)b - *(const int *)a;
+}
+
+// computes the row of component c and stores it in the rows of its members
+static void close_component(const struct condensation *g, const struct worker *w, int c)
+{
+    const int N = g->N, bpl = g->bpl;
+    char *row = w->row;
+    memset(row, 0, bpl);
+
+    // the successors, read from the rows of the members before they are overwritten
+    int n = 0;
+    for (int x = g->start[c]; x < g->start[c + 1]; x++)
+    {
+        int m = row_bits(&g->C[(size_t)g->members[x] * bpl], N, w->bits);
+        for (int y = 0; y < m; y++)
+        {
+            int s = g->comp[w->bits[y]];
+            if (s != c && w->seen[s] != c)
+            {
+                w->seen[s] = c;
+                w->succ[n++] = s;
+            }
+        }
+    }
+    qsort(w->succ, n, sizeof(int), descending);
+
+    for (int x = 0; x < n; x++)
+    {
+        int s = w->succ[x];
+        int rep = g->members[g->start[s]];
+        if (get_bit(row, rep))
+        {
+            continue; // reached through a closer successor
+        }
+        // the row of a component with a cycle has its members set already
+        or_row(row, &g->C[(size_t)rep * bpl], bpl);
+        set_bit(row, rep);
+    }
+    if (g->cyclic[c])
+    {
+        for (int x = g->start[c]; x < g->start[c + 1]; x++)
+        {
+            set_bit(row, g->members[x]);
+        }
+    }
+    for (int x = g->start[c]; x < g->start[c + 1]; x++)
+    {
+        memcpy(&g->C[(size_t)g->members[x] * bpl], row, bpl);
+    }
+}
+
+static void *close_level(void *arg)
+{
+    struct worker *w = (struct worker *)arg;
+    struct level *l = w->level;
+    for (int x; (x = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED)) < l->last;)
+    {
+        close_component(l->g, w, l->g->order[x]);
+    }
+    return NULL;
+}
+
+static int env_threads(void)
+{
+    const char *env = getenv("FW_THREADS");
+    int threads = env == NULL ? 1 : atoi(env);
+    if (threads <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus < 1 ? 1 : cpus;
+    }
+    return threads;
+}
+
+int floydWarshall(char *C, int N)
+{
+    struct condensation g = {.N = N, .bpl = (N + 7) / 8, .C = C};
+    condense(&g);
+
+    int threads = env_threads();
+    struct worker *workers = (struct worker *)calloc(threads, sizeof(struct worker));
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t].row = (char *)aligned_alloc(32, (g.bpl + 31) / 32 * 32);
+        workers[t].bits = (int *)malloc(N * sizeof(int));
+        workers[t].succ = (int *)malloc(g.K * sizeof(int));
+        workers[t].seen = (int *)malloc(g.K * sizeof(int));
+        memset(workers[t].seen, 0xff, g.K * sizeof(int));
+    }
+
+    for (int l = 0; l < g.levels; l++)
+    {
+        struct level level = {&g, g.level_start[l], g.level_start[l + 1]};
+        int parallel = threads > 1 && level.last - level.next >= SCC_PARALLEL_MIN * threads ? threads : 1;
+        int started[threads];
+        for (int t = 0; t < parallel; t++)
+        {
+            workers[t].level = &level;
+            // if a thread can't be started, the others close its components
+            started[t] = t > 0 && pthread_create(&workers[t].thread, NULL, close_level, &workers[t]) == 0;
+        }
+        close_level(&workers[0]);
+        for (int t = 1; t < parallel; t++)
+        {
+            if (started[t])
+            {
+                pthread_join(workers[t].thread, NULL);
+            }
+        }
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        free(workers[t].row);
+        free(workers[t].bits);
+        free(workers[t].succ);
+        free(workers[t].seen);
+    }
+    free(workers);
+    free(g.comp);
+    free(g.start);
+    free(g.members);
+    free(g.cyclic);
+    free(g.order);
+    free(g.level_start);
+    return 0;
+}
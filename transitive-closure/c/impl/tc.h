@@ -9,4 +9,12 @@
 /* Computes the transitive closure of and stores it in C. N is the number of nodes.*/
 int floydWarshall(char *C, int N);
 
+/* Runs floydWarshall with threads threads, one per cpu if threads <= 0, pinned to the NUMA nodes their tiles are placed on.
+   The floydWarshall of impl/template-tiles.cpp uses FW_THREADS threads, 1 if it isn't set. Only impl/template-tiles.cpp provides it.*/
+int floydWarshallParallel(char *C, int N, int threads);
+
+/* Runs floydWarshall on the count N x N matrices C[0], ..., C[count - 1] of a batch of small graphs, interleaving
+   them across the vector lanes. Uses threads threads, all cores if threads <= 0. Only impl/template-tiles.cpp provides it.*/
+int floydWarshallBatch(char *const *C, int N, int count, int threads);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "../../../generic/cpp/variants.hpp"
+
+extern "C"
+{
+#include "tc.h"
+}
+
+// register type: AVX2 vectors when compiled with -march=native, scalars otherwise
+#ifdef __AVX2__
+typedef __m256i REG;
+#else
+typedef char REG;
+#endif
+
+// parameters the prebuilt table is instantiated for
+// NOTE: Uj and Uj' are given in bytes, i.e. 32 corresponds to one AVX2 vector
+struct grid
+{
+    static constexpr int L1[] = {256, 512, 768};
+    static constexpr int Ui[] = {1, 2, 4, 8};
+    static constexpr int Uj[] = {32, 64};
+    static constexpr int Uii[] = {1, 2, 4};
+    static constexpr int Ujj[] = {32, 64};
+    static constexpr int Ukk[] = {1, 2, 4};
+};
+
+// same parameters as vector-tiles.c, used if the tuning database has no entry for N
+// smaller tiles are picked if 768 doesn't divide N
+static const fw::params defaults = {768, 4, 32, 2, 32, 2};
+
+#define SEMIRING fw::OrAnd
+#define ALGO "tc"
+#include "../../../generic/cpp/template-tiles.hpp"
@@ -1,3 +1,5 @@
+#include "../../../generic/harness/phases.h"
+#include "../../../generic/tunedb/tunedb.h"
 #include "tc.h"
 #include <immintrin.h>
 #include <stdio.h>
@@ -129,29 +131,36 @@ int FWT(char *A, char *B, char *C, int N, int L1)
     {
         // phase 1: update all diagonal tiles
         // FWI(A_kk, B_kk, C_kk, L1)
-        FWI(SUBM(A, k, k, L1, bpl, bpt), SUBM(B, k, k, L1, bpl, bpt), SUBM(C, k, k, L1, bpl, bpt), N, L1);
+        PHASES_BEGIN(k, 1);
+        PHASES_TILE(k, k, FWI(SUBM(A, k, k, L1, bpl, bpt), SUBM(B, k, k, L1, bpl, bpt), SUBM(C, k, k, L1, bpl, bpt), N, L1));
+        PHASES_END(k, 1);
 
         // phase 2: update all tiles in row k
+        PHASES_BEGIN(k, 2);
         for (int j = 0; j < M; j++)
         {
             if (j != k)
             {
                 // FWI(A_kk,B_kj,C_kj, L1)
-                FWI(SUBM(A, k, k, L1, bpl, bpt), SUBM(B, k, j, L1, bpl, bpt), SUBM(C, k, j, L1, bpl, bpt), N, L1);
+                PHASES_TILE(k, j, FWI(SUBM(A, k, k, L1, bpl, bpt), SUBM(B, k, j, L1, bpl, bpt), SUBM(C, k, j, L1, bpl, bpt), N, L1));
             }
         }
+        PHASES_END(k, 2);
 
         // phase 3: update all tiles in column k
+        PHASES_BEGIN(k, 3);
         for (int i = 0; i < M; i++)
         {
             if (i != k)
             {
                 // FWI(A_ik, B_kk, C_ik, L1)
-                FWI(SUBM(A, i, k, L1, bpl, bpt), SUBM(B, k, k, L1, bpl, bpt), SUBM(C, i, k, L1, bpl, bpt), N, L1);
+                PHASES_TILE(i, k, FWI(SUBM(A, i, k, L1, bpl, bpt), SUBM(B, k, k, L1, bpl, bpt), SUBM(C, i, k, L1, bpl, bpt), N, L1));
             }
         }
+        PHASES_END(k, 3);
 
         // phase 4: update all remaining tiles
+        PHASES_BEGIN(k, 4);
         for (int i = 0; i < M; i++)
         {
             if (i != k)
@@ -161,11 +170,12 @@ int FWT(char *A, char *B, char *C, int N, int L1)
                     if (j != k)
                     {
                         // FWIabc(A_ik,B_kj,C_ij, L1)
-                        FWIabc(SUBM(A, i, k, L1, bpl, bpt), SUBM(B, k, j, L1, bpl, bpt), SUBM(C, i, j, L1, bpl, bpt), N, L1);
+                        PHASES_TILE(i, j, FWIabc(SUBM(A, i, k, L1, bpl, bpt), SUBM(B, k, j, L1, bpl, bpt), SUBM(C, i, j, L1, bpl, bpt), N, L1));
                     }
                 }
             }
         }
+        PHASES_END(k, 4);
     }
     return 0;
 }
@@ -196,7 +206,10 @@ int floydWarshall(char *C, int N)
     // tile size is set to 32
     // (this is the minimum due to Uj | L1 | N assumption)
     int L1 = 768; // this is the largest tile size feasible
-    if (L1 >= N) { // tile cannot be larger than the whole matrix
+    struct tunedb_entry e;
+    if (tunedb_lookup("tc", N, &e) == 0 && e.L1 % 256 == 0 && N % e.L1 == 0) {
+      L1 = e.L1; // tuned tile size, a multiple of the 32 byte unrolling
+    } else if (L1 >= N) { // tile cannot be larger than the whole matrix
       L1 = N;
     } else {
       while (N % L1) {
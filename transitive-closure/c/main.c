@@ -1,55 +1,14 @@
-#include <malloc.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <papi.h>
-#include <immintrin.h>
 
+#include "../../generic/harness/harness.h"
+#include "../../generic/harness/input.h"
+#include "../../generic/harness/output.h"
+#include "../../generic/harness/pages.h"
 #include "impl/tc.h"
 
-#define NUM_RUNS 16
-#define CYCLES_REQUIRED 1e8
-#define FREQUENCY 2.3e9
-#define CALIBRATE
-
-#define ERROR_RETURN(retval)                                                         \
-    {                                                                                \
-        fprintf(stderr, "PAPI error %d %s:line %d: \n", retval, __FILE__, __LINE__); \
-        exit(retval);                                                                \
-    }
-
-// The number of PAPI events we measure
-#define NUM_EVENT 4
-
-// The PAPI events we subscribe to for the measurement
-// Only add events supported on your machine. Check with the papi_avail tool in the PAPI utils
-// IMPORTANT: DO NOT CHANGE ORDER! Otherwise the data readout in the measurement script breaks
-static int event_codes[NUM_EVENT] = {
-    PAPI_TOT_CYC, // Total cycles executed
-    PAPI_L3_TCM,  // L3 cache misses
-    PAPI_L2_TCM,  // L2 data cache misses
-    PAPI_L1_DCM,  // L1 data cache misses
-};
-
-void printMatrix(char *C, int N)
-{
-    int bpl = ceil(N / 8.0); // bytes per matrix line
-    for (int i = 0; i < N; i++)
-    {
-        for (int j = 0; j < N; j++)
-        {
-            int bind = j % 8;
-            char cur = C[i * bpl + j / 8];
-            if (cur & (1 << bind))
-                fprintf(stderr, "1, ");
-            else
-                fprintf(stderr, "0, ");
-        }
-        fprintf(stderr, "\n");
-    }
-}
-
 /*
  * Runs the FW implementation once for testing purposes
  * Note that the matrix C is modified in-place
@@ -64,99 +23,6 @@ void ref_output(char *C, int N)
     }
 }
 
-// fine, I'll do it myself
-void flush_cache(void *addr, int nbytes)
-{
-    // assume cache line of 64 bytes, cause why wouldn't it be
-    void *p = addr;
-    while (p < addr + nbytes)
-    {
-        // Invalidate and flush the cache line that contains p from all levels of the cache hierarchy
-        _mm_clflush(p);
-        p += 64;
-    }
-    // Ensure cache flushes have completed
-    _mm_mfence();
-}
-
-/*
- * Timing function based on the TimeStep Counter of the CPU.
- *
- * We don't particularly care about the input, so we just
- * run FW on the same matrix C for each run even though it
- * modifies it in-place.
- *
- * The function returns the average number of cycles per run.
- */
-int measure(char *C, int N, int WarmupEventSet, int MeasurementEventSet, long long *measured_values)
-{
-    int i, retval;
-    int num_runs = NUM_RUNS;
-
-    // Compute how many runs we need to do and warm up cache
-    long long warmup_cycles[1];
-    /* Start counting */
-    long long cycles = 0;
-
-    while (num_runs < (1 << 14))
-    {
-        if ((retval = PAPI_start(WarmupEventSet)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-
-        for (i = 0; i < num_runs; ++i)
-        {
-            floydWarshall(C, N);
-        }
-
-        /* Stop counting, this reads from the counter as well as stop it. */
-        if ((retval = PAPI_stop(WarmupEventSet, warmup_cycles)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-
-        cycles += warmup_cycles[0];
-
-        if (cycles >= CYCLES_REQUIRED)
-        {
-            break;
-        }
-
-        num_runs *= 2;
-        if ((retval = PAPI_reset(WarmupEventSet)) != PAPI_OK)
-        {
-            ERROR_RETURN(retval);
-        }
-    }
-
-    fprintf(stderr, "#runs: %d\n", num_runs);
-    /*
-     * Alternatives to the current approach:
-     * - Measure #cycles for each run separately
-     *  --> Suffers from timing bias and requires cache warmup
-     *  --> Allows for more fine-grained statistics, e.g. median, variance, etc.
-     */
-    /* Start counting */
-    if ((retval = PAPI_start(MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    for (i = 0; i < num_runs; ++i)
-    {
-        floydWarshall(C, N);
-    }
-
-    /* Stop counting, this reads from the counter as well as stop it. */
-    if ((retval = PAPI_stop(MeasurementEventSet, measured_values)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    return num_runs;
-}
-
 void output_matrix(char *filename, char *C, int N)
 {
     int bpl = ceil(N / 8.0); // bytes per matrix line
@@ -185,6 +51,46 @@ void output_matrix(char *filename, char *C, int N)
     }
 }
 
+// sets the bits of the edges of an edge list or CSR input in C
+static int read_edges(struct input *input, char *C, int N)
+{
+    int bpl = ceil(N / 8.0);
+    fprintf(stderr, "reading %llu edges...\n", (unsigned long long)input->m);
+    memset(C, 0, (size_t)N * bpl);
+    struct input_edge edges[INPUT_CHUNK_EDGES];
+    for (size_t n; (n = input_edges(input, edges, INPUT_CHUNK_EDGES)) > 0;)
+    {
+        for (size_t x = 0; x < n; x++)
+        {
+            C[(size_t)edges[x].u * bpl + edges[x].v / 8] |= 1 << (edges[x].v % 8);
+        }
+    }
+    return input->error ? -1 : 0;
+}
+
+// row i of the result for the output modes of output.h
+static void result_row(const void *C, int N, int i, double *out)
+{
+    int bpl = ceil(N / 8.0);
+    for (int j = 0; j < N; j++)
+    {
+        out[j] = (((const char *)C)[i * bpl + j / 8] >> (j % 8)) & 1;
+    }
+}
+
+// reachable vertices are 1, the sparse modes only write their columns
+static const struct output_order order = {0.0, 1, 0};
+
+static int run_floydWarshall(void *C, int N)
+{
+    return floydWarshall((char *)C, N);
+}
+
+// the kernels the harness can measure, selected with FW_KERNEL
+static const struct harness_kernel kernels[] = {
+    {"floydWarshall", run_floydWarshall, 1},
+};
+
 /*
  * Compile with -DRANDOM_INPUT to only read N from the input files,
  * and not write anything to the output file.
@@ -192,83 +98,58 @@ void output_matrix(char *filename, char *C, int N)
  */
 int main(int argc, char **argv)
 {
+    struct output_options output;
+    argc = output_parse(argc, argv, &output);
     if (argc != 3)
     {
         fprintf(stderr, "incorrect number of arguments\n");
-        fprintf(stderr, "call as: ./main input_filename output_filename\n");
+        fprintf(stderr, "call as: ./main [--sparse | --topk K | --threshold T] input_filename output_filename\n");
         return -1;
     }
 
-    // setup PAPI
-    int retval;
-    int WarmupEventSet = PAPI_NULL;
-    int MeasurementEventSet = PAPI_NULL;
-    char errstring[PAPI_MAX_STR_LEN];
-    long long measured_values[NUM_EVENT];
-
-    if ((retval = PAPI_library_init(PAPI_VER_CURRENT)) != PAPI_VER_CURRENT)
-    {
-        fprintf(stderr, "Error: %s\n", errstring);
-        return 1;
-    }
-
-    /* Creating event set   */
-    if ((retval = PAPI_create_eventset(&MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_create_eventset(&WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    // add events to event sets
-    if ((retval = PAPI_add_event(WarmupEventSet, PAPI_TOT_CYC)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
-    if ((retval = PAPI_add_events(MeasurementEventSet, event_codes, NUM_EVENT)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-
     // read input
-    FILE *input_f = fopen(argv[1], "r");
-
-    int N; // num nodes
-    if (fscanf(input_f, "%d ", &N) < 1)
+    struct input input;
+    if (input_open(argv[1], &input) != 0)
     {
-        fprintf(stderr, "malformed input: couldn't match number N of vertices\n");
         return -1;
     }
+    input.no_weights = 1; // only the edges count
+    FILE *input_f = input.f;
+    int N = input.N; // num nodes
 
     fprintf(stderr, "allocating memory...\n");
     int bpl = ceil(N / 8.0);
-    char *C = (char *)aligned_alloc(32, N * bpl * sizeof(char));
-    fprintf(stderr, "parsing input matrix...\n");
+    char *C = (char *)pages_alloc(N * bpl * sizeof(char));
 #ifndef RANDOM_INPUT
-    for (int i = 0; i < N; i++)
+    if (input.format == INPUT_DENSE)
     {
-        char inputValue[100];
-        char curbyte = 0;
-        for (int j = 0; j < N; j++)
+        fprintf(stderr, "parsing input matrix...\n");
+        for (int i = 0; i < N; i++)
         {
-            int bj = j % 8;
-            if (bj == 0)
-                curbyte = 0; // new byte - set all 0
-
-            int numValues = fscanf(input_f, "%[^,\n]s", inputValue);
-            if (numValues == 1)
+            char inputValue[100];
+            char curbyte = 0;
+            for (int j = 0; j < N; j++)
             {
-                curbyte |= 1 << bj;
+                int bj = j % 8;
+                if (bj == 0)
+                    curbyte = 0; // new byte - set all 0
+
+                int numValues = fscanf(input_f, "%[^,\n]s", inputValue);
+                if (numValues == 1)
+                {
+                    curbyte |= 1 << bj;
+                }
+                fgetc(input_f); // skip ',' or '\n'
+                C[i * bpl + j / 8] = curbyte;
             }
-            fgetc(input_f); // skip ',' or '\n'
-            C[i * bpl + j / 8] = curbyte;
         }
     }
+    else if (read_edges(&input, C, N) != 0)
+    {
+        return -1;
+    }
 #endif
-    fclose(input_f);
+    input_close(&input);
 
     char *D = (char *)aligned_alloc(32, N * bpl * sizeof(char));
     memcpy(D, C, N * bpl * sizeof(char));
@@ -281,45 +162,23 @@ int main(int argc, char **argv)
     sprintf(ref_output, "/dev/null");
 #endif
 
-    output_matrix(ref_output, D, N);
-
-    free(D);
-
-    // run measurements
-    fprintf(stderr, "measuring shortest paths for n=%d\n", N);
-    int num_runs = measure(C, N, WarmupEventSet, MeasurementEventSet, measured_values);
-
-    // output measurements
-    printf("%d", num_runs);
-    for (int i = 0; i < NUM_EVENT; i++)
-    {
-        printf("\n%lld", measured_values[i] / num_runs);
-    }
-
-    // clean up
-    free(C);
-
-    /* Free all memory and data structures, EventSet must be empty. */
-    if ((retval = PAPI_cleanup_eventset(WarmupEventSet)) != PAPI_OK)
+    if (output.mode == OUTPUT_DENSE)
     {
-        ERROR_RETURN(retval);
+        output_matrix(ref_output, D, N);
     }
-    if ((retval = PAPI_cleanup_eventset(MeasurementEventSet)) != PAPI_OK)
+    else if (output_write(ref_output, D, N, result_row, &order, &output) != 0)
     {
-        ERROR_RETURN(retval);
+        return -1;
     }
 
-    if ((retval = PAPI_destroy_eventset(&WarmupEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
-    if ((retval = PAPI_destroy_eventset(&MeasurementEventSet)) != PAPI_OK)
-    {
-        ERROR_RETURN(retval);
-    }
+    free(D);
 
-    /* free the resources used by PAPI */
-    PAPI_shutdown();
+    // run measurements
+    fprintf(stderr, "measuring transitive closure for n=%d\n", N);
+    int err = harness_run(kernels, sizeof(kernels) / sizeof(kernels[0]), C, N * bpl * sizeof(char), N);
+
+    // clean up
+    pages_free(C);
 
-    return EXIT_SUCCESS;
+    return err == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }